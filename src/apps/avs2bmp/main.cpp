@@ -12,8 +12,12 @@
 
 #include "../../helper/algorithm.hpp"
 #include "../../helper/bmp.hpp"
+#include "../../helper/cast.hpp"
+#include "../../helper/io.hpp"
 #include "../../helper/math.hpp"
+#include "../../helper/progress.hpp"
 
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -30,6 +34,7 @@ int Main::main(void) {
     }
 
     if (base.empty()) base = inputfile;
+    if (is_stats_shown) enable_metrics(true);
 
     // Read in avs file.
     avs_type& avs = manager().load(inputfile.c_str());
@@ -38,6 +43,7 @@ int Main::main(void) {
     }
     video_type& video = avs.video();
     const video_type::info_type& info = video.info();
+    video.prefetch(prefetch_window);
 
     // Generate actual target frames.
     for (timeranges_type::const_iterator itr = timeranges.begin();
@@ -67,57 +73,111 @@ int Main::main(void) {
                 + tconv.strfrom(target_frames.back()));
     }
 
+    // Tell how frames are read: ranges by "-r" or "-a" are sequential,
+    // and frames with a constant gap are strided.
+    access_type access = RANDOM;
+    unsigned int stride = 0;
+    for (target_frames_type::const_iterator itr = target_frames.begin(),
+            prev = itr++; itr != target_frames.end(); prev = itr++) {
+        const unsigned int gap = *itr - *prev;
+        if (gap == 1) {
+            access = SEQUENTIAL;
+            break;
+        }
+        if (stride == 0) {
+            stride = gap;
+            access = STRIDED;
+        }
+        else if (stride != gap) {
+            access = RANDOM;
+        }
+    }
+    video.access_hint(access, stride);
+
     // do it
     // preparations
     unsigned int i = 0;
     unsigned int n;
-    const unsigned int total = target_frames.size();
-    const unsigned int frac_width = tconv.strfrom(total).size() * 2 + 1;
-    double percentage = 0;
+    uint64_t amount = 0;
     stringstream padding;
     padding.imbue(std::locale::classic());
     padding << right << setfill('0');
-    cout << fixed << setprecision(2);
-    for (target_frames_type::const_iterator itr = target_frames.begin();
-            itr != target_frames.end(); ++itr) {
-        // Get frame stream.
-        n = *itr;
-        std::istream& iframestream = video.framestream(n - 1);
-
-        // Build a filename to output.
-        padding.clear();
-        padding.str("");
-        padding << setw(digit) << n;
-        string_type filename = base + '.' + padding.str() + ".bmp";
-
-        // Show progresses.
-        ++i;
-        percentage = static_cast<double>(i) * 100 / total;
-        cout
-            << filename << " " << setw(frac_width) << i << "/" << total
-            << "(" << setw(6) << percentage << "%)\n";
-
-        // Open output file stream.
-        ofstream fout(filename, ios::binary | ios::trunc);
-        if (!fout.good()) {
-            throw avs2bmp_error(FILE_IO,
-                    "Can't open output file: " + filename);
+    util::time::progress progress(cout, "frames", target_frames.size());
+    std::FILE* progress_out = NULL;
+    if (progress_fd != 0) {
+        progress_out = util::io::open_fd(progress_fd);
+        if (progress_out == NULL) {
+            throw avs2bmp_error(BAD_ARGUMENT,
+                    "Can't write to the file descriptor: "
+                    + tconv.strfrom(progress_fd) + "\n");
+        }
+        progress.machine_readable(progress_out);
+    }
+    target_frames_type::const_iterator itr = target_frames.begin();
+    while (itr != target_frames.end()) {
+        // Find a run of consecutive frames [first, last].
+        const unsigned int first = *itr;
+        unsigned int last = first;
+        for (++itr; itr != target_frames.end() && *itr == last + 1; ++itr) {
+            ++last;
         }
 
-        // Write Windows Bitmap header.
-        format::windows_bitmap::elements_type elements = {
-            info.width,
-            info.height
-        };
-        format::windows_bitmap::header_type header(elements);
-        fout << header;
-
-        // Write pixcel data.
-        fout << iframestream.rdbuf();
+        // Render the run in parallel unless only one job is allowed or
+        // the run is too short to be worth importing for each job.
+        video_type::renderer_type* renderer =
+            (jobs == 1 || last - first + 1 < min_parallel_frames)
+            ? NULL
+            : &video.renderer(first - 1, last, video_type::RGB24, jobs);
+
+        for (n = first; n <= last; ++n) {
+            // Get frame.
+            video_type::frame_view frame;
+            if (renderer != NULL) {
+                renderer->next();
+                frame = renderer->frame();
+            }
+            else {
+                frame = video.frame(n - 1);
+            }
+
+            // Build a filename to output.
+            padding.clear();
+            padding.str("");
+            padding << setw(digit) << n;
+            string_type filename = base + '.' + padding.str() + ".bmp";
+
+            // Open output file stream.
+            ofstream fout(filename.c_str(), ios::binary | ios::trunc);
+            if (!fout.good()) {
+                throw avs2bmp_error(FILE_IO,
+                        "Can't open output file: " + filename);
+            }
+
+            // Write Windows Bitmap header.
+            format::windows_bitmap::elements_type elements = {
+                static_cast<int32_t>(info.width),
+                static_cast<int32_t>(info.height)
+            };
+            format::windows_bitmap::header_type header(elements);
+            fout << header;
+
+            // Write pixcel data.
+            fout.write(
+                    util::cast::constpointer_cast<const char*>(
+                        frame.read_ptr()),
+                    frame.pitch() * frame.height());
+
+            // Show progresses.
+            amount += static_cast<std::streamoff>(fout.tellp());
+            progress.update(++i, amount);
+        }
 
-        // Release frame stream.
-        video.release_framestream(iframestream);
+        if (renderer != NULL) video.release_renderer(*renderer);
     }
+    progress.finish();
+    if (progress_out != NULL) std::fclose(progress_out);
+
+    if (is_stats_shown) cerr << metrics() << flush;
 
     return OK;
 }
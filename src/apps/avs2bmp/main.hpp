@@ -40,6 +40,9 @@ class Main
         opt_trange_type     opt_trange;
         opt_base_type       opt_base;
         opt_digit_type      opt_digit;
+        opt_jobs_type       opt_jobs;
+        opt_stats_type      opt_stats;
+        opt_progress_fd_type    opt_progress_fd;
 
         // a kind of priority action
         // default: UNSPECIFIED
@@ -52,9 +55,17 @@ class Main
         timeranges_type timeranges;
         string_type base;
         unsigned int digit;
+        unsigned int jobs;
+        bool is_stats_shown;
+        unsigned int progress_fd;   // 0 means none
 
         // constants
         static const unsigned int digit_default = 6;
+        // a number of frames to render in advance
+        static const unsigned int prefetch_window = 8;
+        // the shortest run of consecutive frames to render in parallel,
+        // since each job imports <inputfile> again
+        static const unsigned int min_parallel_frames = 16;
 
     protected:
         // implementations for virtual member functions of the super class
@@ -92,6 +103,9 @@ class Main
             switch (e.kind) {
                 case OPT_FRAME: target_frames.push_back(e.data); break;
                 case OPT_DIGIT: digit = e.data; break;
+                case OPT_JOBS:  jobs = e.data;  break;
+                case OPT_STATS: is_stats_shown = true; break;
+                case OPT_PROGRESS_FD:   progress_fd = e.data; break;
             }
         }
         void handle_event(const timerange_type& t) {
@@ -100,7 +114,9 @@ class Main
 
     public:
         // constructor
-        Main(void) : priority(UNSPECIFIED), digit(digit_default) {
+        Main(void)
+            : priority(UNSPECIFIED), digit(digit_default), jobs(0),
+              is_stats_shown(false), progress_fd(0) {
             // register options
             register_option(opt_version);
             register_option(opt_help);
@@ -110,6 +126,9 @@ class Main
             register_option(opt_trange);
             register_option(opt_base);
             register_option(opt_digit);
+            register_option(opt_jobs);
+            register_option(opt_stats);
+            register_option(opt_progress_fd);
 
             // register event listeners
             opt_version.add_event_listener(this);
@@ -120,6 +139,9 @@ class Main
             opt_trange.add_event_listener(this);
             opt_base.add_event_listener(this);
             opt_digit.add_event_listener(this);
+            opt_jobs.add_event_listener(this);
+            opt_stats.add_event_listener(this);
+            opt_progress_fd.add_event_listener(this);
         }
 
         // option analysis and error handling
@@ -21,7 +21,10 @@
 
 enum opt_event_kind {
     OPT_FRAME,
-    OPT_DIGIT
+    OPT_DIGIT,
+    OPT_JOBS,
+    OPT_STATS,
+    OPT_PROGRESS_FD
 };
 
 typedef pattern::event::basic_event<opt_event_kind, unsigned int> event_opt_uint;
@@ -250,5 +253,75 @@ class opt_digit_type
         }
 };
 
+class opt_jobs_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* shortname(void) const { return "j"; }
+        const char_type* longname(void) const { return "jobs"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avs2bmp_error(BAD_ARGUMENT,
+                        "Specify N: " + current + "\n");
+            }
+
+            const string_type& param = *next;
+            if (!checker.is_integer(param) | !checker.is_positive(param)) {
+                throw avs2bmp_error(BAD_ARGUMENT,
+                        "An argument should be positive integer number: " +
+                        current + " " + param + "\n");
+            }
+
+            event_opt_uint event = {OPT_JOBS, tconv.strto<unsigned int>(param)};
+            dispatch_event(event);
+
+            return 2;
+        }
+};
+
+class opt_stats_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* longname(void) const { return "stats"; }
+        unsigned int handle_params(const parameters_type&) {
+            event_opt_uint event = {OPT_STATS, 1};
+            dispatch_event(event);
+            return 1;
+        }
+};
+
+class opt_progress_fd_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* longname(void) const { return "progress-fd"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avs2bmp_error(BAD_ARGUMENT,
+                        "Specify a file descriptor: " + current + "\n");
+            }
+
+            const string_type& param = *next;
+            if (!checker.is_integer(param) | !checker.is_positive(param)) {
+                throw avs2bmp_error(BAD_ARGUMENT,
+                        "An argument should be positive integer number: " +
+                        current + " " + param + "\n");
+            }
+
+            event_opt_uint event =
+                {OPT_PROGRESS_FD, tconv.strto<unsigned int>(param)};
+            dispatch_event(event);
+
+            return 2;
+        }
+};
+
 #endif // OPTION_HPP
 
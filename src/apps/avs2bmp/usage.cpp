@@ -14,6 +14,9 @@ void usage(std::ostream& out) {
     out
         << "Usage: " << name() << " -f|--frame N [options] <inputfile>\n"
         << "\n"
+        << "<inputfile> is an AviSynth script, or a YUV4MPEG2 (*.y4m) or\n"
+        << "RIFF WAV (*.wav) file that is read without AviSynth.\n"
+        << "\n"
         << "Options:\n"
         << "    -h, --help      Shows these help messages.\n"
         << "    -v, --version   Shows version and license informations.\n"
@@ -36,6 +39,18 @@ void usage(std::ostream& out) {
         << "                    concatenated to a base name specified by the\n"
         << "                    option \"-b <base>\" or \"--base <base>\".\n"
         << "    --digit N       Same as \"-d N\".\n"
+        << "    -j N            Renders N frames in parallel. Default is a\n"
+        << "                    number of processors. 1 renders frames one\n"
+        << "                    by one without opening <inputfile> again,\n"
+        << "                    as well as runs of consecutive frames\n"
+        << "                    shorter than 16.\n"
+        << "    --jobs N        Same as \"-j N\".\n"
+        << "\n"
+        << "    --stats         Shows counts and latencies of calls into\n"
+        << "                    AviSynth to stderr at the end.\n"
+        << "    --progress-fd N Writes the progress to the file descriptor N\n"
+        << "                    in a machine-readable form, a line for each\n"
+        << "                    update.\n"
         << std::endl;
 }
 
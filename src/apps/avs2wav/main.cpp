@@ -11,10 +11,13 @@
 
 #include "../../include/avsutil.hpp"
 
-#include "../../helper/elapsed.hpp"
 #include "../../helper/io.hpp"
+#include "../../helper/progress.hpp"
+#include "../../helper/sample.hpp"
 #include "../../helper/wav.hpp"
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
@@ -31,6 +34,9 @@ using namespace avsutil;
 // forward declarations
 // output audio informations
 ostream& operator <<(ostream&, const audio_type::info_type&);
+// the format of samples
+util::sample::format_type sample_format(const bool is_int,
+                                        const unsigned int bit_depth);
 
 int Main::main(void) {
     // constants
@@ -40,6 +46,8 @@ int Main::main(void) {
         throw avs2wav_error(BAD_ARGUMENT, "Specify <inputfile>\n");
     }
 
+    if (is_stats_shown) enable_metrics(true);
+
     // read in avs file
     avs_type& avs = manager().load(inputfile.c_str());
     if (!avs.is_fine()) {
@@ -92,63 +100,102 @@ int Main::main(void) {
         util::io::set_stdout_binary();
     }
 
+    // conversion of samples
+    const util::sample::format_type source_format =
+        sample_format(info.is_int, info.bit_depth);
+    const util::sample::format_type target_format = (bit_depth == 0)
+        ? source_format
+        : sample_format(true, bit_depth);
+    const bool is_converted = (source_format != target_format);
+    const unsigned int target_depth = is_converted
+        ? util::sample::size(target_format) * 8
+        : info.bit_depth;
+
     // showing informations
     infoout << left
         << setw(header_width) << "source:"              << inputfile << "\n"
         << setw(header_width) << "destination:"         << outputfile << "\n"
-        << setw(header_width) << "buffers for output:"  << buf_size << " bytes\n"
-        << info;
-
-    // Applying manipulators to the stream to show informations.
-    infoout << fixed << setprecision(2);
+        << setw(header_width) << "buffers for output:"  << buf_size << " bytes\n";
+    if (is_converted) {
+        infoout
+            << setw(header_width) << "bit depth for output:" << target_depth
+            << (is_dithered ? "bit with dither\n" : "bit\n");
+    }
+    infoout << info;
 
     // writing wav header
     format::riff_wav::elements_type elements = {
         info.channels,
-        info.bit_depth,
+        static_cast<uint16_t>(target_depth),
         static_cast<uint32_t>(info.numof_samples),
         info.sampling_rate
     };
     format::riff_wav::header_type header(elements);
     targetout << header;
 
+    // Get samples in the background while writing them.
+    audio.access_hint(SEQUENTIAL);
+    audio.prefetch(buf_size, prefetch_pages);
+
+    // Read whole samples at a time to convert them.
+    const unsigned int block_size = info.block_size;
+    const unsigned int read_size = is_converted
+        ? std::max(buf_size / block_size, 1U) * block_size
+        : buf_size;
+    const unsigned int value_size = util::sample::size(source_format);
+
     // allocate buffer
-    std::vector<char> buffer(buf_size);
-    buffer.reserve(buf_size);
+    std::vector<char> buffer(read_size);
+    buffer.reserve(read_size);
     char* buf = &buffer[0];
+    std::vector<char> converted(is_converted
+            ? read_size / value_size * util::sample::size(target_format)
+            : 0);
+    util::sample::dither dither;
     std::istream& ain = audio.stream();
 
     // preparations for copying audio samples
-    const unsigned int block_size = info.block_size;
     uint64_t amount = 0;
-    uint64_t numerator = 0;
-    const uint64_t denominator = info.numof_samples;
-    double percentage = 0;
-    util::time::elapsed elapsed;
+    util::time::progress progress(infoout, "samples", info.numof_samples);
+    std::FILE* progress_out = NULL;
+    if (progress_fd != 0) {
+        progress_out = util::io::open_fd(progress_fd);
+        if (progress_out == NULL) {
+            throw avs2wav_error(BAD_ARGUMENT,
+                    "Can't write to the file descriptor: "
+                    + tconv.strfrom(progress_fd) + "\n");
+        }
+        progress.machine_readable(progress_out);
+    }
     // go!!
     while (ain.good()) {
         // read and write
-        ain.read(buf, buf_size);
-        targetout.write(buf, ain.gcount());
-
-        // calculations to show progresses
-        amount += ain.gcount();
-        numerator = amount / block_size;
-
-        percentage = static_cast<double>(numerator) * 100 / denominator;
+        ain.read(buf, read_size);
+        if (is_converted) {
+            const std::size_t count = ain.gcount() / value_size;
+            util::sample::convert(
+                    buf, source_format, &converted[0], target_format, count,
+                    is_dithered ? &dither : NULL);
+            targetout.write(&converted[0],
+                    count * util::sample::size(target_format));
+        }
+        else {
+            targetout.write(buf, ain.gcount());
+        }
 
         // showing progresses
-        infoout
-            << "\r"
-            << numerator << "/" << denominator << " samples"
-            << " (" << percentage << "%)"
-            << " elapsed " << elapsed() << " sec";
+        amount += ain.gcount();
+        progress.update(amount / block_size, amount);
     }
+    progress.finish();
+    if (progress_out != NULL) std::fclose(progress_out);
 
     infoout
-        << "\n\ndone.\n"
+        << "\ndone.\n"
         << endl;
 
+    if (is_stats_shown) infoout << metrics() << endl;
+
     return OK;
 }
 
@@ -181,6 +228,20 @@ ostream& operator <<(ostream& out, const audio_type::info_type& info) {
     return out;
 }
 
+util::sample::format_type sample_format(const bool is_int,
+                                        const unsigned int bit_depth) {
+    if (!is_int) return util::sample::FLOAT;
+    switch (bit_depth) {
+        case 8:     return util::sample::INT8;
+        case 16:    return util::sample::INT16;
+        case 24:    return util::sample::INT24;
+        case 32:    return util::sample::INT32;
+        default:    throw avs2wav_error(BAD_AVS,
+                            "Unsupported bit depth: "
+                            + tconv.strfrom(bit_depth) + "\n");
+    }
+}
+
 int main(const int argc, const char* argv[]) {
     try {
         std::locale::global(std::locale(""));
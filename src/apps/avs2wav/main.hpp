@@ -30,6 +30,10 @@ class Main
         opt_help_type       opt_help;
         opt_buffers_type    opt_buffers;
         opt_output_type     opt_output;
+        opt_depth_type      opt_depth;
+        opt_dither_type     opt_dither;
+        opt_stats_type      opt_stats;
+        opt_progress_fd_type    opt_progress_fd;
 
         // a kind of priority action
         // default: UNSPECIFIED
@@ -39,10 +43,17 @@ class Main
         string_type inputfile;
         string_type outputfile;
         unsigned int buf_size;
+        unsigned int bit_depth;     // 0 means as it is
+        bool is_dithered;
+        bool is_stats_shown;
+        unsigned int progress_fd;   // 0 means none
         std::list<string_type> unknown_opt;
 
         // constants
         static const unsigned int buf_size_def = 65536;
+        // a number of pages to get audio samples in advance, each of them
+        // is as large as the buffer for output
+        static const unsigned int prefetch_pages = 3;
 
     protected:
         // implementations for virtual member functions of the super class
@@ -72,6 +83,15 @@ class Main
             switch (u.kind) {
                 case OPT_BUFFERS:   buf_size = u.data;
                                     break;
+                case OPT_DEPTH:     bit_depth = u.data;
+                                    break;
+                case OPT_DITHER:    is_dithered = true;
+                                    break;
+                case OPT_STATS:     is_stats_shown = true;
+                                    break;
+                case OPT_PROGRESS_FD:
+                                    progress_fd = u.data;
+                                    break;
                 default:            throw std::logic_error("unknown error");
             }
         }
@@ -87,18 +107,30 @@ class Main
         // constructor
         Main(void)
             : priority(UNSPECIFIED),
-              buf_size(buf_size_def) {
+              buf_size(buf_size_def),
+              bit_depth(0),
+              is_dithered(false),
+              is_stats_shown(false),
+              progress_fd(0) {
             // register options
             register_option(opt_version);
             register_option(opt_help);
             register_option(opt_buffers);
             register_option(opt_output);
+            register_option(opt_depth);
+            register_option(opt_dither);
+            register_option(opt_stats);
+            register_option(opt_progress_fd);
 
             // register event listeners
             opt_version.add_event_listener(this);
             opt_help.add_event_listener(this);
             opt_buffers.add_event_listener(this);
             opt_output.add_event_listener(this);
+            opt_depth.add_event_listener(this);
+            opt_dither.add_event_listener(this);
+            opt_stats.add_event_listener(this);
+            opt_progress_fd.add_event_listener(this);
         }
 
         // option analysis and error handling
@@ -17,7 +17,11 @@
 enum opt_event_kind {
     OPT_BUFFERS,
     OPT_SAMPLES,
-    OPT_OUTPUT
+    OPT_OUTPUT,
+    OPT_DEPTH,
+    OPT_DITHER,
+    OPT_STATS,
+    OPT_PROGRESS_FD
 };
 
 typedef pattern::event::basic_event<opt_event_kind, unsigned int>   event_opt_uint;
@@ -111,5 +115,96 @@ class opt_output_type
         }
 };
 
+class opt_depth_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* shortname(void) const { return "d"; }
+        const char_type* longname(void) const { return "depth"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avs2wav_error(BAD_ARGUMENT,
+                        "Specify bit depth: "
+                        + current + "\n");
+            }
+
+            const string_type& param = *next;
+            if (!checker.is_integer(param) | !checker.is_positive(param)) {
+                throw avs2wav_error(BAD_ARGUMENT,
+                        "An argument should be positive integer number: " +
+                        current + " " + param + "\n");
+            }
+
+            unsigned int depth = tconv.strto<unsigned int>(param);
+
+            if (depth != 8 && depth != 16 && depth != 24 && depth != 32) {
+                throw avs2wav_error(BAD_ARGUMENT,
+                        "Bit depth must be 8, 16, 24 or 32.\n"
+                        "Check the argument of \"" + current
+                        + "\" option.\n");
+            }
+
+            event_opt_uint event = {OPT_DEPTH, depth};
+            dispatch_event(event);
+            return 2;
+        }
+};
+
+class opt_dither_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* longname(void) const { return "dither"; }
+        unsigned int handle_params(const parameters_type&) {
+            event_opt_uint event = {OPT_DITHER, 1};
+            dispatch_event(event);
+            return 1;
+        }
+};
+
+class opt_stats_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* longname(void) const { return "stats"; }
+        unsigned int handle_params(const parameters_type&) {
+            event_opt_uint event = {OPT_STATS, 1};
+            dispatch_event(event);
+            return 1;
+        }
+};
+
+class opt_progress_fd_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* longname(void) const { return "progress-fd"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avs2wav_error(BAD_ARGUMENT,
+                        "Specify a file descriptor: "
+                        + current + "\n");
+            }
+
+            const string_type& param = *next;
+            if (!checker.is_integer(param) | !checker.is_positive(param)) {
+                throw avs2wav_error(BAD_ARGUMENT,
+                        "An argument should be positive integer number: " +
+                        current + " " + param + "\n");
+            }
+
+            event_opt_uint event =
+                {OPT_PROGRESS_FD, tconv.strto<unsigned int>(param)};
+            dispatch_event(event);
+            return 2;
+        }
+};
+
 #endif // OPTION_HPP
 
@@ -14,6 +14,9 @@ void usage(std::ostream& out) {
     out
         << "Usage: " << name() << " [options] <inputfile> [| othercommands]\n"
         << "\n"
+        << "<inputfile> is an AviSynth script, or a YUV4MPEG2 (*.y4m) or\n"
+        << "RIFF WAV (*.wav) file that is read without AviSynth.\n"
+        << "\n"
         << "Options:\n"
         << "    -h, --help      Shows these help messages.\n"
         << "    -v, --version   Shows version and license informations.\n"
@@ -26,6 +29,17 @@ void usage(std::ostream& out) {
         << "                    ignored when redirected to file or conneted to\n"
         << "                    other command with pipe.\n"
         << "    --output <file> Same as \"-o\"\n"
+        << "\n"
+        << "    -d N            Converts samples to N bit integers.  N is one of\n"
+        << "                    8, 16, 24 and 32.  default: as it is.\n"
+        << "    --depth N       Same as \"-d\"\n"
+        << "    --dither        Adds TPDF dither when \"-d\" reduces precision.\n"
+        << "\n"
+        << "    --stats         Shows counts and latencies of calls into\n"
+        << "                    AviSynth at the end.\n"
+        << "    --progress-fd N Writes the progress to the file descriptor N\n"
+        << "                    in a machine-readable form, a line for each\n"
+        << "                    update.\n"
         << std::endl;
 }
 
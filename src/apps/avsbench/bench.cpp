@@ -0,0 +1,633 @@
+/*
+ * bench.cpp
+ *  Definitions for bench.hpp
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "avsbench.hpp"
+#include "bench.hpp"
+
+#include "../../include/avsutil.hpp"
+
+#include "../../helper/bmp.hpp"
+#include "../../helper/cast.hpp"
+#include "../../helper/clock.hpp"
+#include "../../helper/wav.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <locale>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <vector>
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    // the same as the defaults of avs2wav and avs2bmp
+    const unsigned int wav_buf_size = 65536;
+    const unsigned int prefetch_pages = 3;
+    const unsigned int prefetch_window = 8;
+    // a size to read a frame stream at a time
+    const unsigned int frame_buf_size = 65536;
+    const unsigned int sampling_rate = 44100;
+    // values to convert at a time, as many as avs2wav does
+    const unsigned int convert_buf_size = 65536;
+    // the frame cache for read_frames()
+    const uint64_t frame_cache_bytes = 64 * 1024 * 1024;
+
+    /*
+     *  A streambuf to write into memory instead of a file.  Bytes are copied
+     *  into a small buffer over and over, like a write into the page cache,
+     *  so that the source is read as well as the applications do.
+     * */
+    class sinkbuf : public std::streambuf {
+        private:
+            static const std::size_t buffer_size = 65536;
+            char mv_buffer[buffer_size];
+            std::size_t mv_position;
+            uint64_t mv_count;
+
+        public:
+            // constructor
+            sinkbuf(void) : mv_position(0), mv_count(0) {}
+
+        private:
+            // copy constructor
+            sinkbuf(const sinkbuf& rhs);
+            // assignment operator
+            sinkbuf& operator=(const sinkbuf& rhs);
+
+        public:
+            // Returns a number of bytes written.
+            uint64_t count(void) const { return mv_count; }
+
+        protected:
+            int_type overflow(int_type c) {
+                if (traits_type::eq_int_type(c, traits_type::eof())) {
+                    return traits_type::not_eof(c);
+                }
+                const char_type ch = traits_type::to_char_type(c);
+                xsputn(&ch, 1);
+                return c;
+            }
+
+            std::streamsize xsputn(const char_type* s, std::streamsize n) {
+                std::streamsize rest = n;
+                while (rest > 0) {
+                    const std::size_t size = std::min<std::size_t>(
+                            static_cast<std::size_t>(rest),
+                            buffer_size - mv_position);
+                    std::memcpy(mv_buffer + mv_position, s, size);
+                    mv_position = (mv_position + size) % buffer_size;
+                    s += size;
+                    rest -= size;
+                }
+                mv_count += n;
+                return n;
+            }
+    };
+
+    /*
+     *  A script imported during a scope.  The script is unloaded at the end
+     *  so that each measurement evaluates it again.
+     * */
+    class loaded_avs {
+        private:
+            avs_type& mv_avs;
+
+        public:
+            // constructor
+            explicit loaded_avs(const std::string& script)
+                : mv_avs(manager().load(script.c_str())) {
+                if (!mv_avs.is_fine()) {
+                    const std::string errmsg = mv_avs.errmsg();
+                    manager().unload(mv_avs);
+                    throw avsbench_error(BAD_AVS, errmsg);
+                }
+            }
+
+            // destructor
+            ~loaded_avs(void) { manager().unload(mv_avs); }
+
+        private:
+            // copy constructor
+            loaded_avs(const loaded_avs& rhs);
+            // assignment operator
+            loaded_avs& operator=(const loaded_avs& rhs);
+
+        public:
+            audio_type& audio(void) {
+                audio_type& audio = mv_avs.audio();
+                if (!audio.info().exists) {
+                    throw avsbench_error(BAD_AVS,
+                            "The script has no audio stream: "
+                            + std::string(mv_avs.filepath()));
+                }
+                return audio;
+            }
+
+            video_type& video(void) {
+                video_type& video = mv_avs.video();
+                if (!video.info().exists) {
+                    throw avsbench_error(BAD_AVS,
+                            "The script has no video stream: "
+                            + std::string(mv_avs.filepath()));
+                }
+                return video;
+            }
+    };
+
+    void keep_best( bench::result_type& best, const bench::result_type& r,
+                    unsigned int i) {
+        if (i == 0 || r.elapsed_ns < best.elapsed_ns) best = r;
+    }
+
+    bench::result_type
+    audiostream_once(const std::string& script, unsigned int buf_size) {
+        loaded_avs avs(script);
+        audio_type& audio = avs.audio();
+        const unsigned int block_size = audio.info().block_size;
+        std::vector<char> buffer(buf_size);
+
+        // Prefetching starts with the stream.
+        const uint64_t start = util::time::monotonic_ns();
+        audio.access_hint(SEQUENTIAL);
+        audio.prefetch(buf_size, prefetch_pages);
+        std::istream& in = audio.stream();
+        uint64_t bytes = 0;
+        while (in.good()) {
+            in.read(&buffer[0], buf_size);
+            bytes += in.gcount();
+        }
+
+        const bench::result_type r = {
+            bytes / block_size, bytes, util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type framestream_once(const std::string& script) {
+        loaded_avs avs(script);
+        video_type& video = avs.video();
+        const uint32_t numof_frames = video.info().numof_frames;
+        std::vector<char> buffer(frame_buf_size);
+
+        const uint64_t start = util::time::monotonic_ns();
+        video.access_hint(SEQUENTIAL);
+        uint64_t bytes = 0;
+        for (uint32_t n = 0; n < numof_frames; ++n) {
+            std::istream& in = video.framestream(n);
+            while (in.good()) {
+                in.read(&buffer[0], frame_buf_size);
+                bytes += in.gcount();
+            }
+            video.release_framestream(in);
+        }
+
+        const bench::result_type r = {
+            numof_frames, bytes, util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type frame_view_once(const std::string& script) {
+        loaded_avs avs(script);
+        video_type& video = avs.video();
+        const uint32_t numof_frames = video.info().numof_frames;
+        // large enough for a row of RGB32
+        std::vector<uint8_t> line(video.info().width * 4);
+
+        const uint64_t start = util::time::monotonic_ns();
+        video.access_hint(SEQUENTIAL);
+        uint64_t bytes = 0;
+        for (uint32_t n = 0; n < numof_frames; ++n) {
+            const video_type::frame_view frame = video.frame(n);
+            const uint32_t row_size = frame.row_size();
+            for (uint32_t y = 0; y < frame.height(); ++y) {
+                std::memcpy(&line[0],
+                        frame.read_ptr() + frame.pitch() * y, row_size);
+            }
+            bytes += static_cast<uint64_t>(row_size) * frame.height();
+        }
+
+        const bench::result_type r = {
+            numof_frames, bytes, util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    // Returns the nth frame to read in "order".
+    uint32_t frame_in_order(access_type order, uint32_t n,
+                            uint32_t numof_frames, uint32_t& random) {
+        switch (order) {
+            case REVERSE:   return numof_frames - 1 - n;
+            case STRIDED:   return n * bench::access_stride;
+            case RANDOM:
+                // a linear congruential generator as rand() of C
+                random = random * 1103515245 + 12345;
+                return (random >> 16) % numof_frames;
+            case SEQUENTIAL:
+            case ADAPTIVE:
+            default:        return n;
+        }
+    }
+
+    bench::result_type read_frames_once(const std::string& script,
+                                        access_type order, access_type hint) {
+        loaded_avs avs(script);
+        video_type& video = avs.video();
+        const uint32_t numof_frames = video.info().numof_frames;
+        const uint32_t numof_reads = (order == STRIDED)
+            ? (numof_frames + bench::access_stride - 1)
+                / bench::access_stride
+            : numof_frames;
+        uint32_t random = 1;
+
+        const uint64_t start = util::time::monotonic_ns();
+        video.prefetch(prefetch_window);
+        video.cache_budget(frame_cache_bytes);
+        video.access_hint(hint, bench::access_stride);
+        uint64_t bytes = 0;
+        for (uint32_t i = 0; i < numof_reads; ++i) {
+            const video_type::frame_view frame = video.frame(
+                    frame_in_order(order, i, numof_frames, random));
+            bytes += static_cast<uint64_t>(frame.row_size())
+                * frame.height();
+        }
+
+        const bench::result_type r = {
+            numof_reads, bytes, util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type
+    load_scripts_once(const std::string& script, unsigned int count) {
+        const uint64_t start = util::time::monotonic_ns();
+        for (unsigned int i = 0; i < count; ++i) {
+            // imported on construction and unloaded on destruction
+            loaded_avs avs(script);
+        }
+
+        const bench::result_type r = {
+            count, 0, util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type
+    open_frames_once(const std::string& script, unsigned int numof_streams) {
+        loaded_avs avs(script);
+        video_type& video = avs.video();
+        std::vector<std::istream*> streams(numof_streams);
+
+        const uint64_t start = util::time::monotonic_ns();
+        for (unsigned int i = 0; i < numof_streams; ++i) {
+            streams[i] = &video.framestream(i / 2);
+        }
+        for (unsigned int i = 0; i < numof_streams; ++i) {
+            video.release_framestream(*streams[i]);
+        }
+
+        const bench::result_type r = {
+            numof_streams, 0, util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type avs2wav_once(const std::string& script) {
+        const uint64_t start = util::time::monotonic_ns();
+        loaded_avs avs(script);
+        audio_type& audio = avs.audio();
+        const audio_type::info_type& info = audio.info();
+
+        sinkbuf sink;
+        std::ostream out(&sink);
+        format::riff_wav::elements_type elements = {
+            info.channels,
+            info.bit_depth,
+            static_cast<uint32_t>(info.numof_samples),
+            info.sampling_rate
+        };
+        format::riff_wav::header_type header(elements);
+        out << header;
+
+        audio.access_hint(SEQUENTIAL);
+        audio.prefetch(wav_buf_size, prefetch_pages);
+        std::vector<char> buffer(wav_buf_size);
+        std::istream& in = audio.stream();
+        while (in.good()) {
+            in.read(&buffer[0], wav_buf_size);
+            out.write(&buffer[0], in.gcount());
+        }
+
+        const bench::result_type r = {
+            info.numof_samples, sink.count(),
+            util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type
+    avs2bmp_once(const std::string& script, unsigned int jobs) {
+        const uint64_t start = util::time::monotonic_ns();
+        loaded_avs avs(script);
+        video_type& video = avs.video();
+        const video_type::info_type& info = video.info();
+        video.prefetch(prefetch_window);
+        video.access_hint(SEQUENTIAL);
+
+        sinkbuf sink;
+        std::ostream out(&sink);
+        video_type::renderer_type* renderer = (jobs == 1)
+            ? NULL
+            : &video.renderer(0, info.numof_frames, video_type::RGB24, jobs);
+        for (uint32_t n = 0; n < info.numof_frames; ++n) {
+            video_type::frame_view frame;
+            if (renderer != NULL) {
+                renderer->next();
+                frame = renderer->frame();
+            }
+            else {
+                frame = video.frame(n);
+            }
+
+            format::windows_bitmap::elements_type elements = {
+                static_cast<int32_t>(info.width),
+                static_cast<int32_t>(info.height)
+            };
+            format::windows_bitmap::header_type header(elements);
+            out << header;
+            out.write(
+                    util::cast::constpointer_cast<const char*>(
+                        frame.read_ptr()),
+                    frame.pitch() * frame.height());
+        }
+        if (renderer != NULL) video.release_renderer(*renderer);
+
+        const bench::result_type r = {
+            info.numof_frames, sink.count(),
+            util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type convert_samples_once(
+            util::sample::format_type from, util::sample::format_type to,
+            bool is_scalar, const bench::settings_type& settings) {
+        const uint64_t numof_values =
+            static_cast<uint64_t>(settings.seconds) * sampling_rate * 6;
+        std::vector<uint8_t> src(convert_buf_size * util::sample::size(from));
+        std::vector<uint8_t> dst(convert_buf_size * util::sample::size(to));
+
+        // a tone at a half level, as audio_script() makes
+        std::vector<float> tone(convert_buf_size);
+        for (unsigned int i = 0; i < convert_buf_size; ++i) {
+            tone[i] = 0.5f * static_cast<float>(std::sin(i * 0.0626));
+        }
+        util::sample::convert_scalar(
+                &tone[0], util::sample::FLOAT, &src[0], from,
+                convert_buf_size);
+
+        const uint64_t start = util::time::monotonic_ns();
+        for (uint64_t done = 0; done < numof_values; ) {
+            const std::size_t count = static_cast<std::size_t>(
+                    std::min<uint64_t>(convert_buf_size, numof_values - done));
+            if (is_scalar) {
+                util::sample::convert_scalar(
+                        &src[0], from, &dst[0], to, count);
+            }
+            else {
+                util::sample::convert(&src[0], from, &dst[0], to, count);
+            }
+            done += count;
+        }
+
+        const bench::result_type r = {
+            numof_values, numof_values * util::sample::size(from),
+            util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+
+    bench::result_type convert_frames_once(
+            bench::colorspace_way_type way,
+            unsigned int width, unsigned int height,
+            const bench::settings_type& settings) {
+        using namespace util::colorspace;
+        const std::size_t pixels = static_cast<std::size_t>(width) * height;
+        const unsigned int bytes =
+            (way == bench::FROM_YV12 || way == bench::FROM_YUY2) ? 3 : 4;
+        // large enough for the planes in full resolution and YUY2
+        std::vector<uint8_t> y(pixels * 2), u(pixels), v(pixels);
+        for (std::size_t i = 0; i < pixels; ++i) {
+            y[i] = static_cast<uint8_t>(16 + i % 220);
+            u[i] = static_cast<uint8_t>(128 + (i / width) % 64);
+            v[i] = static_cast<uint8_t>(128 - (i / width) % 64);
+        }
+        std::vector<uint8_t> dst(pixels * bytes);
+        const coefficients_type k(BT601, TV_RANGE);
+        converter c(BT601, TV_RANGE);
+
+        const uint64_t start = util::time::monotonic_ns();
+        for (unsigned int n = 0; n < settings.frames; ++n) {
+            switch (way) {
+                case bench::TO_BGRA_SCALAR:
+                case bench::TO_BGRA:
+                    for (unsigned int row = 0; row < height; ++row) {
+                        const std::size_t offset =
+                            static_cast<std::size_t>(row) * width;
+                        if (way == bench::TO_BGRA_SCALAR) {
+                            to_bgra_scalar(&y[offset], &u[offset],
+                                    &v[offset], &dst[offset * 4], width, k);
+                        }
+                        else {
+                            to_bgra(&y[offset], &u[offset], &v[offset],
+                                    &dst[offset * 4], width, k);
+                        }
+                    }
+                    break;
+                case bench::FROM_YV12:
+                    c.from_yv12(&y[0], width, &u[0], width / 2,
+                                &v[0], width / 2, width, height,
+                                &dst[0], width * bytes, bytes, true);
+                    break;
+                case bench::FROM_YUY2:
+                default:
+                    c.from_yuy2(&y[0], width * 2, width, height,
+                                &dst[0], width * bytes, bytes, true);
+                    break;
+            }
+        }
+
+        const bench::result_type r = {
+            settings.frames,
+            static_cast<uint64_t>(settings.frames) * pixels * bytes,
+            util::time::monotonic_ns() - start
+        };
+        return r;
+    }
+}
+
+namespace bench {
+    script_file::script_file(const std::string& tag, const std::string& text)
+        : mv_path(std::string(name()) + '.' + tag + ".avs") {
+        std::ofstream out(mv_path.c_str(), std::ios::out | std::ios::trunc);
+        out << text;
+        if (!out.good()) {
+            throw avsbench_error(FILE_IO,
+                    "Can't write a script: " + mv_path + "\n");
+        }
+    }
+
+    script_file::~script_file(void) {
+        std::remove(mv_path.c_str());
+    }
+
+    std::string audio_script(   unsigned int channels, unsigned int bit_depth,
+                                const settings_type& settings) {
+        std::ostringstream script;
+        script.imbue(std::locale::classic());
+        script
+            << "v = BlankClip.KillAudio\n"
+            << "a = Tone(length=" << settings.seconds
+            << ", samplerate=" << sampling_rate
+            << ", channels=" << channels << ", level=0.5)\n"
+            << "AudioDub(v, a).ConvertAudioTo" << bit_depth << "Bit\n";
+        if (settings.audio_cost != 0) {
+            script << "SyntheticCost(audio=" << settings.audio_cost << ")\n";
+        }
+        return script.str();
+    }
+
+    std::string video_script(   const char* pixel_type,
+                                const settings_type& settings) {
+        std::ostringstream script;
+        script.imbue(std::locale::classic());
+        script
+            << "BlankClip(length=" << settings.frames
+            << ", width=" << settings.width
+            << ", height=" << settings.height
+            << ", pixel_type=\"" << pixel_type << "\")\n";
+        if (settings.frame_cost != 0) {
+            script << "SyntheticCost(frame=" << settings.frame_cost << ")\n";
+        }
+        return script.str();
+    }
+
+    result_type audiostream(    const std::string& script,
+                                unsigned int buf_size,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, audiostream_once(script, buf_size), i);
+        }
+        return best;
+    }
+
+    result_type framestream(    const std::string& script,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, framestream_once(script), i);
+        }
+        return best;
+    }
+
+    result_type frame_view(     const std::string& script,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, frame_view_once(script), i);
+        }
+        return best;
+    }
+
+    result_type avs2wav(        const std::string& script,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, avs2wav_once(script), i);
+        }
+        return best;
+    }
+
+    result_type avs2bmp(        const std::string& script,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, avs2bmp_once(script, settings.jobs), i);
+        }
+        return best;
+    }
+
+    result_type read_frames(    const std::string& script,
+                                access_type order, access_type hint,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, read_frames_once(script, order, hint), i);
+        }
+        return best;
+    }
+
+    result_type load_scripts(   const std::string& script,
+                                unsigned int count, std::size_t env_pool,
+                                const settings_type& settings) {
+        manager().env_pool(env_pool);
+        result_type best = {0, 0, 0};
+        try {
+            for (unsigned int i = 0; i < settings.repeat; ++i) {
+                keep_best(best, load_scripts_once(script, count), i);
+            }
+        }
+        catch (...) {
+            manager().env_pool(0);
+            throw;
+        }
+        manager().env_pool(0);
+        return best;
+    }
+
+    result_type open_frames(    const std::string& script,
+                                unsigned int numof_streams,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best, open_frames_once(script, numof_streams), i);
+        }
+        return best;
+    }
+
+    result_type convert_samples(util::sample::format_type from,
+                                util::sample::format_type to,
+                                bool is_scalar,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best,
+                    convert_samples_once(from, to, is_scalar, settings), i);
+        }
+        return best;
+    }
+
+    result_type convert_frames( colorspace_way_type way,
+                                unsigned int width, unsigned int height,
+                                const settings_type& settings) {
+        result_type best = {0, 0, 0};
+        for (unsigned int i = 0; i < settings.repeat; ++i) {
+            keep_best(best,
+                    convert_frames_once(way, width, height, settings), i);
+        }
+        return best;
+    }
+}
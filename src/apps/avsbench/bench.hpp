@@ -0,0 +1,175 @@
+/*
+ * bench.hpp
+ *  Declarations of measurements and synthetic clips for avsbench
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <string>
+
+#include "../../include/avsutil.hpp"
+
+#include "../../helper/colorspace.hpp"
+#include "../../helper/sample.hpp"
+
+/*
+ * TODO: Use "cstdint" when it is available.
+ * */
+#include <stdint.h>
+
+namespace bench {
+    // parameters of synthetic clips and measurements
+    struct settings_type {
+        unsigned int seconds;       // length of audio
+        unsigned int frames;        // length of video
+        unsigned int width;
+        unsigned int height;
+        unsigned int frame_cost;    // microseconds per GetFrame, 0 if none
+        unsigned int audio_cost;    // microseconds per GetAudio, 0 if none
+        unsigned int jobs;          // workers to render, 0 is processors
+        unsigned int repeat;        // measurements to take the best of
+    };
+
+    // ways to convert YUV to RGB in convert_frames()
+    enum colorspace_way_type {
+        TO_BGRA_SCALAR, // util::colorspace::to_bgra_scalar() for each row
+        TO_BGRA,        // util::colorspace::to_bgra() for each row
+        FROM_YV12,      // util::colorspace::converter, YV12 to RGB24
+        FROM_YUY2       // util::colorspace::converter, YUY2 to RGB24
+    };
+
+    // a result of a measurement
+    struct result_type {
+        uint64_t units;         // samples or frames
+        uint64_t bytes;
+        uint64_t elapsed_ns;
+
+        double seconds(void) const { return elapsed_ns / 1e9; }
+        double units_per_second(void) const {
+            return (elapsed_ns == 0) ? 0 : units / seconds();
+        }
+        double megabytes_per_second(void) const {
+            return (elapsed_ns == 0)
+                ? 0
+                : bytes / (1024.0 * 1024.0) / seconds();
+        }
+    };
+
+    /*
+     *  A script file that is written on construction and removed on
+     *  destruction.  The file is made in the current directory.
+     * */
+    class script_file {
+        private:
+            std::string mv_path;
+
+        public:
+            // constructor
+            script_file(const std::string& tag, const std::string& text);
+            // destructor
+            ~script_file(void);
+
+        private:
+            // copy constructor
+            script_file(const script_file& rhs);
+            // assignment operator
+            script_file& operator=(const script_file& rhs);
+
+        public:
+            const std::string& path(void) const { return mv_path; }
+    };
+
+    /*
+     *  Returns scripts of synthetic clips: a tone of "channels" at
+     *  "bit_depth" bits that is as long as settings.seconds, and a blank
+     *  video in "pixel_type" ("RGB24", "RGB32", "YUY2" or "YV12").  The
+     *  costs need the stand-in of AviSynth in src/lib/standin.
+     * */
+    std::string audio_script(   unsigned int channels, unsigned int bit_depth,
+                                const settings_type& settings);
+    std::string video_script(   const char* pixel_type,
+                                const settings_type& settings);
+
+    /*
+     *  Measurements.  Each of them imports "script" by itself and takes the
+     *  best of settings.repeat times.  Those of streams exclude the import
+     *  and read the whole stream through the streambuf, and frame_view()
+     *  reads the same frames through video_type::frame_view, copying each
+     *  row once as a consumer of the pixels would.  Those of the
+     *  applications include the import and do the same as the applications
+     *  do, writing to memory instead of files.
+     * */
+    result_type audiostream(    const std::string& script,
+                                unsigned int buf_size,
+                                const settings_type& settings);
+    result_type framestream(    const std::string& script,
+                                const settings_type& settings);
+    result_type frame_view(     const std::string& script,
+                                const settings_type& settings);
+    result_type avs2wav(        const std::string& script,
+                                const settings_type& settings);
+    result_type avs2bmp(        const std::string& script,
+                                const settings_type& settings);
+
+    /*
+     *  Reads frames of "script" by video_type::frame() in the order of
+     *  "order" after video_type::access_hint("hint"), with prefetching and
+     *  the frame cache enabled.  RANDOM reads as many frames as the clip
+     *  has at random, the same ones in each measurement, and STRIDED reads
+     *  every access_stride-th frame.  The effect of a hint is seen against
+     *  ADAPTIVE in the same order.  Bytes are those of the frames.
+     * */
+    const uint32_t access_stride = 4;
+    result_type read_frames(    const std::string& script,
+                                avsutil::access_type order,
+                                avsutil::access_type hint,
+                                const settings_type& settings);
+
+    /*
+     *  Loads and unloads "script" "count" times in a row after
+     *  manager_type::env_pool("env_pool"), and restores the default of the
+     *  pool.  Each load imports the script again, so a load without the
+     *  pool includes creating IScriptEnvironment.  Units are scripts, and
+     *  bytes are 0.
+     * */
+    result_type load_scripts(   const std::string& script,
+                                unsigned int count, std::size_t env_pool,
+                                const settings_type& settings);
+
+    /*
+     *  Opens "numof_streams" frame streams at once, two for each frame of
+     *  "script", and releases them in the same order.  This measures the
+     *  bookkeeping of the streams that are open, so the clip should be
+     *  small and have numof_streams / 2 frames at least.  Units are
+     *  streams, and bytes are 0.
+     * */
+    result_type open_frames(    const std::string& script,
+                                unsigned int numof_streams,
+                                const settings_type& settings);
+
+    /*
+     *  Converts samples of 5.1ch as long as settings.seconds from "from" to
+     *  "to" in memory, by util::sample::convert() or convert_scalar() if
+     *  "is_scalar".  Bytes are those of the source.
+     * */
+    result_type convert_samples(util::sample::format_type from,
+                                util::sample::format_type to,
+                                bool is_scalar,
+                                const settings_type& settings);
+
+    /*
+     *  Converts settings.frames frames of "width" x "height" from YUV to RGB
+     *  in memory by "way", by BT601 and TV_RANGE as the library does.
+     *  TO_BGRA_SCALAR and TO_BGRA take the chroma in full resolution, so
+     *  they measure only the kernels.  Bytes are those of the destination.
+     * */
+    result_type convert_frames( colorspace_way_type way,
+                                unsigned int width, unsigned int height,
+                                const settings_type& settings);
+}
+
+#endif // BENCH_HPP
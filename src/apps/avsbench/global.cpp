@@ -0,0 +1,14 @@
+/*
+ * global.cpp
+ *  Declarations and definitions for global objects
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "avsbench.hpp"
+
+#include <locale>
+
+util::string::typeconverter tconv(std::locale::classic());
+util::string::check checker(std::locale::classic());
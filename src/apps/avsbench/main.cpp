@@ -0,0 +1,367 @@
+/*
+ * avsbench main.cpp
+ *  measure the library and the pipelines of the applications with
+ *  synthetic clips, and output the results as JSON
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "avsbench.hpp"
+#include "bench.hpp"
+#include "main.hpp"
+
+#include "../../include/avsutil.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <locale>
+#include <stdexcept>
+#include <string>
+
+// using namespaces
+using namespace std;
+
+namespace {
+    // the matrix of the suite, the same as test/*.avs
+    const unsigned int channels_list[] = {1, 2, 6};
+    const unsigned int bit_depths[] = {8, 16, 24, 32};
+    // sizes to read audio streams
+    const unsigned int buf_sizes[] = {4096, 65536, 1048576};
+    const char* const pixel_types[] = {"RGB24", "RGB32", "YUY2", "YV12"};
+    // orders to read frames with and without the hint of the same one
+    const avsutil::access_type orders[] = {
+        avsutil::SEQUENTIAL, avsutil::REVERSE, avsutil::RANDOM,
+        avsutil::STRIDED
+    };
+    const char* const order_names[] = {
+        "sequential", "reverse", "random", "strided"
+    };
+    // scripts to load in a row, without and with the pool of
+    // IScriptEnvironment
+    const unsigned int load_counts[] = {1, 1000};
+    const std::size_t env_pools[] = {0, 4};
+    // frame streams to keep open at once
+    const unsigned int open_streams[] = {1000, 4000, 16000};
+
+    // resolutions to convert YUV to RGB
+    struct resolution_type {
+        unsigned int width;
+        unsigned int height;
+    };
+    const resolution_type resolutions[] = {
+        {320, 240}, {640, 480}, {1280, 720}, {1920, 1080}
+    };
+    const bench::colorspace_way_type colorspace_ways[] = {
+        bench::TO_BGRA_SCALAR, bench::TO_BGRA,
+        bench::FROM_YV12, bench::FROM_YUY2
+    };
+    const char* const colorspace_way_names[] = {
+        "to_bgra_scalar", "to_bgra", "yv12_rgb24", "yuy2_rgb24"
+    };
+
+    // pairs of formats to convert samples, the vectorized ones and a
+    // scalar one
+    struct conversion_type {
+        util::sample::format_type from;
+        util::sample::format_type to;
+    };
+    const conversion_type conversions[] = {
+        {util::sample::INT16, util::sample::FLOAT},
+        {util::sample::INT32, util::sample::FLOAT},
+        {util::sample::FLOAT, util::sample::INT16},
+        {util::sample::FLOAT, util::sample::INT32},
+        {util::sample::INT32, util::sample::INT16},
+        {util::sample::INT16, util::sample::INT32},
+        {util::sample::FLOAT, util::sample::INT24}
+    };
+    const char* const format_names[] = {
+        "INT8", "INT16", "INT24", "INT32", "FLOAT"
+    };
+
+    template<typename T, std::size_t N>
+    std::size_t countof(const T (&)[N]) { return N; }
+}
+
+// forward declarations
+// Writes a result as a JSON object.
+void write_result(  ostream& out, const bench::result_type& result,
+                    const char* units);
+// Writes measurements of the calls into AviSynth as a JSON object.
+void write_metrics(ostream& out, const avsutil::metrics_type& metrics);
+
+int Main::main(void) {
+    // output stream (to stdout for now)
+    ostream out(cout.rdbuf());
+    filebuf fbuf;
+    if (!outputfile.empty()) {
+        fbuf.open(outputfile.c_str(), ios::out | ios::trunc);
+        if (!fbuf.is_open()) {
+            throw avsbench_error(FILE_IO,
+                    "Can't open file to write: " + outputfile);
+        }
+        out.rdbuf(&fbuf);
+    }
+    out.imbue(std::locale::classic());
+
+    out
+        << "{\n"
+        << "  \"program\": \"" << name() << "\",\n"
+        << "  \"version\": \"" << version() << "\",\n"
+        << "  \"avsutil\": \"" << avsutil::version() << "\",\n"
+        << "  \"settings\": {"
+        << "\"seconds\": " << settings.seconds
+        << ", \"frames\": " << settings.frames
+        << ", \"width\": " << settings.width
+        << ", \"height\": " << settings.height
+        << ", \"frame_cost_us\": " << settings.frame_cost
+        << ", \"audio_cost_us\": " << settings.audio_cost
+        << ", \"jobs\": " << settings.jobs
+        << ", \"repeat\": " << settings.repeat
+        << ", \"stats\": " << (is_stats_written ? "true" : "false")
+        << "},\n";
+
+    // The measurement makes each call into AviSynth slightly slower.
+    if (is_stats_written) {
+        avsutil::reset_metrics();
+        avsutil::enable_metrics(true);
+    }
+
+    // audio
+    out << "  \"audio\": [\n";
+    for (std::size_t i = 0; i < countof(channels_list); ++i) {
+        for (std::size_t j = 0; j < countof(bit_depths); ++j) {
+            const unsigned int channels = channels_list[i];
+            const unsigned int bit_depth = bit_depths[j];
+            const string tag =
+                tconv.strfrom(bit_depth) + "bit_" + tconv.strfrom(channels)
+                + "ch";
+            cerr << "audio " << tag << endl;
+
+            bench::script_file script(
+                    tag, bench::audio_script(channels, bit_depth, settings));
+            out << "    {\"channels\": " << channels
+                << ", \"bit_depth\": " << bit_depth << ",\n"
+                << "     \"audiostream\": [\n";
+            for (std::size_t k = 0; k < countof(buf_sizes); ++k) {
+                const bench::result_type r = bench::audiostream(
+                        script.path(), buf_sizes[k], settings);
+                out << "       {\"buffer\": " << buf_sizes[k]
+                    << ", \"result\": ";
+                write_result(out, r, "samples");
+                out << ((k + 1 < countof(buf_sizes)) ? "},\n" : "}],\n");
+            }
+            out << "     \"avs2wav\": ";
+            write_result(
+                    out, bench::avs2wav(script.path(), settings), "samples");
+            out << ((i + 1 < countof(channels_list)
+                        || j + 1 < countof(bit_depths))
+                    ? "},\n" : "}\n");
+        }
+    }
+    out << "  ],\n";
+
+    // video
+    out << "  \"video\": [\n";
+    for (std::size_t i = 0; i < countof(pixel_types); ++i) {
+        cerr << "video " << pixel_types[i] << endl;
+
+        bench::script_file script(
+                pixel_types[i], bench::video_script(pixel_types[i], settings));
+        out << "    {\"pixel_type\": \"" << pixel_types[i] << "\",\n"
+            << "     \"framestream\": ";
+        write_result(
+                out, bench::framestream(script.path(), settings), "frames");
+        out << ",\n"
+            << "     \"frame_view\": ";
+        write_result(
+                out, bench::frame_view(script.path(), settings), "frames");
+        out << ",\n"
+            << "     \"avs2bmp\": ";
+        write_result(out, bench::avs2bmp(script.path(), settings), "frames");
+        out << ((i + 1 < countof(pixel_types)) ? "},\n" : "}\n");
+    }
+    out << "  ],\n";
+
+    // access hints
+    {
+        bench::script_file script(
+                "access", bench::video_script("RGB24", settings));
+        out << "  \"access\": [\n";
+        for (std::size_t i = 0; i < countof(orders); ++i) {
+            cerr << "access " << order_names[i] << endl;
+
+            out << "    {\"order\": \"" << order_names[i] << "\",\n"
+                << "     \"adaptive\": ";
+            write_result(out,
+                    bench::read_frames(
+                        script.path(), orders[i], avsutil::ADAPTIVE,
+                        settings),
+                    "frames");
+            out << ",\n"
+                << "     \"hinted\": ";
+            write_result(out,
+                    bench::read_frames(
+                        script.path(), orders[i], orders[i], settings),
+                    "frames");
+            out << ((i + 1 < countof(orders)) ? "},\n" : "}\n");
+        }
+        out << "  ],\n";
+    }
+
+    // loads of scripts
+    {
+        bench::script_file script(
+                "load", bench::video_script("RGB24", settings));
+        out << "  \"load\": [\n";
+        for (std::size_t i = 0; i < countof(load_counts); ++i) {
+            for (std::size_t j = 0; j < countof(env_pools); ++j) {
+                cerr << "load " << load_counts[i] << " env_pool "
+                     << env_pools[j] << endl;
+
+                out << "    {\"scripts\": " << load_counts[i]
+                    << ", \"env_pool\": " << env_pools[j]
+                    << ", \"result\": ";
+                write_result(out,
+                        bench::load_scripts(
+                            script.path(), load_counts[i], env_pools[j],
+                            settings),
+                        "scripts");
+                out << ((i + 1 < countof(load_counts)
+                            || j + 1 < countof(env_pools))
+                        ? "},\n" : "}\n");
+            }
+        }
+        out << "  ],\n";
+    }
+
+    // frame streams open at once, of a small clip to measure the
+    // bookkeeping rather than frames
+    {
+        cerr << "open frames" << endl;
+
+        bench::settings_type small = settings;
+        small.frames = open_streams[countof(open_streams) - 1] / 2;
+        small.width = 64;
+        small.height = 48;
+        small.frame_cost = 0;
+        bench::script_file script(
+                "open_frames", bench::video_script("RGB24", small));
+        out << "  \"open_frames\": [\n";
+        for (std::size_t i = 0; i < countof(open_streams); ++i) {
+            out << "    {\"streams\": " << open_streams[i]
+                << ", \"result\": ";
+            write_result(out,
+                    bench::open_frames(
+                        script.path(), open_streams[i], settings),
+                    "streams");
+            out << ((i + 1 < countof(open_streams)) ? "},\n" : "}\n");
+        }
+        out << "  ],\n";
+    }
+
+    // conversions of YUV to RGB
+    out << "  \"colorspace\": [\n";
+    for (std::size_t i = 0; i < countof(resolutions); ++i) {
+        const resolution_type& r = resolutions[i];
+        cerr << "colorspace " << r.width << "x" << r.height << endl;
+
+        out << "    {\"width\": " << r.width
+            << ", \"height\": " << r.height;
+        for (std::size_t j = 0; j < countof(colorspace_ways); ++j) {
+            out << ",\n     \"" << colorspace_way_names[j] << "\": ";
+            write_result(out,
+                    bench::convert_frames(
+                        colorspace_ways[j], r.width, r.height, settings),
+                    "frames");
+        }
+        out << ((i + 1 < countof(resolutions)) ? "},\n" : "}\n");
+    }
+    out << "  ],\n";
+
+    // conversions of samples
+    out << "  \"sample\": [\n";
+    for (std::size_t i = 0; i < countof(conversions); ++i) {
+        const conversion_type& c = conversions[i];
+        cerr << "sample " << format_names[c.from] << " to "
+             << format_names[c.to] << endl;
+
+        out << "    {\"from\": \"" << format_names[c.from]
+            << "\", \"to\": \"" << format_names[c.to] << "\",\n"
+            << "     \"convert_scalar\": ";
+        write_result(out,
+                bench::convert_samples(c.from, c.to, true, settings),
+                "samples");
+        out << ",\n"
+            << "     \"convert\": ";
+        write_result(out,
+                bench::convert_samples(c.from, c.to, false, settings),
+                "samples");
+        out << ((i + 1 < countof(conversions)) ? "},\n" : "}\n");
+    }
+    out << "  ]";
+
+    // calls into AviSynth during all measurements
+    if (is_stats_written) {
+        out << ",\n"
+            << "  \"metrics\": ";
+        write_metrics(out, avsutil::metrics());
+    }
+    out << "\n"
+        << "}" << endl;
+
+    if (!out.good()) {
+        throw avsbench_error(FILE_IO, "Can't write the results.");
+    }
+
+    return OK;
+}
+
+void write_result(  ostream& out, const bench::result_type& result,
+                    const char* units) {
+    out << "{\"seconds\": " << result.seconds()
+        << ", \"" << units << "\": " << result.units
+        << ", \"bytes\": " << result.bytes
+        << ", \"" << units << "_per_second\": " << result.units_per_second()
+        << ", \"megabytes_per_second\": " << result.megabytes_per_second()
+        << "}";
+}
+
+void write_metrics(ostream& out, const avsutil::metrics_type& metrics) {
+    typedef avsutil::metrics_type metrics_type;
+
+    out << "{";
+    for (unsigned int i = 0; i < metrics_type::NUMOF_KINDS; ++i) {
+        const metrics_type::kind_type kind =
+            static_cast<metrics_type::kind_type>(i);
+        const metrics_type::entry_type& e = metrics.entries[kind];
+        out << ((i == 0) ? "\n" : ",\n")
+            << "    \"" << metrics_type::name(kind) << "\": {"
+            << "\"count\": " << e.count
+            << ", \"total_ns\": " << e.total_ns
+            << ", \"max_ns\": " << e.max_ns
+            << ", \"p50_ns\": " << metrics.percentile_ns(kind, 0.5)
+            << ", \"p99_ns\": " << metrics.percentile_ns(kind, 0.99)
+            << "}";
+    }
+    out << "\n  }";
+}
+
+int main(const int argc, const char* const argv[]) {
+    try {
+        locale::global(locale(""));
+        Main main;
+        main.analyze_option(argc, argv);
+        main.preparation();
+        return main.start();
+    }
+    catch (const avsbench_error& ex) {
+        cerr << ex.what() << endl;
+        if (ex.return_value() == BAD_ARGUMENT) usage(cerr);
+        return ex.return_value();
+    }
+    catch (const exception& ex) {
+        cerr << "error: " << ex.what() << endl;
+        return UNKNOWN;
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * main.hpp
+ *  Declarations and definitions for basic flow of the program
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include "avsbench.hpp"
+#include "bench.hpp"
+#include "option.hpp"
+
+#include <iostream>
+#include <list>
+
+#include "../../helper/getopt.hpp"
+#include "../../helper/event.hpp"
+#include "../../helper/typeconv.hpp"
+
+class Main
+    : public util::getopt::getopt,
+      public pattern::event::event_listener<priority_type>,
+      public pattern::event::event_listener<event_opt_uint>,
+      public pattern::event::event_listener<event_opt_string> {
+    private:
+        // objects to handle options
+        opt_version_type    opt_version;
+        opt_help_type       opt_help;
+        opt_output_type     opt_output;
+        opt_seconds_type    opt_seconds;
+        opt_frames_type     opt_frames;
+        opt_width_type      opt_width;
+        opt_height_type     opt_height;
+        opt_frame_cost_type opt_frame_cost;
+        opt_audio_cost_type opt_audio_cost;
+        opt_jobs_type       opt_jobs;
+        opt_repeat_type     opt_repeat;
+        opt_stats_type      opt_stats;
+
+        // a kind of priority action
+        // default: UNSPECIFIED
+        priority_type priority;
+
+        // member variables
+        string_type outputfile;     // empty means stdout
+        bench::settings_type settings;
+        bool is_stats_written;
+        std::list<string_type> unknown_opt;
+
+    protected:
+        // implementations for virtual member functions of the super class
+        // util::getopt::getopt
+        unsigned int handle_unknown_opt(const parameters_type& params) {
+            // cash unknown optoins
+            unknown_opt.push_back(*(params.current()));
+            return 1;
+        }
+        unsigned int handle_behind_parameters(const parameters_type& params) {
+            throw avsbench_error(BAD_ARGUMENT,
+                      "Don't specify anything behind the nonopt parameter: "
+                    + *(params.current()) + "\n");
+        }
+        unsigned int handle_nonopt(const parameters_type& params) {
+            // scripts are made by the program
+            throw avsbench_error(BAD_ARGUMENT,
+                      "Don't specify any input file: "
+                    + *(params.current()) + "\n");
+        }
+
+    public:
+        // event handlers
+        void handle_event(const priority_type& p) {
+            if (priority == UNSPECIFIED) priority = p;
+        }
+        void handle_event(const event_opt_uint& u) {
+            switch (u.kind) {
+                case OPT_SECONDS:       settings.seconds = u.data;
+                                        break;
+                case OPT_FRAMES:        settings.frames = u.data;
+                                        break;
+                case OPT_WIDTH:         settings.width = u.data;
+                                        break;
+                case OPT_HEIGHT:        settings.height = u.data;
+                                        break;
+                case OPT_FRAME_COST:    settings.frame_cost = u.data;
+                                        break;
+                case OPT_AUDIO_COST:    settings.audio_cost = u.data;
+                                        break;
+                case OPT_JOBS:          settings.jobs = u.data;
+                                        break;
+                case OPT_REPEAT:        settings.repeat = u.data;
+                                        break;
+                case OPT_STATS:         is_stats_written = true;
+                                        break;
+                default:    throw std::logic_error("unknown error");
+            }
+        }
+        void handle_event(const event_opt_string& s) {
+            switch (s.kind) {
+                case OPT_OUTPUT:    outputfile = s.data;
+                                    break;
+                default:            throw std::logic_error("unknown error");
+            }
+        }
+
+    public:
+        // constructor
+        Main(void) : priority(UNSPECIFIED), is_stats_written(false) {
+            settings.seconds = 10;
+            settings.frames = 100;
+            settings.width = 640;
+            settings.height = 480;
+            settings.frame_cost = 0;
+            settings.audio_cost = 0;
+            settings.jobs = 0;
+            settings.repeat = 3;
+
+            // register options
+            register_option(opt_version);
+            register_option(opt_help);
+            register_option(opt_output);
+            register_option(opt_seconds);
+            register_option(opt_frames);
+            register_option(opt_width);
+            register_option(opt_height);
+            register_option(opt_frame_cost);
+            register_option(opt_audio_cost);
+            register_option(opt_jobs);
+            register_option(opt_repeat);
+            register_option(opt_stats);
+
+            // register event listeners
+            opt_version.add_event_listener(this);
+            opt_help.add_event_listener(this);
+            opt_output.add_event_listener(this);
+            opt_seconds.add_event_listener(this);
+            opt_frames.add_event_listener(this);
+            opt_width.add_event_listener(this);
+            opt_height.add_event_listener(this);
+            opt_frame_cost.add_event_listener(this);
+            opt_audio_cost.add_event_listener(this);
+            opt_jobs.add_event_listener(this);
+            opt_repeat.add_event_listener(this);
+            opt_stats.add_event_listener(this);
+        }
+
+        // option analysis and error handling
+        void preparation(void) {
+            if (!unknown_opt.empty()) {
+                throw avsbench_error(BAD_ARGUMENT,
+                        "Unknown options: "
+                        + tconv.join(
+                            unknown_opt.begin(),
+                            unknown_opt.end(), ", ") + "\n");
+            }
+            // YUY2 and YV12 have a chroma sample for 2x1 and 2x2 pixels
+            if (settings.width % 2 != 0 || settings.height % 2 != 0) {
+                throw avsbench_error(BAD_ARGUMENT,
+                        "Width and height must be even numbers.\n");
+            }
+        }
+
+        // do it
+        int start(void) {
+            switch (priority) {
+                case VERSION:       about(std::cout);
+                                    return OK;
+                case HELP:          usage(std::cout);
+                                    return OK;
+                case UNSPECIFIED:   return main();
+                default:            throw std::logic_error("unknown error");
+            }
+        }
+
+        int main(void);
+};
+
+#endif // MAIN_HPP
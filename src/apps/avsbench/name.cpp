@@ -0,0 +1,12 @@
+/*
+ * name.cpp
+ *  A definition of function to give a name of the program
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "avsbench.hpp"
+
+const char* name(void) { return "avsbench"; }
+
@@ -0,0 +1,173 @@
+/*
+ * option.hpp
+ *  Declarations and definitions of option classes
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef OPTION_HPP
+#define OPTION_HPP
+
+#include "avsbench.hpp"
+
+#include "../../helper/getopt.hpp"
+#include "../../helper/event.hpp"
+
+enum opt_event_kind {
+    OPT_OUTPUT,
+    OPT_SECONDS,
+    OPT_FRAMES,
+    OPT_WIDTH,
+    OPT_HEIGHT,
+    OPT_FRAME_COST,
+    OPT_AUDIO_COST,
+    OPT_JOBS,
+    OPT_REPEAT,
+    OPT_STATS
+};
+
+typedef pattern::event::basic_event<opt_event_kind, unsigned int>
+    event_opt_uint;
+typedef pattern::event::basic_event<
+        opt_event_kind, util::getopt::option::string_type>
+    event_opt_string;
+
+// option definitions
+class opt_help_type
+    : public util::getopt::option,
+      public pattern::event::event_source<priority_type> {
+    protected:
+        const char_type* shortname(void) const { return "h"; }
+        const char_type* longname(void) const { return "help"; }
+        unsigned int handle_params(const parameters_type&) {
+            dispatch_event(HELP);
+            return 1;
+        }
+};
+
+class opt_version_type
+    : public util::getopt::option,
+      public pattern::event::event_source<priority_type> {
+    protected:
+        const char_type* shortname(void) const { return "v"; }
+        const char_type* longname(void) const { return "version"; }
+        unsigned int handle_params(const parameters_type&) {
+            dispatch_event(VERSION);
+            return 1;
+        }
+};
+
+class opt_output_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_string> {
+    protected:
+        const char_type* shortname(void) const { return "o"; }
+        const char_type* longname(void) const { return "output"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+
+            if (next == params.end()) {
+                throw avsbench_error(BAD_ARGUMENT,
+                        "Specify a name of output file: "
+                        + *(params.current()) + "\n");
+            }
+
+            event_opt_string event = {OPT_OUTPUT, *next};
+            dispatch_event(event);
+            return 2;
+        }
+};
+
+// a base class for options that take a positive integer
+class opt_uint_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        virtual opt_event_kind kind(void) const = 0;
+
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avsbench_error(BAD_ARGUMENT,
+                        "Specify a number: " + current + "\n");
+            }
+
+            const string_type& param = *next;
+            if (!checker.is_integer(param) | !checker.is_positive(param)) {
+                throw avsbench_error(BAD_ARGUMENT,
+                        "An argument should be positive integer number: " +
+                        current + " " + param + "\n");
+            }
+
+            event_opt_uint event = {kind(), tconv.strto<unsigned int>(param)};
+            dispatch_event(event);
+            return 2;
+        }
+};
+
+class opt_seconds_type : public opt_uint_type {
+    protected:
+        const char_type* longname(void) const { return "seconds"; }
+        opt_event_kind kind(void) const { return OPT_SECONDS; }
+};
+
+class opt_frames_type : public opt_uint_type {
+    protected:
+        const char_type* longname(void) const { return "frames"; }
+        opt_event_kind kind(void) const { return OPT_FRAMES; }
+};
+
+class opt_width_type : public opt_uint_type {
+    protected:
+        const char_type* longname(void) const { return "width"; }
+        opt_event_kind kind(void) const { return OPT_WIDTH; }
+};
+
+class opt_height_type : public opt_uint_type {
+    protected:
+        const char_type* longname(void) const { return "height"; }
+        opt_event_kind kind(void) const { return OPT_HEIGHT; }
+};
+
+class opt_frame_cost_type : public opt_uint_type {
+    protected:
+        const char_type* longname(void) const { return "frame-cost"; }
+        opt_event_kind kind(void) const { return OPT_FRAME_COST; }
+};
+
+class opt_audio_cost_type : public opt_uint_type {
+    protected:
+        const char_type* longname(void) const { return "audio-cost"; }
+        opt_event_kind kind(void) const { return OPT_AUDIO_COST; }
+};
+
+class opt_jobs_type : public opt_uint_type {
+    protected:
+        const char_type* shortname(void) const { return "j"; }
+        const char_type* longname(void) const { return "jobs"; }
+        opt_event_kind kind(void) const { return OPT_JOBS; }
+};
+
+class opt_repeat_type : public opt_uint_type {
+    protected:
+        const char_type* shortname(void) const { return "r"; }
+        const char_type* longname(void) const { return "repeat"; }
+        opt_event_kind kind(void) const { return OPT_REPEAT; }
+};
+
+class opt_stats_type
+    : public util::getopt::option,
+      public pattern::event::event_source<event_opt_uint> {
+    protected:
+        const char_type* longname(void) const { return "stats"; }
+        unsigned int handle_params(const parameters_type&) {
+            event_opt_uint event = {OPT_STATS, 1};
+            dispatch_event(event);
+            return 1;
+        }
+};
+
+#endif // OPTION_HPP
@@ -0,0 +1,62 @@
+/*
+ * usage.cpp
+ *  Usage definitions for avsbench.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "avsbench.hpp"
+
+#include <ostream>
+
+void usage(std::ostream& out) {
+    out
+        << "Usage: " << name() << " [options]\n"
+        << "\n"
+        << "Measures the library and the pipelines of avs2wav and avs2bmp\n"
+        << "with synthetic clips, and writes the results as JSON.  Audio\n"
+        << "is mono, stereo and 5.1ch at 8, 16, 24 and 32 bit, and is\n"
+        << "read through the stream by 4096, 65536 and 1048576 bytes.\n"
+        << "Video is RGB24, RGB32, YUY2 and YV12, and is read through the\n"
+        << "frame stream and through frame_view.  Frames are read forward,\n"
+        << "backward, at random and by a stride with and without the\n"
+        << "access hint of the same order.  A script is loaded once and\n"
+        << "1000 times in a row, with and without the pool of\n"
+        << "IScriptEnvironment.  1000 to 16000 frame streams are kept\n"
+        << "open at once.  Conversions of YUV to RGB are\n"
+        << "measured from 320x240 to 1920x1080, and those of samples with\n"
+        << "and without SIMD.  Scripts of the clips are made in the\n"
+        << "current directory while they are measured.\n"
+        << "\n"
+        << "Options:\n"
+        << "    -h, --help      Shows these help messages.\n"
+        << "    -v, --version   Shows version and license informations.\n"
+        << "\n"
+        << "    -o <file>       Writes the results to <file>.\n"
+        << "                    Default is stdout.\n"
+        << "    --output <file> Same as \"-o\"\n"
+        << "\n"
+        << "    --seconds N     Sets the length of audio.  default: 10\n"
+        << "    --frames N      Sets the length of video.  default: 100\n"
+        << "    --width N       Sets the width of video.  default: 640\n"
+        << "    --height N      Sets the height of video.  default: 480\n"
+        << "    --frame-cost N  Makes each frame take N microseconds\n"
+        << "                    to render.\n"
+        << "    --audio-cost N  Makes each read of audio take N\n"
+        << "                    microseconds.\n"
+        << "                    The costs need the stand-in of AviSynth\n"
+        << "                    in src/lib/standin.\n"
+        << "\n"
+        << "    -j N            Renders N frames in parallel in avs2bmp.\n"
+        << "                    Default is a number of processors.\n"
+        << "    --jobs N        Same as \"-j N\".\n"
+        << "    -r N            Takes the best of N measurements.\n"
+        << "                    default: 3\n"
+        << "    --repeat N      Same as \"-r N\".\n"
+        << "\n"
+        << "    --stats         Adds counts and latencies of calls into\n"
+        << "                    AviSynth during all measurements to the\n"
+        << "                    results as \"metrics\".\n"
+        << std::endl;
+}
@@ -0,0 +1,12 @@
+/*
+ * version.cpp
+ *  Version definitions for avsbench.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "avsbench.hpp"
+
+const char* version(void) { return "1.00"; }
+
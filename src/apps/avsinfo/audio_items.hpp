@@ -59,7 +59,7 @@ namespace avsinfo {
                 protected:
                     const char* header(void) const { return "bit depth"; }
                     const char* unit(void) const { return "bits"; }
-                    string_type BitDepth::value(const avsutil::audio_type::info_type& ai) const {
+                    string_type value(const avsutil::audio_type::info_type& ai) const {
                         return tconv().strfrom(ai.bit_depth);
                     }
             };
@@ -12,6 +12,7 @@
 #include "../../helper/typeconv.hpp"
 #include "../../helper/observer.hpp"
 
+#include <iomanip>
 #include <locale>
 
 namespace avsinfo {
@@ -27,21 +27,33 @@ int Main::main(void) {
         throw avsinfo_error(BAD_ARGUMENT, "Specify <inputfile>\n");
     }
 
-    if (video_items.empty() && audio_items.empty()) {
-        add_all_video_items(video_items);
-        add_all_audio_items(audio_items);
+    const bool is_all_shown = video_items.empty() && audio_items.empty();
+
+    if (is_stats_shown) enable_metrics(true);
+    if (!cachefile.empty()) {
+        manager().metadata_cache(cachefile.c_str(), is_refreshed);
     }
 
     // preparations
-    avs_type& avs = manager().load(inputfile.c_str());
+    avs_type& avs = manager().load_metadata(inputfile.c_str());
     if (!avs.is_fine()) {
         throw avsinfo_error(BAD_AVS, avs.errmsg());
     }
 
-    // video items
-    const video_type::info_type& video_info = avs.video().info();;
+    // Shows all of the streams that exist, since Y4M and WAV files have
+    // only one of them.
+    const video_type::info_type& video_info = avs.video_info();
+    const audio_type::info_type& audio_info = avs.audio_info();
+    if (is_all_shown) {
+        if (video_info.exists) add_all_video_items(video_items);
+        if (audio_info.exists) add_all_audio_items(audio_items);
+    }
 
-    if (video_info.exists) {
+    // video items
+    if (video_items.empty()) {
+        // nothing to do
+    }
+    else if (video_info.exists) {
         video_items.notation(is_human_friendly).output(cout, video_info);
     }
     else {
@@ -51,9 +63,10 @@ int Main::main(void) {
     }
 
     // audio items
-    const audio_type::info_type& audio_info = avs.audio().info();
-
-    if (audio_info.exists) {
+    if (audio_items.empty()) {
+        // nothing to do
+    }
+    else if (audio_info.exists) {
         audio_items.notation(is_human_friendly).output(cout, audio_info);
     }
     else {
@@ -62,6 +75,8 @@ int Main::main(void) {
                 "<inputfile> has no audio: " + inputfile);
     }
 
+    if (is_stats_shown) cerr << metrics() << flush;
+
     return OK;
 }
 
@@ -24,19 +24,20 @@
 #define OPT_OBJ_DECL(_name) opt_##_name##_type  opt_##_name
 
 #define OPT_VIDEO_ACTION(_name) \
-case OPT_##_name:   video_items.add_item(video::##_name); break
+case OPT_##_name:   video_items.add_item(video::_name); break
 
 #define OPT_AUDIO_ACTION(_name) \
-case OPT_##_name:   audio_items.add_item(audio::##_name); break
+case OPT_##_name:   audio_items.add_item(audio::_name); break
 
 #define REGISTER_OPT(_name)             \
 register_option(opt_##_name);           \
-opt_##_name##.add_event_listener(this)
+opt_##_name.add_event_listener(this)
 
 class Main
     : public util::getopt::getopt,
       public pattern::event::event_listener<priority_type>,
-      public pattern::event::event_listener<opt_event_type> {
+      public pattern::event::event_listener<opt_event_type>,
+      public pattern::event::event_listener<util::getopt::option::string_type> {
     private:
         // objects to handle options
         OPT_OBJ_DECL(version);
@@ -64,6 +65,9 @@ class Main
         OPT_OBJ_DECL(samplingrate);
         OPT_OBJ_DECL(samples);
         OPT_OBJ_DECL(blocksize);
+        OPT_OBJ_DECL(stats);
+        OPT_OBJ_DECL(cache);
+        OPT_OBJ_DECL(refresh);
 
         // a kind of priority action
         // default: UNSPECIFIED
@@ -73,6 +77,9 @@ class Main
         string_type inputfile;
         std::list<string_type> unknown_opt;
         bool is_human_friendly;
+        bool is_stats_shown;
+        string_type cachefile;
+        bool is_refreshed;
         avsinfo::items::VideoItems video_items;
         avsinfo::items::AudioItems audio_items;
 
@@ -100,11 +107,16 @@ class Main
         void handle_event(const priority_type& p) {
             if (priority == UNSPECIFIED) priority = p;
         }
+        void handle_event(const util::getopt::option::string_type& s) {
+            cachefile = s;
+        }
         void handle_event(const opt_event_type& e) {
             using namespace avsinfo::items;
             switch (e) {
                 case OPT_READABLE:  is_human_friendly = true;   break;
                 case OPT_MACHINE:   is_human_friendly = false;  break;
+                case OPT_STATS:     is_stats_shown = true;      break;
+                case OPT_REFRESH:   is_refreshed = true;        break;
                 case OPT_ALL:       add_all_video_items(video_items);
                                     add_all_audio_items(audio_items);
                                     break;
@@ -139,7 +151,9 @@ class Main
 
     public:
         // constructor
-        Main(void) : priority(UNSPECIFIED), is_human_friendly(true) {
+        Main(void)
+            : priority(UNSPECIFIED), is_human_friendly(true),
+              is_stats_shown(false), is_refreshed(false) {
             REGISTER_OPT(version);
             REGISTER_OPT(help);
             REGISTER_OPT(readable);
@@ -165,6 +179,9 @@ class Main
             REGISTER_OPT(samplingrate);
             REGISTER_OPT(samples);
             REGISTER_OPT(blocksize);
+            REGISTER_OPT(stats);
+            REGISTER_OPT(cache);
+            REGISTER_OPT(refresh);
         }
 
         // option analysis and error handling
@@ -19,6 +19,12 @@ enum opt_event_type {
     OPT_READABLE,
     OPT_MACHINE,
 
+    // an event to show metrics of the library
+    OPT_STATS,
+
+    // an event to import the script ignoring the cache
+    OPT_REFRESH,
+
     // events to specify items to show
     // packages
     OPT_ALL,
@@ -131,5 +137,31 @@ OPT_INDIVIDUAL_DECL(samplingrate,   OPT_SAMPLING_RATE);
 OPT_INDIVIDUAL_DECL(samples,        OPT_SAMPLES);
 OPT_INDIVIDUAL_DECL(blocksize,      OPT_BLOCK_SIZE);
 
+// an option to show metrics of the library
+OPT_INDIVIDUAL_DECL(stats,          OPT_STATS);
+
+// options for the cache of informations
+OPT_INDIVIDUAL_DECL(refresh,        OPT_REFRESH);
+
+class opt_cache_type
+    : public util::getopt::option,
+      public pattern::event::event_source<util::getopt::option::string_type> {
+    protected:
+        const char_type* longname(void) const { return "cache"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avsinfo_error(BAD_ARGUMENT,
+                        "Specify <cachefile>: " + current + "\n");
+            }
+
+            dispatch_event(*next);
+
+            return 2;
+        }
+};
+
 #endif // OPTION_HPP
 
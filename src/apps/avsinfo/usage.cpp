@@ -14,6 +14,9 @@ void usage(std::ostream& out) {
     out
         << "Usage: " << name() << " [options] <inputfile>\n"
         << "\n"
+        << "<inputfile> is an AviSynth script, or a YUV4MPEG2 (*.y4m) or\n"
+        << "RIFF WAV (*.wav) file that is read without AviSynth.\n"
+        << "\n"
         << "General options:\n"
         << "    -h, --help      Shows these help messages.\n"
         << "    -v, --version   Shows version and license informations.\n"
@@ -26,6 +29,16 @@ void usage(std::ostream& out) {
         << "                    Each header and unit (if exists) isn't shown\n"
         << "                    and also conversion for readability isn't done.\n"
         << "\n"
+        << "    --stats         Shows counts and latencies of calls into\n"
+        << "                    AviSynth to stderr at the end.\n"
+        << "\n"
+        << "    --cache <cachefile>\n"
+        << "                    Keeps informations of scripts in <cachefile>\n"
+        << "                    and shows them from it without importing\n"
+        << "                    <inputfile> while it is not modified.\n"
+        << "    --refresh       Imports <inputfile> even if <cachefile> has\n"
+        << "                    its informations, and updates them.\n"
+        << "\n"
         << "Options to specify items to show:\n"
         << "    -a, --all       Shows all of informations about the <inputfile>.\n"
         << "                    This is default value if you don't specify any options.\n"
@@ -24,12 +24,19 @@ int Main::main(void) {
         throw avslint_error(BAD_ARGUMENT, "Specify <inputfile>.\n");
     }
 
+    if (is_stats_shown) enable_metrics(true);
+    if (!cachefile.empty()) {
+        manager().metadata_cache(cachefile.c_str(), is_refreshed);
+    }
+
     // Do it
-    avs_type& avs = manager().load(inputfile.c_str());
+    avs_type& avs = manager().load_metadata(inputfile.c_str());
     if (!avs.is_fine()) {
         throw avslint_error(BAD_AVS, avs.errmsg());
     }
 
+    if (is_stats_shown) cerr << metrics() << flush;
+
     return OK;
 }
 
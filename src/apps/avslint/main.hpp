@@ -21,11 +21,16 @@
 
 class Main :
 public util::getopt::getopt,
-public pattern::event::event_listener<priority_type> {
+public pattern::event::event_listener<priority_type>,
+public pattern::event::event_listener<opt_event_type>,
+public pattern::event::event_listener<util::getopt::option::string_type> {
     private:
         // objects to handle options
         opt_version_type    opt_version;
         opt_help_type       opt_help;
+        opt_stats_type      opt_stats;
+        opt_cache_type      opt_cache;
+        opt_refresh_type    opt_refresh;
 
         // a kind of priority action
         // default: UNSPECIFIED
@@ -34,6 +39,9 @@ public pattern::event::event_listener<priority_type> {
         // member variables
         string_type inputfile;
         std::list<string_type> unknown_opt;
+        bool is_stats_shown;
+        string_type cachefile;
+        bool is_refreshed;
 
     protected:
         // implementations for virtual member functions of the super class
@@ -55,21 +63,41 @@ public pattern::event::event_listener<priority_type> {
         }
 
     public:
-        // event handler
+        // event handlers
         void handle_event(const priority_type& p) {
             if (priority == UNSPECIFIED) priority = p;
         }
+        void handle_event(const util::getopt::option::string_type& s) {
+            cachefile = s;
+        }
+        void handle_event(const opt_event_type& e) {
+            switch (e) {
+                case OPT_STATS:     is_stats_shown = true;
+                                    break;
+                case OPT_REFRESH:   is_refreshed = true;
+                                    break;
+                default:            throw std::logic_error("unknown error");
+            }
+        }
 
     public:
         // constructor
-        Main(void) : priority(UNSPECIFIED) {
+        Main(void)
+            : priority(UNSPECIFIED),
+              is_stats_shown(false), is_refreshed(false) {
             // register options
             register_option(opt_version);
             register_option(opt_help);
+            register_option(opt_stats);
+            register_option(opt_cache);
+            register_option(opt_refresh);
 
             // register event listeners
             opt_version.add_event_listener(this);
             opt_help.add_event_listener(this);
+            opt_stats.add_event_listener(this);
+            opt_cache.add_event_listener(this);
+            opt_refresh.add_event_listener(this);
         }
 
         // option analysis and error handling
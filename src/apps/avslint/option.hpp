@@ -14,6 +14,11 @@
 #include "../../helper/getopt.hpp"
 #include "../../helper/event.hpp"
 
+enum opt_event_type {
+    OPT_STATS,
+    OPT_REFRESH
+};
+
 // options
 class opt_version_type
     : public util::getopt::option,
@@ -39,5 +44,47 @@ class opt_help_type
         }
 };
 
+class opt_stats_type
+    : public util::getopt::option,
+      public pattern::event::event_source<opt_event_type> {
+    protected:
+        const char_type* longname(void) const { return "stats"; }
+        unsigned int handle_params(const parameters_type&) {
+            dispatch_event(OPT_STATS);
+            return 1;
+        }
+};
+
+class opt_cache_type
+    : public util::getopt::option,
+      public pattern::event::event_source<util::getopt::option::string_type> {
+    protected:
+        const char_type* longname(void) const { return "cache"; }
+        unsigned int handle_params(const parameters_type& params) {
+            parameters_type::const_iterator next = params.current() + 1;
+            const string_type& current = *(params.current());
+
+            if (next == params.end()) {
+                throw avslint_error(BAD_ARGUMENT,
+                        "Specify <cachefile>: " + current + "\n");
+            }
+
+            dispatch_event(*next);
+
+            return 2;
+        }
+};
+
+class opt_refresh_type
+    : public util::getopt::option,
+      public pattern::event::event_source<opt_event_type> {
+    protected:
+        const char_type* longname(void) const { return "refresh"; }
+        unsigned int handle_params(const parameters_type&) {
+            dispatch_event(OPT_REFRESH);
+            return 1;
+        }
+};
+
 #endif // OPTION_HPP
 
@@ -18,6 +18,14 @@ void usage(std::ostream& out) {
         << "Options:\n"
         << "    -h, --help      Shows these help messages.\n"
         << "    -v, --version   Shows version and license informations.\n"
+        << "    --stats         Shows counts and latencies of calls into\n"
+        << "                    AviSynth to stderr at the end.\n"
+        << "    --cache <cachefile>\n"
+        << "                    Keeps results of scripts in <cachefile>\n"
+        << "                    and answers from it without importing\n"
+        << "                    <inputfile> while it is not modified.\n"
+        << "    --refresh       Imports <inputfile> even if <cachefile> has\n"
+        << "                    its result, and updates it.\n"
         << std::endl;
 }
 
@@ -0,0 +1,57 @@
+/*
+ * clock.hpp
+ *  a monotonic clock that has nanosecond resolution
+ *
+ *  The clock is not affected by changes of the system time, so it suits to
+ *  measure intervals.  The origin is unspecified.  On Windows, this uses
+ *  QueryPerformanceCounter().  Otherwise, this uses clock_gettime(2) that
+ *  may need "-lrt" with old glibc:
+ *
+ *      > g++ -Wall --pedantic main.cpp -lrt
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#ifdef _MSC_VER
+#   include <windows.h>
+#else
+#   include <time.h>
+#endif
+
+/*
+ * TODO: Use "cstdint" when it is available.
+ * */
+#include <stdint.h>
+
+namespace util {
+    namespace time {
+        // Returns the current time of the monotonic clock in nanoseconds.
+        inline uint64_t monotonic_ns(void) {
+#ifdef _MSC_VER
+            // The frequency is fixed at boot, so it is asked only once.
+            static LARGE_INTEGER frequency = {0};
+            if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+
+            LARGE_INTEGER counter;
+            QueryPerformanceCounter(&counter);
+            // split to avoid the overflow of "counter * 1000000000"
+            const uint64_t count = counter.QuadPart;
+            const uint64_t freq = frequency.QuadPart;
+            return count / freq * 1000000000
+                + count % freq * 1000000000 / freq;
+#else
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+            return static_cast<uint64_t>(ts.tv_sec) * 1000000000
+                + ts.tv_nsec;
+#endif
+        }
+    }
+}
+
+#endif // CLOCK_HPP
+
@@ -0,0 +1,424 @@
+/*
+ * colorspace.hpp
+ *  functions to convert pixels from YUV to RGB
+ *
+ *  YUV is 8bit planar 4:2:0 (YV12, I420) or packed 4:2:2 (YUY2), and RGB is
+ *  8bit packed in the order of B, G, R (and A for 32bit) in memory, as well
+ *  as AviSynth and BMP.  Chroma samples are upsampled by replication.
+ *
+ *  The pixels are calculated in fixed point numbers with 13 fractional
+ *  bits.  to_bgra() uses SSE2 and AVX2 when the compiler targets them, and
+ *  gives the same results as to_bgra_scalar() bit for bit.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef COLORSPACE_HPP
+#define COLORSPACE_HPP
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define COLORSPACE_USE_SSE2
+#   include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#   define COLORSPACE_USE_AVX2
+#   include <immintrin.h>
+#endif
+
+namespace util {
+    namespace colorspace {
+        enum matrix_type {
+            BT601,  // SDTV
+            BT709   // HDTV
+        };
+
+        enum range_type {
+            TV_RANGE,   // Y: 16-235, U and V: 16-240
+            PC_RANGE    // 0-255
+        };
+
+        // coefficients of the conversion
+        struct coefficients_type {
+            static const int shift = 13;
+
+            int16_t y_offset;
+            int16_t y;      // for all of R, G and B
+            int16_t rv;
+            int16_t gu;     // negative
+            int16_t gv;     // negative
+            int16_t bu;
+
+            // constructor
+            coefficients_type(const matrix_type matrix,
+                              const range_type range) {
+                const double kr = (matrix == BT709) ? 0.2126 : 0.299;
+                const double kb = (matrix == BT709) ? 0.0722 : 0.114;
+                const double kg = 1.0 - kr - kb;
+                const double ys = (range == TV_RANGE) ? 255.0 / 219 : 1.0;
+                const double cs = (range == TV_RANGE) ? 255.0 / 224 : 1.0;
+
+                y_offset = (range == TV_RANGE) ? 16 : 0;
+                y  = fixed(ys);
+                rv = fixed(cs * 2 * (1 - kr));
+                gu = fixed(-cs * 2 * (1 - kb) * kb / kg);
+                gv = fixed(-cs * 2 * (1 - kr) * kr / kg);
+                bu = fixed(cs * 2 * (1 - kb));
+            }
+
+            static int16_t fixed(const double v) {
+                const double scaled = v * (1 << shift);
+                return static_cast<int16_t>(
+                        scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+            }
+        };
+
+        namespace detail {
+            inline uint8_t clamp(const int v) {
+                return static_cast<uint8_t>(v < 0 ? 0 : (255 < v ? 255 : v));
+            }
+        }
+
+        /*
+         *  Converts "width" pixels of Y, U and V in full resolution to BGRA.
+         *  This is the reference implementation of to_bgra().
+         * */
+        inline void to_bgra_scalar( const uint8_t* y, const uint8_t* u,
+                                    const uint8_t* v, uint8_t* bgra,
+                                    const std::size_t width,
+                                    const coefficients_type& k) {
+            const int round = 1 << (coefficients_type::shift - 1);
+            for (std::size_t i = 0; i < width; ++i, bgra += 4) {
+                const int yy = (y[i] - k.y_offset) * k.y + round;
+                const int uu = u[i] - 128;
+                const int vv = v[i] - 128;
+                bgra[0] = detail::clamp(
+                        (yy + k.bu * uu) >> coefficients_type::shift);
+                bgra[1] = detail::clamp(
+                        (yy + k.gu * uu + k.gv * vv)
+                            >> coefficients_type::shift);
+                bgra[2] = detail::clamp(
+                        (yy + k.rv * vv) >> coefficients_type::shift);
+                bgra[3] = 0xff;
+            }
+        }
+
+        namespace detail {
+            /*
+             *  Vectorized kernels.  Each of them converts as many pixels as
+             *  it can handle at a time and returns the number of converted
+             *  pixels.
+             * */
+#ifdef COLORSPACE_USE_SSE2
+            inline std::size_t to_bgra_sse2(const uint8_t* y, const uint8_t* u,
+                                            const uint8_t* v, uint8_t* bgra,
+                                            const std::size_t width,
+                                            const coefficients_type& k) {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i alpha = _mm_set1_epi8(static_cast<char>(0xff));
+                const __m128i round =
+                    _mm_set1_epi32(1 << (coefficients_type::shift - 1));
+                const __m128i y_offset = _mm_set1_epi16(k.y_offset);
+                const __m128i c_offset = _mm_set1_epi16(128);
+                // pairs of coefficients for _mm_madd_epi16()
+                const __m128i ky_bu = _mm_set_epi16(
+                        k.bu, k.y, k.bu, k.y, k.bu, k.y, k.bu, k.y);
+                const __m128i ky_gu = _mm_set_epi16(
+                        k.gu, k.y, k.gu, k.y, k.gu, k.y, k.gu, k.y);
+                const __m128i ky_rv = _mm_set_epi16(
+                        k.rv, k.y, k.rv, k.y, k.rv, k.y, k.rv, k.y);
+                const __m128i kgv = _mm_set_epi16(
+                        0, k.gv, 0, k.gv, 0, k.gv, 0, k.gv);
+
+                std::size_t i = 0;
+                for (; i + 8 <= width; i += 8, bgra += 32) {
+                    const __m128i yy = _mm_sub_epi16(_mm_unpacklo_epi8(
+                                _mm_loadl_epi64(
+                                    reinterpret_cast<const __m128i*>(y + i)),
+                                zero), y_offset);
+                    const __m128i uu = _mm_sub_epi16(_mm_unpacklo_epi8(
+                                _mm_loadl_epi64(
+                                    reinterpret_cast<const __m128i*>(u + i)),
+                                zero), c_offset);
+                    const __m128i vv = _mm_sub_epi16(_mm_unpacklo_epi8(
+                                _mm_loadl_epi64(
+                                    reinterpret_cast<const __m128i*>(v + i)),
+                                zero), c_offset);
+
+                    const __m128i yu_lo = _mm_unpacklo_epi16(yy, uu);
+                    const __m128i yu_hi = _mm_unpackhi_epi16(yy, uu);
+                    const __m128i yv_lo = _mm_unpacklo_epi16(yy, vv);
+                    const __m128i yv_hi = _mm_unpackhi_epi16(yy, vv);
+                    const __m128i v_lo = _mm_unpacklo_epi16(vv, zero);
+                    const __m128i v_hi = _mm_unpackhi_epi16(vv, zero);
+
+#   define COLORSPACE_DESCALE(x) \
+                    _mm_srai_epi32(_mm_add_epi32((x), round), \
+                            coefficients_type::shift)
+                    const __m128i b = _mm_packs_epi32(
+                            COLORSPACE_DESCALE(_mm_madd_epi16(yu_lo, ky_bu)),
+                            COLORSPACE_DESCALE(_mm_madd_epi16(yu_hi, ky_bu)));
+                    const __m128i g = _mm_packs_epi32(
+                            COLORSPACE_DESCALE(_mm_add_epi32(
+                                    _mm_madd_epi16(yu_lo, ky_gu),
+                                    _mm_madd_epi16(v_lo, kgv))),
+                            COLORSPACE_DESCALE(_mm_add_epi32(
+                                    _mm_madd_epi16(yu_hi, ky_gu),
+                                    _mm_madd_epi16(v_hi, kgv))));
+                    const __m128i r = _mm_packs_epi32(
+                            COLORSPACE_DESCALE(_mm_madd_epi16(yv_lo, ky_rv)),
+                            COLORSPACE_DESCALE(_mm_madd_epi16(yv_hi, ky_rv)));
+#   undef COLORSPACE_DESCALE
+
+                    const __m128i bg = _mm_unpacklo_epi8(
+                            _mm_packus_epi16(b, b), _mm_packus_epi16(g, g));
+                    const __m128i ra = _mm_unpacklo_epi8(
+                            _mm_packus_epi16(r, r), alpha);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra),
+                            _mm_unpacklo_epi16(bg, ra));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(bgra + 16),
+                            _mm_unpackhi_epi16(bg, ra));
+                }
+                return i;
+            }
+#endif // COLORSPACE_USE_SSE2
+
+#ifdef COLORSPACE_USE_AVX2
+            // Returns "lo" and "hi" packed in 32bit for _mm256_madd_epi16().
+            inline int pair(const int16_t lo, const int16_t hi) {
+                return static_cast<int>(
+                          static_cast<uint32_t>(static_cast<uint16_t>(lo))
+                        | (static_cast<uint32_t>(static_cast<uint16_t>(hi))
+                            << 16));
+            }
+
+            inline std::size_t to_bgra_avx2(const uint8_t* y, const uint8_t* u,
+                                            const uint8_t* v, uint8_t* bgra,
+                                            const std::size_t width,
+                                            const coefficients_type& k) {
+                const __m256i zero = _mm256_setzero_si256();
+                const __m256i alpha =
+                    _mm256_set1_epi8(static_cast<char>(0xff));
+                const __m256i round =
+                    _mm256_set1_epi32(1 << (coefficients_type::shift - 1));
+                const __m256i y_offset = _mm256_set1_epi16(k.y_offset);
+                const __m256i c_offset = _mm256_set1_epi16(128);
+                // pairs of coefficients for _mm256_madd_epi16()
+                const __m256i ky_bu = _mm256_set1_epi32(pair(k.y, k.bu));
+                const __m256i ky_gu = _mm256_set1_epi32(pair(k.y, k.gu));
+                const __m256i ky_rv = _mm256_set1_epi32(pair(k.y, k.rv));
+                const __m256i kgv = _mm256_set1_epi32(pair(k.gv, 0));
+
+                std::size_t i = 0;
+                for (; i + 16 <= width; i += 16, bgra += 64) {
+                    const __m256i yy = _mm256_sub_epi16(_mm256_cvtepu8_epi16(
+                                _mm_loadu_si128(
+                                    reinterpret_cast<const __m128i*>(y + i))),
+                                y_offset);
+                    const __m256i uu = _mm256_sub_epi16(_mm256_cvtepu8_epi16(
+                                _mm_loadu_si128(
+                                    reinterpret_cast<const __m128i*>(u + i))),
+                                c_offset);
+                    const __m256i vv = _mm256_sub_epi16(_mm256_cvtepu8_epi16(
+                                _mm_loadu_si128(
+                                    reinterpret_cast<const __m128i*>(v + i))),
+                                c_offset);
+
+                    // unpack and pack work in each 128bit lane, so the order
+                    // of pixels is kept through them.
+                    const __m256i yu_lo = _mm256_unpacklo_epi16(yy, uu);
+                    const __m256i yu_hi = _mm256_unpackhi_epi16(yy, uu);
+                    const __m256i yv_lo = _mm256_unpacklo_epi16(yy, vv);
+                    const __m256i yv_hi = _mm256_unpackhi_epi16(yy, vv);
+                    const __m256i v_lo = _mm256_unpacklo_epi16(vv, zero);
+                    const __m256i v_hi = _mm256_unpackhi_epi16(vv, zero);
+
+#   define COLORSPACE_DESCALE(x) \
+                    _mm256_srai_epi32(_mm256_add_epi32((x), round), \
+                            coefficients_type::shift)
+                    const __m256i b = _mm256_packs_epi32(
+                            COLORSPACE_DESCALE(_mm256_madd_epi16(yu_lo, ky_bu)),
+                            COLORSPACE_DESCALE(_mm256_madd_epi16(yu_hi, ky_bu)));
+                    const __m256i g = _mm256_packs_epi32(
+                            COLORSPACE_DESCALE(_mm256_add_epi32(
+                                    _mm256_madd_epi16(yu_lo, ky_gu),
+                                    _mm256_madd_epi16(v_lo, kgv))),
+                            COLORSPACE_DESCALE(_mm256_add_epi32(
+                                    _mm256_madd_epi16(yu_hi, ky_gu),
+                                    _mm256_madd_epi16(v_hi, kgv))));
+                    const __m256i r = _mm256_packs_epi32(
+                            COLORSPACE_DESCALE(_mm256_madd_epi16(yv_lo, ky_rv)),
+                            COLORSPACE_DESCALE(_mm256_madd_epi16(yv_hi, ky_rv)));
+#   undef COLORSPACE_DESCALE
+
+                    const __m256i bg = _mm256_unpacklo_epi8(
+                            _mm256_packus_epi16(b, b),
+                            _mm256_packus_epi16(g, g));
+                    const __m256i ra = _mm256_unpacklo_epi8(
+                            _mm256_packus_epi16(r, r), alpha);
+                    const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+                    const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(bgra),
+                            _mm256_permute2x128_si256(lo, hi, 0x20));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(bgra + 32),
+                            _mm256_permute2x128_si256(lo, hi, 0x31));
+                }
+                return i;
+            }
+#endif // COLORSPACE_USE_AVX2
+        }
+
+        // The same as to_bgra_scalar(), but faster.
+        inline void to_bgra(const uint8_t* y, const uint8_t* u,
+                            const uint8_t* v, uint8_t* bgra,
+                            const std::size_t width,
+                            const coefficients_type& k) {
+            std::size_t done = 0;
+#if defined(COLORSPACE_USE_AVX2)
+            done = detail::to_bgra_avx2(y, u, v, bgra, width, k);
+#elif defined(COLORSPACE_USE_SSE2)
+            done = detail::to_bgra_sse2(y, u, v, bgra, width, k);
+#endif
+            to_bgra_scalar(y + done, u + done, v + done, bgra + done * 4,
+                           width - done, k);
+        }
+
+        /*
+         *  A class to convert frames.  This keeps buffers for a row, so an
+         *  object should be reused for frames of the same size.
+         *
+         *  "bytes" of the destination is 3 for RGB24 and 4 for RGB32.  When
+         *  "is_bottom_up" is true, the first row of the destination is the
+         *  bottom of the picture, as well as RGB of AviSynth.
+         * */
+        class converter {
+            private:
+                coefficients_type mv_k;
+                std::vector<uint8_t> mv_y;
+                std::vector<uint8_t> mv_u;
+                std::vector<uint8_t> mv_v;
+                std::vector<uint8_t> mv_bgra;
+
+            public:
+                // constructor
+                converter(const matrix_type matrix, const range_type range)
+                    : mv_k(matrix, range) {}
+
+            public:
+                // planar 4:2:0
+                void from_yv12(
+                        const uint8_t* y, const std::ptrdiff_t y_pitch,
+                        const uint8_t* u, const std::ptrdiff_t u_pitch,
+                        const uint8_t* v, const std::ptrdiff_t v_pitch,
+                        const std::size_t width, const std::size_t height,
+                        uint8_t* dst, const std::ptrdiff_t dst_pitch,
+                        const unsigned int bytes, const bool is_bottom_up) {
+                    reserve(width, bytes);
+                    for (std::size_t row = 0; row < height; ++row) {
+                        const uint8_t* const cu = u + (row / 2) * u_pitch;
+                        const uint8_t* const cv = v + (row / 2) * v_pitch;
+                        for (std::size_t x = 0; x < width; ++x) {
+                            mv_u[x] = cu[x / 2];
+                            mv_v[x] = cv[x / 2];
+                        }
+                        write_row(y + row * y_pitch, width,
+                                  target(dst, dst_pitch, height, row,
+                                         is_bottom_up),
+                                  bytes);
+                    }
+                }
+
+                // packed 4:2:2, Y0 U0 Y1 V0 Y2 U2 Y3 V2 ...
+                void from_yuy2(
+                        const uint8_t* src, const std::ptrdiff_t src_pitch,
+                        const std::size_t width, const std::size_t height,
+                        uint8_t* dst, const std::ptrdiff_t dst_pitch,
+                        const unsigned int bytes, const bool is_bottom_up) {
+                    reserve(width, bytes);
+                    for (std::size_t row = 0; row < height; ++row) {
+                        const uint8_t* const s = src + row * src_pitch;
+                        for (std::size_t x = 0; x < width; ++x) {
+                            mv_y[x] = s[x * 2];
+                            mv_u[x] = s[(x & ~1) * 2 + 1];
+                            mv_v[x] = s[(x & ~1) * 2 + 3];
+                        }
+                        write_row(&mv_y[0], width,
+                                  target(dst, dst_pitch, height, row,
+                                         is_bottom_up),
+                                  bytes);
+                    }
+                }
+
+            private:
+                void reserve(const std::size_t width, const unsigned int bytes) {
+                    if (mv_u.size() < width) {
+                        mv_y.resize(width);
+                        mv_u.resize(width);
+                        mv_v.resize(width);
+                    }
+                    if (bytes == 3 && mv_bgra.size() < width * 4) {
+                        mv_bgra.resize(width * 4);
+                    }
+                }
+
+                static uint8_t* target(
+                        uint8_t* dst, const std::ptrdiff_t dst_pitch,
+                        const std::size_t height, const std::size_t row,
+                        const bool is_bottom_up) {
+                    return dst + dst_pitch * static_cast<std::ptrdiff_t>(
+                            is_bottom_up ? height - 1 - row : row);
+                }
+
+                void write_row( const uint8_t* y, const std::size_t width,
+                                uint8_t* dst, const unsigned int bytes) {
+                    if (bytes == 4) {
+                        to_bgra(y, &mv_u[0], &mv_v[0], dst, width, mv_k);
+                        return;
+                    }
+
+                    to_bgra(y, &mv_u[0], &mv_v[0], &mv_bgra[0], width, mv_k);
+                    const uint8_t* s = &mv_bgra[0];
+                    for (std::size_t x = 0; x < width; ++x, s += 4, dst += 3) {
+                        dst[0] = s[0];
+                        dst[1] = s[1];
+                        dst[2] = s[2];
+                    }
+                }
+        };
+
+        /*
+         *  Copies packed RGB changing bytes per pixel between 3 and 4, or
+         *  as it is.  The orientation is kept.
+         * */
+        inline void repack_rgb(
+                const uint8_t* src, const std::ptrdiff_t src_pitch,
+                const unsigned int src_bytes,
+                const std::size_t width, const std::size_t height,
+                uint8_t* dst, const std::ptrdiff_t dst_pitch,
+                const unsigned int bytes) {
+            for (std::size_t row = 0; row < height; ++row) {
+                const uint8_t* s = src + row * src_pitch;
+                uint8_t* d = dst + row * dst_pitch;
+                if (src_bytes == bytes) {
+                    std::memcpy(d, s, width * bytes);
+                    continue;
+                }
+                for (std::size_t x = 0; x < width;
+                        ++x, s += src_bytes, d += bytes) {
+                    d[0] = s[0];
+                    d[1] = s[1];
+                    d[2] = s[2];
+                    if (bytes == 4) d[3] = 0xff;
+                }
+            }
+        }
+    }
+}
+
+#endif // COLORSPACE_HPP
@@ -2,7 +2,23 @@
  * dlogger.hpp
  *  the macros and classes to log for debugging
  *
- *  In order to disable, define the symbol NDEBUG:
+ *  Each thread puts records into its own ring buffer without locks, and a
+ *  background thread writes them to "debug.log" in batches.  A message is
+ *  formatted only when its level is enabled, and the rest of the line (the
+ *  time, the thread, the level and the place) is formatted by the
+ *  background thread.  A thread that finds its ring full writes the
+ *  records by itself, so no record is lost.
+ *
+ *      TRCLOG("seekoff(" << off << ")");
+ *      DBGLOG("frame " << n);
+ *      util::log::dlogger::instance().threshold(util::log::INFO_LEVEL);
+ *
+ *  Levels below DLOGGER_LEVEL are removed at compile time.  It is 1
+ *  (DEBUG_LEVEL) by default, so TRCLOG is enabled by:
+ *
+ *      > g++ -Wall --pedantic -pthread -DDLOGGER_LEVEL=0 main.cpp
+ *
+ *  In order to disable all, define the symbol NDEBUG:
  *
  *      > g++ -Wall --pedantic -DNDEBUG main.cpp
  *      > cl /EHsc /W4 /Za /DNDEBUG main.cpp
@@ -14,47 +30,343 @@
 #ifndef DLOGGER_HPP
 #define DLOGGER_HPP
 
+#ifndef DLOGGER_LEVEL
+#   define DLOGGER_LEVEL 1
+#endif
+
 // typical tricks
 #ifndef NDEBUG
-#   define DBGLOG(str)  (util::log::dflogger::logger()              \
-                            << __FILE__ << "(" << __LINE__ << "): " \
-                            << str << std::endl)
-#   define WDBGLOG(str) (util::log::wdflogger::logger()             \
-                            << __FILE__ << "(" << __LINE__ << "): " \
-                            << str << std::endl)
+#   define DLOG(level, str)                                             \
+    do {                                                                \
+        if (util::log::dlogger::instance().is_enabled(level)) {         \
+            std::ostringstream dlogger_message_;                        \
+            dlogger_message_ << str;                                    \
+            util::log::dlogger::instance().put(                         \
+                    level, __FILE__, __LINE__, dlogger_message_);       \
+        }                                                               \
+    } while (false)
+#else
+#   define DLOG(level, str)
+#endif
+
+#if !defined(NDEBUG) && DLOGGER_LEVEL <= 0
+#   define TRCLOG(str)  DLOG(util::log::TRACE_LEVEL, str)
+#else
+#   define TRCLOG(str)
+#endif
+#if !defined(NDEBUG) && DLOGGER_LEVEL <= 1
+#   define DBGLOG(str)  DLOG(util::log::DEBUG_LEVEL, str)
 #else
 #   define DBGLOG(str)
-#   define WDBGLOG(str)
+#endif
+#if !defined(NDEBUG) && DLOGGER_LEVEL <= 2
+#   define INFLOG(str)  DLOG(util::log::INFO_LEVEL, str)
+#else
+#   define INFLOG(str)
+#endif
+#if !defined(NDEBUG) && DLOGGER_LEVEL <= 3
+#   define WRNLOG(str)  DLOG(util::log::WARN_LEVEL, str)
+#else
+#   define WRNLOG(str)
+#endif
+#if !defined(NDEBUG) && DLOGGER_LEVEL <= 4
+#   define ERRLOG(str)  DLOG(util::log::ERROR_LEVEL, str)
+#else
+#   define ERRLOG(str)
 #endif
 
 // class definition
 #ifndef NDEBUG
 
+#include <algorithm>
 #include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * TODO: Use "cstdint" when it is available.
+ * */
+#include <stdint.h>
+
+#include "clock.hpp"
+#include "thread.hpp"
 
 namespace util {
     namespace log {
-        // In order to be used without building object,
-        // this class has only typedefs and static functions.
-        template<typename Char>
-            struct basic_dflogger {
-                // typedefs
-                typedef Char                            char_type;
-                typedef std::basic_ofstream<char_type>  ofstream_type;
-
-                // static functions
+        enum level_type {
+            TRACE_LEVEL,
+            DEBUG_LEVEL,
+            INFO_LEVEL,
+            WARN_LEVEL,
+            ERROR_LEVEL
+        };
+
+        class dlogger {
+            private:
+                struct record_type {
+                    level_type level;
+                    const char* file;
+                    unsigned int line;
+                    unsigned int thread;    // set by the flusher
+                    uint64_t time;
+                    std::string message;
+                };
+
+                /*
+                 *  A ring buffer that is written by one thread and read by
+                 *  the flusher.  "head" is advanced only by the owner and
+                 *  "tail" only by the flusher.  The ring of a thread that
+                 *  has exited is given to a new thread after it is drained.
+                 * */
+                struct ring_type {
+                    std::vector<record_type> records;
+                    unsigned int id;
+                    volatile uint32_t head;
+                    volatile uint32_t tail;
+                    volatile bool is_orphaned;  // the owner has exited
+                    bool is_free;               // guarded by "lock"
+                };
+
+                class flusher : public util::thread::thread {
+                    private:
+                        dlogger& owner;
+
+                    public:
+                        explicit flusher(dlogger& owner) : owner(owner) {}
+
+                    private:
+                        // copy constructor
+                        flusher(const flusher& rhs);
+                        // assignment operator
+                        flusher& operator=(const flusher& rhs);
+
+                    protected:
+                        void run(void) { owner.work(); }
+                };
+
+                // constants
+                // a number of records in a ring, a power of 2
+                static const uint32_t ring_size = 1024;
+                // an interval to write records in milliseconds
+                static const unsigned int interval = 100;
+
+            private:
+                // variables
+                volatile int mv_threshold;
+                const uint64_t origin;
+                std::auto_ptr<util::thread::specific_ptr> mine;
+
+                // the following variables are guarded by "lock"
+                util::thread::mutex lock;
+                util::thread::condition cond;
+                std::ofstream out;
+                std::vector<ring_type*> rings;
+                std::vector<record_type> batch;
+                bool is_stopping;
+                flusher mv_flusher;
+
+            public:
+                // constructor
+                dlogger(void)
+                    : mv_threshold(TRACE_LEVEL),
+                      origin(util::time::monotonic_ns()),
+                      mine(new util::thread::specific_ptr(release)),
+                      out(filename(), std::ios::out | std::ios::trunc),
+                      is_stopping(false),
+                      mv_flusher(*this) {}
+
+                // destructor
+                ~dlogger(void) {
+                    {
+                        util::thread::scoped_lock l(lock);
+                        is_stopping = true;
+                        cond.notify_all();
+                    }
+                    mv_flusher.join();
+
+                    util::thread::scoped_lock l(lock);
+                    drain();
+                    // No ring is released after this.
+                    mine.reset();
+                    for (std::vector<ring_type*>::iterator itr = rings.begin();
+                            itr != rings.end(); ++itr) {
+                        delete *itr;
+                    }
+                }
+
+            private:
+                // copy constructor
+                dlogger(const dlogger& rhs);
+                // assignment operator
+                dlogger& operator=(const dlogger& rhs);
+
+            public:
                 // fixed filename
                 static const char* filename(void) { return "debug.log"; }
-                static ofstream_type& logger(void) {
-                    static ofstream_type logger(filename(),
-                            std::ios::out | std::ios::trunc);
+
+                // Local static variables are not initialized in a
+                // thread-safe way with some compilers, so the first record
+                // should be put before threads are started.
+                static dlogger& instance(void) {
+                    static dlogger logger;
                     return logger;
                 }
-            };
 
-        // for convenience
-        typedef basic_dflogger<char>     dflogger;
-        typedef basic_dflogger<wchar_t>  wdflogger;
+                // Records below "level" are not formatted nor written.
+                void threshold(level_type level) { mv_threshold = level; }
+                level_type threshold(void) const {
+                    return static_cast<level_type>(mv_threshold);
+                }
+                bool is_enabled(level_type level) const {
+                    return level >= mv_threshold;
+                }
+
+                // Puts a record into the ring of the calling thread.
+                void put(   level_type level,
+                            const char* file, unsigned int line,
+                            const std::ostringstream& message) {
+                    ring_type* ring = static_cast<ring_type*>(mine->get());
+                    if (ring == NULL) ring = attach();
+
+                    const uint32_t head = ring->head;
+                    uint32_t used = head - ring->tail;
+                    if (used >= ring_size) {
+                        flush();
+                        used = 0;
+                    }
+
+                    record_type& record =
+                        ring->records[head & (ring_size - 1)];
+                    record.level = level;
+                    record.file = file;
+                    record.line = line;
+                    record.time = util::time::monotonic_ns();
+                    record.message = message.str();
+                    // The record has to be visible before "head".
+                    util::thread::memory_barrier();
+                    ring->head = head + 1;
+
+                    // Wake the flusher up early when the ring fills up.
+                    if (used + 1 == ring_size / 2) cond.notify_one();
+                }
+
+                // Writes all records put already.
+                void flush(void) {
+                    util::thread::scoped_lock l(lock);
+                    drain();
+                }
+
+            private:
+                // Gives a ring to the calling thread.
+                ring_type* attach(void) {
+                    util::thread::scoped_lock l(lock);
+                    ring_type* ring = NULL;
+                    for (std::vector<ring_type*>::iterator itr = rings.begin();
+                            itr != rings.end(); ++itr) {
+                        if ((*itr)->is_free) {
+                            ring = *itr;
+                            break;
+                        }
+                    }
+                    if (ring == NULL) {
+                        std::auto_ptr<ring_type> created(new ring_type());
+                        created->records.resize(ring_size);
+                        created->id = static_cast<unsigned int>(rings.size());
+                        created->head = created->tail = 0;
+                        rings.push_back(created.get());
+                        ring = created.release();
+                    }
+                    ring->is_orphaned = false;
+                    ring->is_free = false;
+                    mine->set(ring);
+
+                    if (!mv_flusher.is_started()) mv_flusher.start();
+                    return ring;
+                }
+
+                // called when a thread that has a ring exits
+#ifdef _MSC_VER
+                static void __stdcall release(void* p) {
+#else
+                static void release(void* p) {
+#endif
+                    // The records have to be visible before the flag.
+                    util::thread::memory_barrier();
+                    static_cast<ring_type*>(p)->is_orphaned = true;
+                }
+
+                // The procedure of the flusher.
+                void work(void) {
+                    util::thread::scoped_lock l(lock);
+                    while (!is_stopping) {
+                        drain();
+                        cond.wait_for(lock, interval);
+                    }
+                }
+
+                // Writes records in all rings in order of time.
+                // This must be called with "lock" locked.
+                void drain(void) {
+                    for (std::vector<ring_type*>::iterator itr = rings.begin();
+                            itr != rings.end(); ++itr) {
+                        ring_type& ring = **itr;
+                        if (ring.is_free) continue;
+
+                        const bool is_orphaned = ring.is_orphaned;
+                        util::thread::memory_barrier();
+                        const uint32_t head = ring.head;
+                        util::thread::memory_barrier();
+                        for (uint32_t i = ring.tail; i != head; ++i) {
+                            record_type& record =
+                                ring.records[i & (ring_size - 1)];
+                            batch.push_back(record_type());
+                            batch.back().level = record.level;
+                            batch.back().file = record.file;
+                            batch.back().line = record.line;
+                            batch.back().thread = ring.id;
+                            batch.back().time = record.time;
+                            batch.back().message.swap(record.message);
+                        }
+                        // The records have to be read before "tail".
+                        util::thread::memory_barrier();
+                        ring.tail = head;
+
+                        if (is_orphaned) ring.is_free = true;
+                    }
+                    if (batch.empty()) return;
+
+                    std::stable_sort(batch.begin(), batch.end(), is_earlier);
+                    for (std::vector<record_type>::const_iterator itr =
+                                batch.begin();
+                            itr != batch.end(); ++itr) {
+                        out << (itr->time - origin) / 1000 << "us "
+                            << "[" << itr->thread << "] "
+                            << name(itr->level) << " "
+                            << itr->file << "(" << itr->line << "): "
+                            << itr->message << '\n';
+                    }
+                    out.flush();
+                    batch.clear();
+                }
+
+                static bool is_earlier( const record_type& lhs,
+                                        const record_type& rhs) {
+                    return lhs.time < rhs.time;
+                }
+
+                static const char* name(level_type level) {
+                    switch (level) {
+                        case TRACE_LEVEL:   return "TRACE";
+                        case DEBUG_LEVEL:   return "DEBUG";
+                        case INFO_LEVEL:    return "INFO";
+                        case WARN_LEVEL:    return "WARN";
+                        case ERROR_LEVEL:   return "ERROR";
+                        default:            return "?";
+                    }
+                }
+        };
     }
 }
 
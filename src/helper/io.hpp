@@ -9,7 +9,7 @@
 #ifndef IO_HPP
 #define IO_HPP
 
-#include <cstdio>       // for isatty(1) or _fileno(1)
+#include <cstdio>       // for isatty(1), _fileno(1), fdopen(2)
 
 #ifdef _MSC_VER
 #   include <io.h>      // for _isatty(1), _setmode(2)
@@ -32,6 +32,16 @@ namespace util {
         inline void set_stdout_binary(void) {
 #ifdef _MSC_VER
             _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        }
+
+        // Returns a FILE object to write to the file descriptor "fd", or
+        // NULL if "fd" is not open.
+        inline std::FILE* open_fd(int fd) {
+#ifdef _MSC_VER
+            return _fdopen(fd, "w");
+#else
+            return fdopen(fd, "w");
 #endif
         }
     }
@@ -0,0 +1,143 @@
+/*
+ * mmap.hpp
+ *  a class to map a whole file into memory to read
+ *
+ *  The pages are read by the OS when they are touched, and the file is not
+ *  copied into a buffer of the process.  On Windows, this uses
+ *  CreateFileMapping().  Otherwise, this uses mmap(2).
+ *
+ *      util::io::mapped_file file;
+ *      if (file.open("data.bin")) {
+ *          const uint8_t* p = file.data();
+ *          // read file.size() bytes from p
+ *      }
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef MMAP_HPP
+#define MMAP_HPP
+
+#ifdef _MSC_VER
+#   include <windows.h>
+#else
+#   include <fcntl.h>
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <unistd.h>
+#endif
+
+#include <cstddef>
+
+/*
+ * TODO: Use "cstdint" when it is available.
+ * */
+#include <stdint.h>
+
+namespace util {
+    namespace io {
+        class mapped_file {
+            private:
+                const uint8_t* mv_data;
+                std::size_t mv_size;
+
+            public:
+                // constructor
+                mapped_file(void) : mv_data(NULL), mv_size(0) {}
+
+                // destructor
+                ~mapped_file(void) { close(); }
+
+            private:
+                // copy constructor
+                mapped_file(const mapped_file& rhs);
+                // assignment operator
+                mapped_file& operator=(const mapped_file& rhs);
+
+            public:
+                /*
+                 *  Maps the file located on "filepath".  Returns false if it
+                 *  can't be opened or is too large for the address space.
+                 *  An empty file is opened with data() NULL.
+                 * */
+                bool open(const char* filepath) {
+                    close();
+#ifdef _MSC_VER
+                    HANDLE file = CreateFileA(
+                            filepath, GENERIC_READ,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+                    if (file == INVALID_HANDLE_VALUE) return false;
+
+                    LARGE_INTEGER size;
+                    if (       !GetFileSizeEx(file, &size)
+                            || static_cast<uint64_t>(size.QuadPart)
+                                > static_cast<std::size_t>(-1)) {
+                        CloseHandle(file);
+                        return false;
+                    }
+                    if (size.QuadPart == 0) {
+                        CloseHandle(file);
+                        return true;
+                    }
+
+                    // The view keeps the mapping and the file open.
+                    HANDLE mapping = CreateFileMappingA(
+                            file, NULL, PAGE_READONLY, 0, 0, NULL);
+                    CloseHandle(file);
+                    if (mapping == NULL) return false;
+                    void* view = MapViewOfFile(
+                            mapping, FILE_MAP_READ, 0, 0, 0);
+                    CloseHandle(mapping);
+                    if (view == NULL) return false;
+
+                    mv_data = static_cast<const uint8_t*>(view);
+                    mv_size = static_cast<std::size_t>(size.QuadPart);
+#else
+                    const int fd = ::open(filepath, O_RDONLY);
+                    if (fd < 0) return false;
+
+                    struct stat st;
+                    if (       fstat(fd, &st) != 0
+                            || static_cast<uint64_t>(st.st_size)
+                                > static_cast<std::size_t>(-1)) {
+                        ::close(fd);
+                        return false;
+                    }
+                    if (st.st_size == 0) {
+                        ::close(fd);
+                        return true;
+                    }
+
+                    // The mapping is kept after the descriptor is closed.
+                    void* view = mmap(
+                            NULL, static_cast<std::size_t>(st.st_size),
+                            PROT_READ, MAP_SHARED, fd, 0);
+                    ::close(fd);
+                    if (view == MAP_FAILED) return false;
+
+                    mv_data = static_cast<const uint8_t*>(view);
+                    mv_size = static_cast<std::size_t>(st.st_size);
+#endif
+                    return true;
+                }
+
+                void close(void) {
+                    if (mv_data == NULL) return;
+#ifdef _MSC_VER
+                    UnmapViewOfFile(mv_data);
+#else
+                    munmap(const_cast<uint8_t*>(mv_data), mv_size);
+#endif
+                    mv_data = NULL;
+                    mv_size = 0;
+                }
+
+                const uint8_t* data(void) const { return mv_data; }
+                std::size_t size(void) const { return mv_size; }
+        };
+    }
+}
+
+#endif // MMAP_HPP
@@ -0,0 +1,225 @@
+/*
+ * pool.hpp
+ *  an arena that recycles small blocks, an allocator for STL containers
+ *  and a base class for objects allocated from the arena
+ *
+ *  Blocks freed to the arena are kept by their size and given again, so
+ *  objects created and deleted repeatedly don't call the heap after the
+ *  first time.  The arena is not thread-safe.
+ *
+ *      util::pool::arena arena;
+ *      std::list<int, util::pool::allocator<int> > list(
+ *          (util::pool::allocator<int>(arena)));
+ *
+ *      class foo : public util::pool::pooled { ... };
+ *      foo* p = new(arena) foo;
+ *      delete p;   // returns the block to the arena
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <cstddef>
+#include <limits>
+#include <new>
+
+namespace util {
+    namespace pool {
+        class arena {
+            private:
+                struct block_type { block_type* next; };
+
+                // Blocks are rounded up to a multiple of "granularity", and
+                // larger ones than "granularity * numof_classes" are not
+                // kept.
+                static const std::size_t granularity = sizeof(void*) * 2;
+                static const std::size_t numof_classes = 32;
+
+            private:
+                block_type* free_lists[numof_classes];
+                std::size_t mv_allocations;
+                std::size_t mv_reuses;
+
+            public:
+                // constructor
+                arena(void) : mv_allocations(0), mv_reuses(0) {
+                    for (std::size_t i = 0; i < numof_classes; ++i) {
+                        free_lists[i] = NULL;
+                    }
+                }
+
+                // destructor
+                ~arena(void) {
+                    for (std::size_t i = 0; i < numof_classes; ++i) {
+                        while (free_lists[i] != NULL) {
+                            block_type* const block = free_lists[i];
+                            free_lists[i] = block->next;
+                            ::operator delete(block);
+                        }
+                    }
+                }
+
+            private:
+                // copy constructor
+                arena(const arena& rhs);
+                // assignment operator
+                arena& operator=(const arena& rhs);
+
+            public:
+                void* allocate(std::size_t size) {
+                    const std::size_t c = size_class(size);
+                    if (c >= numof_classes) {
+                        ++mv_allocations;
+                        return ::operator new(size);
+                    }
+                    if (free_lists[c] != NULL) {
+                        ++mv_reuses;
+                        block_type* const block = free_lists[c];
+                        free_lists[c] = block->next;
+                        return block;
+                    }
+                    ++mv_allocations;
+                    return ::operator new((c + 1) * granularity);
+                }
+
+                void deallocate(void* p, std::size_t size) {
+                    if (p == NULL) return;
+                    const std::size_t c = size_class(size);
+                    if (c >= numof_classes) {
+                        ::operator delete(p);
+                        return;
+                    }
+                    block_type* const block = static_cast<block_type*>(p);
+                    block->next = free_lists[c];
+                    free_lists[c] = block;
+                }
+
+                // a number of blocks got from the heap
+                std::size_t allocations(void) const { return mv_allocations; }
+                // a number of blocks given again
+                std::size_t reuses(void) const { return mv_reuses; }
+
+            private:
+                static std::size_t size_class(std::size_t size) {
+                    return (size == 0) ? 0 : (size - 1) / granularity;
+                }
+        };
+
+        // an allocator for STL containers
+        template<typename T>
+        class allocator {
+            public:
+                // typedefs
+                typedef T               value_type;
+                typedef T*              pointer;
+                typedef const T*        const_pointer;
+                typedef T&              reference;
+                typedef const T&        const_reference;
+                typedef std::size_t     size_type;
+                typedef std::ptrdiff_t  difference_type;
+
+                template<typename U>
+                struct rebind { typedef allocator<U> other; };
+
+            private:
+                arena* mv_arena;
+
+            public:
+                // constructor
+                explicit allocator(arena& owner) : mv_arena(&owner) {}
+                template<typename U>
+                allocator(const allocator<U>& rhs) : mv_arena(&rhs.owner()) {}
+
+            public:
+                pointer address(reference x) const { return &x; }
+                const_pointer address(const_reference x) const { return &x; }
+
+                pointer allocate(size_type n, const void* = 0) {
+                    return static_cast<pointer>(
+                            mv_arena->allocate(n * sizeof(T)));
+                }
+                void deallocate(pointer p, size_type n) {
+                    mv_arena->deallocate(p, n * sizeof(T));
+                }
+
+                size_type max_size(void) const {
+                    return std::numeric_limits<size_type>::max() / sizeof(T);
+                }
+
+                void construct(pointer p, const T& value) {
+                    new(static_cast<void*>(p)) T(value);
+                }
+                void destroy(pointer p) { p->~T(); }
+
+                arena& owner(void) const { return *mv_arena; }
+        };
+
+        template<typename T, typename U>
+        inline bool
+        operator==(const allocator<T>& lhs, const allocator<U>& rhs) {
+            return &lhs.owner() == &rhs.owner();
+        }
+        template<typename T, typename U>
+        inline bool
+        operator!=(const allocator<T>& lhs, const allocator<U>& rhs) {
+            return !(lhs == rhs);
+        }
+
+        /*
+         *  A base class for objects created by "new(arena)".  The arena is
+         *  remembered in front of the object, so "delete" returns the block
+         *  to it.  Objects created by plain "new" use the heap as usual.
+         *  Objects have to be deleted before their arena.
+         * */
+        class pooled {
+            private:
+                struct header_type {
+                    arena* owner;
+                    std::size_t size;
+                };
+
+            public:
+                static void* operator new(std::size_t size, arena& owner) {
+                    header_type* const header = static_cast<header_type*>(
+                            owner.allocate(sizeof(header_type) + size));
+                    header->owner = &owner;
+                    header->size = size;
+                    return header + 1;
+                }
+                static void* operator new(std::size_t size) {
+                    header_type* const header = static_cast<header_type*>(
+                            ::operator new(sizeof(header_type) + size));
+                    header->owner = NULL;
+                    header->size = size;
+                    return header + 1;
+                }
+
+                static void operator delete(void* p) {
+                    if (p == NULL) return;
+                    header_type* const header =
+                        static_cast<header_type*>(p) - 1;
+                    if (header->owner != NULL) {
+                        header->owner->deallocate(
+                                header, sizeof(header_type) + header->size);
+                    }
+                    else {
+                        ::operator delete(header);
+                    }
+                }
+                // called when a constructor throws
+                static void operator delete(void* p, arena&) {
+                    operator delete(p);
+                }
+
+            protected:
+                // constructor and destructor
+                pooled(void) {}
+                ~pooled(void) {}
+        };
+    }
+}
+
+#endif // POOL_HPP
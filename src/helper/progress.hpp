@@ -0,0 +1,213 @@
+/*
+ * progress.hpp
+ *  a class to show the progress, the throughput and the ETA of a process
+ *
+ *  Times are measured by the monotonic clock.  The progress line is shown
+ *  at most once per interval, so the output costs little even if update()
+ *  is called for each small chunk.  The throughput is smoothed by an
+ *  exponential moving average.
+ *
+ *      util::time::progress p(std::cerr, "frames", total);
+ *      for (...) {
+ *          // ...
+ *          p.update(done, bytes);
+ *      }
+ *      p.finish();
+ *
+ *  The progress can also be written for other programs to a FILE object,
+ *  a line for each update:
+ *
+ *      progress done=120 total=300 bytes=... elapsed=1.50 rate=80.00 ...
+ *      end done=300 total=300 bytes=... elapsed=3.75 rate=80.00 ...
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef PROGRESS_HPP
+#define PROGRESS_HPP
+
+#include <cstdio>
+#include <iomanip>
+#include <locale>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+/*
+ * TODO: Use "cstdint" when it is available.
+ * */
+#include <stdint.h>
+
+#include "clock.hpp"
+
+namespace util {
+    namespace time {
+        class progress {
+            private:
+                std::ostream& out;
+                std::FILE* machine;
+                const std::string unit;
+                const uint64_t total;
+                const uint64_t interval;    // in nanoseconds
+                const uint64_t start;
+
+                uint64_t done;
+                uint64_t bytes;
+                uint64_t last_time;
+                uint64_t last_done;
+                uint64_t last_bytes;
+                double unit_rate;           // per second, smoothed
+                double byte_rate;           // per second, smoothed
+
+            public:
+                // constructor
+                // "unit" is the name of what "done" counts, like "frames".
+                progress(   std::ostream& out,
+                            const std::string& unit, uint64_t total,
+                            unsigned int interval_ms = 500)
+                    : out(out), machine(NULL), unit(unit), total(total),
+                      interval(static_cast<uint64_t>(interval_ms) * 1000000),
+                      start(monotonic_ns()),
+                      done(0), bytes(0),
+                      last_time(start), last_done(0), last_bytes(0),
+                      unit_rate(0), byte_rate(0) {}
+
+            private:
+                // copy constructor
+                progress(const progress& rhs);
+                // assignment operator
+                progress& operator=(const progress& rhs);
+
+            public:
+                // Writes machine-readable lines to "fp" too.  NULL stops.
+                void machine_readable(std::FILE* fp) { machine = fp; }
+
+                /*
+                 *  Tells that "done" units and "bytes" bytes have been
+                 *  processed so far.  Shows the progress if the interval
+                 *  has passed since the last time.
+                 * */
+                void update(uint64_t done, uint64_t bytes) {
+                    this->done = done;
+                    this->bytes = bytes;
+
+                    const uint64_t now = monotonic_ns();
+                    if (now - last_time < interval) return;
+
+                    measure(now);
+                    show(now);
+                }
+
+                // Shows the last progress and the summary.
+                void finish(void) {
+                    const uint64_t now = monotonic_ns();
+                    if (done != last_done || bytes != last_bytes) {
+                        measure(now);
+                        show(now);
+                    }
+
+                    const double elapsed = seconds(now - start);
+                    std::ostringstream line;
+                    line.imbue(std::locale::classic());
+                    line << std::fixed << std::setprecision(2)
+                        << "\n" << done << " " << unit
+                        << " (" << megabytes(bytes) << " MB) in "
+                        << elapsed << " s, "
+                        << average(done, elapsed) << " " << unit << "/s, "
+                        << megabytes(average(bytes, elapsed)) << " MB/s\n";
+                    out << line.str() << std::flush;
+
+                    report("end", now);
+                }
+
+                // the elapsed time in seconds
+                double elapsed(void) const {
+                    return seconds(monotonic_ns() - start);
+                }
+
+            private:
+                // Updates the smoothed throughput.
+                void measure(uint64_t now) {
+                    const double dt = seconds(now - last_time);
+                    if (dt <= 0) return;
+
+                    const double current_unit_rate = (done - last_done) / dt;
+                    const double current_byte_rate = (bytes - last_bytes) / dt;
+                    if (last_done == 0 && last_bytes == 0) {
+                        unit_rate = current_unit_rate;
+                        byte_rate = current_byte_rate;
+                    }
+                    else {
+                        unit_rate = smoothing() * current_unit_rate
+                            + (1 - smoothing()) * unit_rate;
+                        byte_rate = smoothing() * current_byte_rate
+                            + (1 - smoothing()) * byte_rate;
+                    }
+
+                    last_time = now;
+                    last_done = done;
+                    last_bytes = bytes;
+                }
+
+                void show(uint64_t now) {
+                    std::ostringstream line;
+                    line.imbue(std::locale::classic());
+                    line << std::fixed << std::setprecision(2)
+                        << "\r" << done << "/" << total << " " << unit;
+                    if (total > 0) {
+                        line << " (" << static_cast<double>(done) * 100 / total
+                            << "%)";
+                    }
+                    line << " " << unit_rate << " " << unit << "/s, "
+                        << megabytes(byte_rate) << " MB/s, elapsed "
+                        << seconds(now - start) << " s";
+                    if (done < total && unit_rate > 0) {
+                        line << ", ETA " << (total - done) / unit_rate << " s";
+                    }
+                    // Blanks erase the rest of a longer line shown before.
+                    line << "   ";
+                    out << line.str() << std::flush;
+
+                    report("progress", now);
+                }
+
+                void report(const char* kind, uint64_t now) {
+                    if (machine == NULL) return;
+
+                    std::ostringstream line;
+                    line.imbue(std::locale::classic());
+                    line << std::fixed << std::setprecision(2)
+                        << kind
+                        << " done=" << done
+                        << " total=" << total
+                        << " bytes=" << bytes
+                        << " elapsed=" << seconds(now - start)
+                        << " rate=" << unit_rate
+                        << " byte_rate=" << byte_rate;
+                    if (done < total && unit_rate > 0) {
+                        line << " eta=" << (total - done) / unit_rate;
+                    }
+                    line << "\n";
+                    std::fputs(line.str().c_str(), machine);
+                    std::fflush(machine);
+                }
+
+                // the weight of the newest throughput in the average
+                static double smoothing(void) { return 0.3; }
+
+                static double seconds(uint64_t ns) {
+                    return static_cast<double>(ns) / 1000000000;
+                }
+                static double megabytes(double b) {
+                    return b / (1024 * 1024);
+                }
+                static double average(double amount, double elapsed) {
+                    return (elapsed > 0) ? amount / elapsed : 0;
+                }
+        };
+    }
+}
+
+#endif // PROGRESS_HPP
+
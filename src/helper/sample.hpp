@@ -0,0 +1,646 @@
+/*
+ * sample.hpp
+ *  functions to convert audio samples between formats
+ *
+ *  Integers are signed and little-endian except 8bit that is unsigned with
+ *  an offset 128, as well as RIFF WAV.  Floating point numbers are in the
+ *  range [-1.0, 1.0].
+ *
+ *  Converting to fewer bits is rounded to nearest and clipped to the range
+ *  of the destination.  Floating point numbers are rounded half to even and
+ *  integers are rounded half up.  Optionally, TPDF (triangular probability
+ *  density function) dither of +-1 LSB of the destination is added before
+ *  rounding.
+ *
+ *  convert() uses SSE2 and AVX2 for some common pairs of formats when the
+ *  compiler targets them, and gives the same results as convert_scalar()
+ *  bit for bit.  With dither that reduces precision, both of them use the
+ *  scalar code.
+ *
+ *  deinterleave() splits interleaved samples into a buffer for each
+ *  channel, by kernels specialized for a number of channels.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef SAMPLE_HPP
+#define SAMPLE_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define SAMPLE_USE_SSE2
+#   include <emmintrin.h>
+#endif
+#ifdef __AVX2__
+#   define SAMPLE_USE_AVX2
+#   include <immintrin.h>
+#endif
+
+namespace util {
+    namespace sample {
+        enum format_type {
+            INT8,
+            INT16,
+            INT24,
+            INT32,
+            FLOAT
+        };
+
+        // Returns a number of bytes of a value in "format".
+        inline unsigned int size(const format_type format) {
+            switch (format) {
+                case INT8:  return 1;
+                case INT16: return 2;
+                case INT24: return 3;
+                case INT32:
+                case FLOAT:
+                default:    return 4;
+            }
+        }
+
+        // Returns a number of significant bits of a value in "format".
+        inline unsigned int bits(const format_type format) {
+            return (format == FLOAT) ? 24 : size(format) * 8;
+        }
+
+        /*
+         *  A generator of TPDF dither.  The sequence is determined by the
+         *  seed, so the results are reproducible.
+         * */
+        class dither {
+            private:
+                uint32_t mv_state;
+
+            public:
+                // constructor
+                explicit dither(const uint32_t seed = 1) : mv_state(seed) {}
+
+            public:
+                // a linear congruential generator from Numerical Recipes
+                uint32_t next(void) {
+                    mv_state = mv_state * 1664525 + 1013904223;
+                    return mv_state;
+                }
+
+                // Returns a value in (-1.0, 1.0).
+                float tpdf(void) {
+                    const float unit = 1.0f / (1 << 24);
+                    const float a = static_cast<float>(next() >> 8) * unit;
+                    const float b = static_cast<float>(next() >> 8) * unit;
+                    return a - b;
+                }
+
+                // Returns a value in (-2^n, 2^n), 1 <= n <= 31.
+                int64_t tpdf(const unsigned int n) {
+                    const int64_t a = next() >> (32 - n);
+                    const int64_t b = next() >> (32 - n);
+                    return a - b;
+                }
+        };
+
+        namespace detail {
+            // the largest float that is not larger than 2^(bits - 1) - 1
+            inline float max_float(const unsigned int bits) {
+                // 2^31 - 1 can't be represented as float.
+                return (bits == 32)
+                    ? 2147483520.0f
+                    : static_cast<float>(
+                            (static_cast<int64_t>(1) << (bits - 1)) - 1);
+            }
+
+            // rounding half to even, the same as SSE2 by default
+            inline int32_t round_even(const float src) {
+                const double floored = std::floor(static_cast<double>(src));
+                const double diff = src - floored;
+                int64_t result = static_cast<int64_t>(floored);
+                if (diff > 0.5 || (diff == 0.5 && (result & 1) != 0)) {
+                    ++result;
+                }
+                return static_cast<int32_t>(result);
+            }
+
+            // Reads an integer and returns it shifted to the most
+            // significant bits of int32_t.
+            inline int32_t load_int(const uint8_t* p, const format_type f) {
+                uint32_t v;
+                switch (f) {
+                    case INT8:
+                        v = static_cast<uint32_t>(p[0] ^ 0x80) << 24;
+                        break;
+                    case INT16:
+                        v =   (static_cast<uint32_t>(p[0]) << 16)
+                            | (static_cast<uint32_t>(p[1]) << 24);
+                        break;
+                    case INT24:
+                        v =   (static_cast<uint32_t>(p[0]) << 8)
+                            | (static_cast<uint32_t>(p[1]) << 16)
+                            | (static_cast<uint32_t>(p[2]) << 24);
+                        break;
+                    case INT32:
+                    default:
+                        v =   static_cast<uint32_t>(p[0])
+                            | (static_cast<uint32_t>(p[1]) << 8)
+                            | (static_cast<uint32_t>(p[2]) << 16)
+                            | (static_cast<uint32_t>(p[3]) << 24);
+                        break;
+                }
+                return static_cast<int32_t>(v);
+            }
+
+            // Writes "v" in the range of "f".
+            inline void store_int(uint8_t* p, const int32_t v,
+                                  const format_type f) {
+                const uint32_t u = static_cast<uint32_t>(v);
+                switch (f) {
+                    case INT8:
+                        p[0] = static_cast<uint8_t>(u ^ 0x80);
+                        break;
+                    case INT16:
+                        p[0] = static_cast<uint8_t>(u);
+                        p[1] = static_cast<uint8_t>(u >> 8);
+                        break;
+                    case INT24:
+                        p[0] = static_cast<uint8_t>(u);
+                        p[1] = static_cast<uint8_t>(u >> 8);
+                        p[2] = static_cast<uint8_t>(u >> 16);
+                        break;
+                    case INT32:
+                    default:
+                        p[0] = static_cast<uint8_t>(u);
+                        p[1] = static_cast<uint8_t>(u >> 8);
+                        p[2] = static_cast<uint8_t>(u >> 16);
+                        p[3] = static_cast<uint8_t>(u >> 24);
+                        break;
+                }
+            }
+
+            inline float load_float(const uint8_t* p) {
+                float v;
+                std::memcpy(&v, p, sizeof(v));
+                return v;
+            }
+
+            inline void store_float(uint8_t* p, const float v) {
+                std::memcpy(p, &v, sizeof(v));
+            }
+
+            // conversions of a value
+            inline float int_to_float(const int32_t v) {
+                return static_cast<float>(v) * (1.0f / 2147483648.0f);
+            }
+
+            inline int32_t float_to_int(float v, const unsigned int bits,
+                                        const unsigned int src_bits,
+                                        dither* d) {
+                const float scale =
+                    static_cast<float>(static_cast<int64_t>(1) << (bits - 1));
+                v *= scale;
+                if (d != NULL && bits < src_bits) v += d->tpdf();
+
+                // NaN becomes the maximum as well as SSE2.
+                const float hi = max_float(bits);
+                const float lo = -scale;
+                if (!(v <= hi)) v = hi;
+                if (v < lo) v = lo;
+                return round_even(v);
+            }
+
+            inline int32_t int_to_int(const int32_t v, const unsigned int bits,
+                                      const unsigned int src_bits,
+                                      dither* d) {
+                if (bits == 32) return v;
+
+                const unsigned int shift = 32 - bits;
+                int64_t w = v;
+                if (d != NULL && bits < src_bits) w += d->tpdf(shift);
+                w = (w >> shift) + ((w >> (shift - 1)) & 1);
+
+                const int64_t hi = (static_cast<int64_t>(1) << (bits - 1)) - 1;
+                const int64_t lo = -hi - 1;
+                if (w > hi) w = hi;
+                if (w < lo) w = lo;
+                return static_cast<int32_t>(w);
+            }
+        }
+
+        /*
+         *  Converts "count" values from "src" in "from" to "dst" in "to".
+         *  For multichannel audio, "count" is a number of samples multiplied
+         *  by a number of channels.  "src" and "dst" must not overlap.
+         *  "d" adds dither when the precision is reduced if it isn't NULL.
+         *
+         *  This is the reference implementation of convert().
+         * */
+        inline void convert_scalar( const void* src, const format_type from,
+                                    void* dst, const format_type to,
+                                    const std::size_t count,
+                                    dither* d = NULL) {
+            const uint8_t* s = static_cast<const uint8_t*>(src);
+            uint8_t* p = static_cast<uint8_t*>(dst);
+            const unsigned int ssize = size(from);
+            const unsigned int dsize = size(to);
+
+            if (from == to) {
+                std::memcpy(p, s, count * ssize);
+                return;
+            }
+
+            for (std::size_t i = 0; i < count; ++i, s += ssize, p += dsize) {
+                if (from == FLOAT) {
+                    detail::store_int(p,
+                            detail::float_to_int(
+                                detail::load_float(s),
+                                bits(to), bits(from), d),
+                            to);
+                }
+                else if (to == FLOAT) {
+                    detail::store_float(p,
+                            detail::int_to_float(detail::load_int(s, from)));
+                }
+                else {
+                    detail::store_int(p,
+                            detail::int_to_int(
+                                detail::load_int(s, from),
+                                bits(to), bits(from), d),
+                            to);
+                }
+            }
+        }
+
+        namespace detail {
+            /*
+             *  Vectorized kernels.  Each of them converts as many values as
+             *  it can handle at a time and returns the number of converted
+             *  values.  The rest is left to convert_scalar().
+             * */
+#ifdef SAMPLE_USE_SSE2
+            inline std::size_t int16_to_float_sse2(
+                    const int16_t* s, float* p, const std::size_t count) {
+                const __m128 scale = _mm_set1_ps(1.0f / 32768.0f);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i v =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                    const __m128i lo =
+                        _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+                    const __m128i hi =
+                        _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+                    _mm_storeu_ps(p + i,
+                            _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+                    _mm_storeu_ps(p + i + 4,
+                            _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+                }
+                return i;
+            }
+
+            inline std::size_t int32_to_float_sse2(
+                    const int32_t* s, float* p, const std::size_t count) {
+                const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+                std::size_t i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    const __m128i v =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                    _mm_storeu_ps(p + i, _mm_mul_ps(_mm_cvtepi32_ps(v), scale));
+                }
+                return i;
+            }
+
+            inline std::size_t float_to_int16_sse2(
+                    const float* s, int16_t* p, const std::size_t count) {
+                const __m128 scale = _mm_set1_ps(32768.0f);
+                const __m128 hi = _mm_set1_ps(32767.0f);
+                const __m128 lo = _mm_set1_ps(-32768.0f);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m128 a = _mm_max_ps(_mm_min_ps(
+                                _mm_mul_ps(_mm_loadu_ps(s + i), scale), hi), lo);
+                    const __m128 b = _mm_max_ps(_mm_min_ps(
+                                _mm_mul_ps(_mm_loadu_ps(s + i + 4), scale), hi),
+                            lo);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i),
+                            _mm_packs_epi32(
+                                _mm_cvtps_epi32(a), _mm_cvtps_epi32(b)));
+                }
+                return i;
+            }
+
+            inline std::size_t float_to_int32_sse2(
+                    const float* s, int32_t* p, const std::size_t count) {
+                const __m128 scale = _mm_set1_ps(2147483648.0f);
+                const __m128 hi = _mm_set1_ps(max_float(32));
+                const __m128 lo = _mm_set1_ps(-2147483648.0f);
+                std::size_t i = 0;
+                for (; i + 4 <= count; i += 4) {
+                    const __m128 v = _mm_max_ps(_mm_min_ps(
+                                _mm_mul_ps(_mm_loadu_ps(s + i), scale), hi), lo);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i),
+                            _mm_cvtps_epi32(v));
+                }
+                return i;
+            }
+
+            inline std::size_t int32_to_int16_sse2(
+                    const int32_t* s, int16_t* p, const std::size_t count) {
+                const __m128i one = _mm_set1_epi32(1);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i a =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                    const __m128i b = _mm_loadu_si128(
+                            reinterpret_cast<const __m128i*>(s + i + 4));
+                    // (v >> 16) + ((v >> 15) & 1) doesn't overflow.
+                    const __m128i ra = _mm_add_epi32(_mm_srai_epi32(a, 16),
+                            _mm_and_si128(_mm_srai_epi32(a, 15), one));
+                    const __m128i rb = _mm_add_epi32(_mm_srai_epi32(b, 16),
+                            _mm_and_si128(_mm_srai_epi32(b, 15), one));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i),
+                            _mm_packs_epi32(ra, rb));
+                }
+                return i;
+            }
+
+            inline std::size_t int16_to_int32_sse2(
+                    const int16_t* s, int32_t* p, const std::size_t count) {
+                const __m128i zero = _mm_setzero_si128();
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m128i v =
+                        _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i),
+                            _mm_unpacklo_epi16(zero, v));
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(p + i + 4),
+                            _mm_unpackhi_epi16(zero, v));
+                }
+                return i;
+            }
+#endif // SAMPLE_USE_SSE2
+
+#ifdef SAMPLE_USE_AVX2
+            inline std::size_t int16_to_float_avx2(
+                    const int16_t* s, float* p, const std::size_t count) {
+                const __m256 scale = _mm256_set1_ps(1.0f / 32768.0f);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(
+                                reinterpret_cast<const __m128i*>(s + i)));
+                    _mm256_storeu_ps(p + i,
+                            _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+                }
+                return i;
+            }
+
+            inline std::size_t int32_to_float_avx2(
+                    const int32_t* s, float* p, const std::size_t count) {
+                const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m256i v = _mm256_loadu_si256(
+                            reinterpret_cast<const __m256i*>(s + i));
+                    _mm256_storeu_ps(p + i,
+                            _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+                }
+                return i;
+            }
+
+            inline std::size_t float_to_int16_avx2(
+                    const float* s, int16_t* p, const std::size_t count) {
+                const __m256 scale = _mm256_set1_ps(32768.0f);
+                const __m256 hi = _mm256_set1_ps(32767.0f);
+                const __m256 lo = _mm256_set1_ps(-32768.0f);
+                std::size_t i = 0;
+                for (; i + 16 <= count; i += 16) {
+                    const __m256 a = _mm256_max_ps(_mm256_min_ps(
+                                _mm256_mul_ps(_mm256_loadu_ps(s + i), scale),
+                                hi), lo);
+                    const __m256 b = _mm256_max_ps(_mm256_min_ps(
+                                _mm256_mul_ps(_mm256_loadu_ps(s + i + 8), scale),
+                                hi), lo);
+                    // packs works in each 128bit lane, so reorder them.
+                    const __m256i packed = _mm256_packs_epi32(
+                            _mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i),
+                            _mm256_permute4x64_epi64(packed, 0xd8));
+                }
+                return i;
+            }
+
+            inline std::size_t float_to_int32_avx2(
+                    const float* s, int32_t* p, const std::size_t count) {
+                const __m256 scale = _mm256_set1_ps(2147483648.0f);
+                const __m256 hi = _mm256_set1_ps(max_float(32));
+                const __m256 lo = _mm256_set1_ps(-2147483648.0f);
+                std::size_t i = 0;
+                for (; i + 8 <= count; i += 8) {
+                    const __m256 v = _mm256_max_ps(_mm256_min_ps(
+                                _mm256_mul_ps(_mm256_loadu_ps(s + i), scale),
+                                hi), lo);
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(p + i),
+                            _mm256_cvtps_epi32(v));
+                }
+                return i;
+            }
+#endif // SAMPLE_USE_AVX2
+
+            // Returns a number of values converted by vectorized kernels.
+            inline std::size_t convert_vector(
+                    const void* src, const format_type from,
+                    void* dst, const format_type to,
+                    const std::size_t count) {
+#ifdef SAMPLE_USE_SSE2
+                const int16_t* s16 = static_cast<const int16_t*>(src);
+                const int32_t* s32 = static_cast<const int32_t*>(src);
+                const float* sf = static_cast<const float*>(src);
+                int16_t* p16 = static_cast<int16_t*>(dst);
+                int32_t* p32 = static_cast<int32_t*>(dst);
+                float* pf = static_cast<float*>(dst);
+
+                if (from == INT16 && to == FLOAT) {
+#   ifdef SAMPLE_USE_AVX2
+                    return int16_to_float_avx2(s16, pf, count);
+#   else
+                    return int16_to_float_sse2(s16, pf, count);
+#   endif
+                }
+                if (from == INT32 && to == FLOAT) {
+#   ifdef SAMPLE_USE_AVX2
+                    return int32_to_float_avx2(s32, pf, count);
+#   else
+                    return int32_to_float_sse2(s32, pf, count);
+#   endif
+                }
+                if (from == FLOAT && to == INT16) {
+#   ifdef SAMPLE_USE_AVX2
+                    return float_to_int16_avx2(sf, p16, count);
+#   else
+                    return float_to_int16_sse2(sf, p16, count);
+#   endif
+                }
+                if (from == FLOAT && to == INT32) {
+#   ifdef SAMPLE_USE_AVX2
+                    return float_to_int32_avx2(sf, p32, count);
+#   else
+                    return float_to_int32_sse2(sf, p32, count);
+#   endif
+                }
+                if (from == INT32 && to == INT16) {
+                    return int32_to_int16_sse2(s32, p16, count);
+                }
+                if (from == INT16 && to == INT32) {
+                    return int16_to_int32_sse2(s16, p32, count);
+                }
+#else
+                (void)src; (void)from; (void)dst; (void)to; (void)count;
+#endif // SAMPLE_USE_SSE2
+                return 0;
+            }
+        }
+
+        /*
+         *  The same as convert_scalar(), but faster for some pairs of
+         *  formats.
+         * */
+        inline void convert(const void* src, const format_type from,
+                            void* dst, const format_type to,
+                            const std::size_t count,
+                            dither* d = NULL) {
+            std::size_t done = 0;
+            if (from != to && (d == NULL || bits(to) >= bits(from))) {
+                done = detail::convert_vector(src, from, dst, to, count);
+            }
+            convert_scalar(
+                    static_cast<const uint8_t*>(src) + done * size(from), from,
+                    static_cast<uint8_t*>(dst) + done * size(to), to,
+                    count - done, d);
+        }
+
+        namespace detail {
+            /*
+             *  Kernels to deinterleave "count" samples of "Channels"
+             *  channels.  The number of channels is known at compile time,
+             *  so the loops are unrolled.
+             * */
+            template<unsigned int Channels>
+            struct deinterleaver {
+                static void apply( const float* src, float* const* dst,
+                                   const std::size_t count) {
+                    for (std::size_t i = 0; i < count; ++i) {
+                        for (unsigned int c = 0; c < Channels; ++c) {
+                            dst[c][i] = src[i * Channels + c];
+                        }
+                    }
+                }
+            };
+
+            template<>
+            struct deinterleaver<1> {
+                static void apply( const float* src, float* const* dst,
+                                   const std::size_t count) {
+                    std::memcpy(dst[0], src, count * sizeof(float));
+                }
+            };
+
+#ifdef SAMPLE_USE_SSE2
+            // l0, r0, l1, r1, ...
+            template<>
+            struct deinterleaver<2> {
+                static void apply( const float* src, float* const* dst,
+                                   const std::size_t count) {
+                    float* const l = dst[0];
+                    float* const r = dst[1];
+                    std::size_t i = 0;
+                    for (; i + 4 <= count; i += 4) {
+                        const __m128 a = _mm_loadu_ps(src + i * 2);
+                        const __m128 b = _mm_loadu_ps(src + i * 2 + 4);
+                        _mm_storeu_ps(l + i,
+                                _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                        _mm_storeu_ps(r + i,
+                                _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                    }
+                    for (; i < count; ++i) {
+                        l[i] = src[i * 2];
+                        r[i] = src[i * 2 + 1];
+                    }
+                }
+            };
+
+            // 5.1ch: fl0, fr0, fc0, lf0, bl0, br0, fl1, ...
+            template<>
+            struct deinterleaver<6> {
+                static void apply( const float* src, float* const* dst,
+                                   const std::size_t count) {
+                    std::size_t i = 0;
+                    for (; i + 4 <= count; i += 4) {
+                        // 4 samples of 6 channels
+                        const float* p = src + i * 6;
+                        const __m128 v0 = _mm_loadu_ps(p);
+                        const __m128 v1 = _mm_loadu_ps(p + 4);
+                        const __m128 v2 = _mm_loadu_ps(p + 8);
+                        const __m128 v3 = _mm_loadu_ps(p + 12);
+                        const __m128 v4 = _mm_loadu_ps(p + 16);
+                        const __m128 v5 = _mm_loadu_ps(p + 20);
+
+                        // channels 0-3 of each sample, then transpose them
+                        __m128 r0 = v0;
+                        __m128 r1 =
+                            _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(1, 0, 3, 2));
+                        __m128 r2 = v3;
+                        __m128 r3 =
+                            _mm_shuffle_ps(v4, v5, _MM_SHUFFLE(1, 0, 3, 2));
+                        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+                        _mm_storeu_ps(dst[0] + i, r0);
+                        _mm_storeu_ps(dst[1] + i, r1);
+                        _mm_storeu_ps(dst[2] + i, r2);
+                        _mm_storeu_ps(dst[3] + i, r3);
+
+                        // channels 4 and 5
+                        const __m128 a =
+                            _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(3, 2, 1, 0));
+                        const __m128 b =
+                            _mm_shuffle_ps(v4, v5, _MM_SHUFFLE(3, 2, 1, 0));
+                        _mm_storeu_ps(dst[4] + i,
+                                _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+                        _mm_storeu_ps(dst[5] + i,
+                                _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+                    }
+                    for (; i < count; ++i) {
+                        for (unsigned int c = 0; c < 6; ++c) {
+                            dst[c][i] = src[i * 6 + c];
+                        }
+                    }
+                }
+            };
+#endif // SAMPLE_USE_SSE2
+        }
+
+        /*
+         *  Splits "count" samples of "channels" channels in "src" into
+         *  "dst[0]" .. "dst[channels - 1]".
+         * */
+        inline void deinterleave(const float* src, float* const* dst,
+                                 const unsigned int channels,
+                                 const std::size_t count) {
+            switch (channels) {
+                case 1: detail::deinterleaver<1>::apply(src, dst, count); break;
+                case 2: detail::deinterleaver<2>::apply(src, dst, count); break;
+                case 4: detail::deinterleaver<4>::apply(src, dst, count); break;
+                case 6: detail::deinterleaver<6>::apply(src, dst, count); break;
+                case 8: detail::deinterleaver<8>::apply(src, dst, count); break;
+                default:
+                    for (std::size_t i = 0; i < count; ++i) {
+                        for (unsigned int c = 0; c < channels; ++c) {
+                            dst[c][i] = src[i * channels + c];
+                        }
+                    }
+                    break;
+            }
+        }
+    }
+}
+
+#endif // SAMPLE_HPP
@@ -0,0 +1,348 @@
+/*
+ * thread.hpp
+ *  thin wrappers of threads and objects for synchronization
+ *
+ *  On Windows, these use Win32 API (Windows Vista or later is needed for
+ *  condition variables).  Otherwise, these use POSIX threads:
+ *
+ *      > g++ -Wall --pedantic -pthread main.cpp
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef THREAD_HPP
+#define THREAD_HPP
+
+#ifdef _MSC_VER
+#   include <windows.h>
+#   include <process.h>     // for _beginthreadex(6)
+#else
+#   include <pthread.h>
+#   include <sys/time.h>    // for gettimeofday(2)
+#   include <unistd.h>      // for sysconf(3)
+#endif
+
+namespace util {
+    namespace thread {
+        // Returns the number of processors that are available now.
+        inline unsigned int numof_processors(void) {
+#ifdef _MSC_VER
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return info.dwNumberOfProcessors;
+#else
+            const long n = sysconf(_SC_NPROCESSORS_ONLN);
+            return n > 0 ? static_cast<unsigned int>(n) : 1;
+#endif
+        }
+
+        /*
+         *  Orders memory accesses.  Writes before this are visible to other
+         *  threads before writes after this, and reads after this see what
+         *  other threads published before their barrier.
+         * */
+        inline void memory_barrier(void) {
+#ifdef _MSC_VER
+            MemoryBarrier();
+#else
+            __sync_synchronize();
+#endif
+        }
+
+        // a mutual exclusion object that is not recursive
+        class mutex {
+            private:
+#ifdef _MSC_VER
+                CRITICAL_SECTION mv_section;
+#else
+                pthread_mutex_t mv_mutex;
+#endif
+
+            public:
+                // constructor
+#ifdef _MSC_VER
+                mutex(void) { InitializeCriticalSection(&mv_section); }
+#else
+                mutex(void) { pthread_mutex_init(&mv_mutex, NULL); }
+#endif
+                // destructor
+#ifdef _MSC_VER
+                ~mutex(void) { DeleteCriticalSection(&mv_section); }
+#else
+                ~mutex(void) { pthread_mutex_destroy(&mv_mutex); }
+#endif
+
+            private:
+                // copy constructor
+                mutex(const mutex& rhs);
+                // assignment operator
+                mutex& operator=(const mutex& rhs);
+
+            public:
+#ifdef _MSC_VER
+                void lock(void) { EnterCriticalSection(&mv_section); }
+                void unlock(void) { LeaveCriticalSection(&mv_section); }
+                // Returns false at once if another thread has locked it.
+                bool try_lock(void) {
+                    return TryEnterCriticalSection(&mv_section) != 0;
+                }
+                CRITICAL_SECTION* native(void) { return &mv_section; }
+#else
+                void lock(void) { pthread_mutex_lock(&mv_mutex); }
+                void unlock(void) { pthread_mutex_unlock(&mv_mutex); }
+                // Returns false at once if another thread has locked it.
+                bool try_lock(void) {
+                    return pthread_mutex_trylock(&mv_mutex) == 0;
+                }
+                pthread_mutex_t* native(void) { return &mv_mutex; }
+#endif
+        };
+
+        /*
+         *  A class to lock a mutex during a scope.
+         *  Usage:
+         *
+         *      {
+         *          scoped_lock lock(m);
+         *          // m is locked here
+         *      }
+         *      // m is unlocked here
+         * */
+        class scoped_lock {
+            private:
+                mutex& mv_mutex;
+
+            public:
+                // constructor
+                explicit scoped_lock(mutex& m) : mv_mutex(m) {
+                    mv_mutex.lock();
+                }
+                // destructor
+                ~scoped_lock(void) { mv_mutex.unlock(); }
+
+            private:
+                // copy constructor
+                scoped_lock(const scoped_lock& rhs);
+                // assignment operator
+                scoped_lock& operator=(const scoped_lock& rhs);
+        };
+
+        // the reversed version of scoped_lock
+        class scoped_unlock {
+            private:
+                mutex& mv_mutex;
+
+            public:
+                // constructor
+                explicit scoped_unlock(mutex& m) : mv_mutex(m) {
+                    mv_mutex.unlock();
+                }
+                // destructor
+                ~scoped_unlock(void) { mv_mutex.lock(); }
+
+            private:
+                // copy constructor
+                scoped_unlock(const scoped_unlock& rhs);
+                // assignment operator
+                scoped_unlock& operator=(const scoped_unlock& rhs);
+        };
+
+        // a condition variable
+        class condition {
+            private:
+#ifdef _MSC_VER
+                CONDITION_VARIABLE mv_cond;
+#else
+                pthread_cond_t mv_cond;
+#endif
+
+            public:
+                // constructor
+#ifdef _MSC_VER
+                condition(void) { InitializeConditionVariable(&mv_cond); }
+#else
+                condition(void) { pthread_cond_init(&mv_cond, NULL); }
+#endif
+                // destructor
+#ifdef _MSC_VER
+                ~condition(void) {}
+#else
+                ~condition(void) { pthread_cond_destroy(&mv_cond); }
+#endif
+
+            private:
+                // copy constructor
+                condition(const condition& rhs);
+                // assignment operator
+                condition& operator=(const condition& rhs);
+
+            public:
+                // "m" must be locked by the caller.
+#ifdef _MSC_VER
+                void wait(mutex& m) {
+                    SleepConditionVariableCS(&mv_cond, m.native(), INFINITE);
+                }
+                void notify_one(void) { WakeConditionVariable(&mv_cond); }
+                void notify_all(void) { WakeAllConditionVariable(&mv_cond); }
+#else
+                void wait(mutex& m) { pthread_cond_wait(&mv_cond, m.native()); }
+                void notify_one(void) { pthread_cond_signal(&mv_cond); }
+                void notify_all(void) { pthread_cond_broadcast(&mv_cond); }
+#endif
+
+                // Waits "ms" milliseconds at most.  "m" must be locked by
+                // the caller.
+#ifdef _MSC_VER
+                void wait_for(mutex& m, unsigned int ms) {
+                    SleepConditionVariableCS(&mv_cond, m.native(), ms);
+                }
+#else
+                void wait_for(mutex& m, unsigned int ms) {
+                    struct timeval now;
+                    gettimeofday(&now, NULL);
+                    const long usec = now.tv_usec + (ms % 1000) * 1000L;
+                    struct timespec until;
+                    until.tv_sec = now.tv_sec + ms / 1000 + usec / 1000000;
+                    until.tv_nsec = usec % 1000000 * 1000;
+                    pthread_cond_timedwait(&mv_cond, m.native(), &until);
+                }
+#endif
+        };
+
+        /*
+         *  A slot of thread-local storage that holds a pointer for each
+         *  thread.  "cleanup" is called with the pointer when a thread that
+         *  has set it to non-NULL exits.  It may not be called for the main
+         *  thread.
+         * */
+        class specific_ptr {
+            public:
+                // typedefs
+#ifdef _MSC_VER
+                typedef void (__stdcall *cleanup_type)(void*);
+#else
+                typedef void (*cleanup_type)(void*);
+#endif
+
+            private:
+#ifdef _MSC_VER
+                DWORD mv_index;     // uses fiber local storage, because
+                                    // only it has a callback at exit
+#else
+                pthread_key_t mv_key;
+#endif
+
+            public:
+                // constructor
+#ifdef _MSC_VER
+                explicit specific_ptr(cleanup_type cleanup)
+                    : mv_index(FlsAlloc(cleanup)) {}
+#else
+                explicit specific_ptr(cleanup_type cleanup) {
+                    pthread_key_create(&mv_key, cleanup);
+                }
+#endif
+                // destructor
+#ifdef _MSC_VER
+                ~specific_ptr(void) { FlsFree(mv_index); }
+#else
+                ~specific_ptr(void) { pthread_key_delete(mv_key); }
+#endif
+
+            private:
+                // copy constructor
+                specific_ptr(const specific_ptr& rhs);
+                // assignment operator
+                specific_ptr& operator=(const specific_ptr& rhs);
+
+            public:
+#ifdef _MSC_VER
+                void* get(void) const { return FlsGetValue(mv_index); }
+                void set(void* p) { FlsSetValue(mv_index, p); }
+#else
+                void* get(void) const { return pthread_getspecific(mv_key); }
+                void set(void* p) { pthread_setspecific(mv_key, p); }
+#endif
+        };
+
+        /*
+         *  A base class for threads.  To use:
+         *
+         *      1. Define a class that is derived from this class.
+         *      2. Override the member function run().
+         *      3. Call start() to begin run() in a new thread, and join()
+         *         to wait for the end of it.  join() must be called before
+         *         the object is destroyed.
+         * */
+        class thread {
+            private:
+#ifdef _MSC_VER
+                HANDLE mv_handle;
+#else
+                pthread_t mv_handle;
+#endif
+                bool mv_is_started;
+
+            public:
+                // constructor
+                thread(void) : mv_is_started(false) {}
+                // destructor
+                virtual ~thread(void) {}
+
+            private:
+                // copy constructor
+                thread(const thread& rhs);
+                // assignment operator
+                thread& operator=(const thread& rhs);
+
+            protected:
+                // the procedure that is executed in a new thread
+                virtual void run(void) = 0;
+
+            public:
+                // Returns false if a thread couldn't be created.
+                bool start(void) {
+                    if (mv_is_started) return false;
+#ifdef _MSC_VER
+                    mv_handle = reinterpret_cast<HANDLE>(
+                            _beginthreadex(NULL, 0, entry, this, 0, NULL));
+                    mv_is_started = (mv_handle != 0);
+#else
+                    mv_is_started =
+                        (pthread_create(&mv_handle, NULL, entry, this) == 0);
+#endif
+                    return mv_is_started;
+                }
+
+                void join(void) {
+                    if (!mv_is_started) return;
+#ifdef _MSC_VER
+                    WaitForSingleObject(mv_handle, INFINITE);
+                    CloseHandle(mv_handle);
+#else
+                    pthread_join(mv_handle, NULL);
+#endif
+                    mv_is_started = false;
+                }
+
+                bool is_started(void) const { return mv_is_started; }
+
+            private:
+                // an entry point for the native thread
+#ifdef _MSC_VER
+                static unsigned int __stdcall entry(void* p) {
+                    static_cast<thread*>(p)->run();
+                    return 0;
+                }
+#else
+                static void* entry(void* p) {
+                    static_cast<thread*>(p)->run();
+                    return NULL;
+                }
+#endif
+        };
+    }
+}
+
+#endif // THREAD_HPP
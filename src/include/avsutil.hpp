@@ -9,8 +9,12 @@
 #ifndef AVSUTIL_HPP
 #define AVSUTIL_HPP
 
+#include <cstddef>
 #include <istream>
+#include <ostream>
 #include <stdint.h>
+#include <string>
+#include <vector>
 
 namespace avsutil {
     // meta informations
@@ -25,6 +29,24 @@ namespace avsutil {
     struct video_type;
     struct audio_type;
 
+    /*
+     *  Enumerations for the ways to read frames or samples, given to
+     *  video_type::access_hint() and audio_type::access_hint()
+     *
+     *      ADAPTIVE:   unknown.  This is default.
+     *      SEQUENTIAL: forward one after another
+     *      REVERSE:    backward one after another
+     *      RANDOM:     at random, and some may be read again
+     *      STRIDED:    forward skipping by a constant stride
+     * */
+    enum access_type {
+        ADAPTIVE,
+        SEQUENTIAL,
+        REVERSE,
+        RANDOM,
+        STRIDED
+    };
+
     /*
      *  A function to start.
      *  Usage:
@@ -36,54 +58,260 @@ namespace avsutil {
      * */
     manager_type& manager(void);
 
+    /*
+     *  Measurements of the calls into AviSynth made by this library for all
+     *  scripts.  Each kind of call has a count, the total time and a
+     *  histogram of latencies measured by a monotonic clock in nanoseconds.
+     *  histogram[i] counts calls that took [2^i, 2^(i+1)) nanoseconds, and
+     *  the last one also counts longer calls.
+     *
+     *  The measurement is disabled by default, and then it costs only a
+     *  test of a flag for each call.  Usage:
+     *
+     *      enable_metrics(true);
+     *      // ... read frames and samples ...
+     *      std::cerr << metrics();
+     * */
+    struct metrics_type {
+        enum kind_type {
+            GET_FRAME,      // IClip::GetFrame()
+            GET_AUDIO,      // IClip::GetAudio()
+            CONVERT_TO_RGB, // ConvertToRGB24/32 and the conversion of this
+                            // library
+            IMPORT,         // Import() of a script
+            NUMOF_KINDS
+        };
+
+        static const unsigned int numof_buckets = 36;
+
+        struct entry_type {
+            uint64_t count;
+            uint64_t total_ns;
+            uint64_t max_ns;
+            uint64_t histogram[numof_buckets];
+        };
+
+        entry_type entries[NUMOF_KINDS];
+
+        static const char* name(kind_type kind) {
+            static const char* const names[NUMOF_KINDS] = {
+                "GetFrame", "GetAudio", "ConvertToRGB", "Import"
+            };
+            return names[kind];
+        }
+
+        // Returns the upper bound of the latency that "ratio" (0 to 1) of
+        // calls of "kind" took, in nanoseconds.
+        uint64_t percentile_ns(kind_type kind, double ratio) const {
+            const entry_type& e = entries[kind];
+            uint64_t accumulated = 0;
+            for (unsigned int i = 0; i < numof_buckets; ++i) {
+                accumulated += e.histogram[i];
+                if (accumulated >= e.count * ratio && accumulated > 0) {
+                    return (i + 1 < numof_buckets)
+                        ? (static_cast<uint64_t>(1) << (i + 1))
+                        : e.max_ns;
+                }
+            }
+            return 0;
+        }
+    };
+
+    // Starts or stops the measurement.
+    void enable_metrics(bool enabled);
+    // Returns a snapshot of the measurements.
+    metrics_type metrics(void);
+    // Clears the measurements.
+    void reset_metrics(void);
+
+    // Writes the measurements in microseconds, a line for each kind.
+    inline std::ostream& operator<<(std::ostream& out, const metrics_type& m) {
+        for (unsigned int i = 0; i < metrics_type::NUMOF_KINDS; ++i) {
+            const metrics_type::kind_type kind =
+                static_cast<metrics_type::kind_type>(i);
+            const metrics_type::entry_type& e = m.entries[kind];
+            out << metrics_type::name(kind)
+                << ": count " << e.count
+                << ", total " << e.total_ns / 1000 << " us"
+                << ", mean " << (e.count > 0 ? e.total_ns / e.count / 1000 : 0)
+                << " us, p50 <= " << m.percentile_ns(kind, 0.5) / 1000
+                << " us, p99 <= " << m.percentile_ns(kind, 0.99) / 1000
+                << " us, max " << e.max_ns / 1000 << " us\n";
+        }
+        return out;
+    }
+
     /*
      *  a class to manage AVS files
+     *
+     *  The member functions of this class can be called from some threads at
+     *  the same time.  An object of avs_type can also be shared among
+     *  threads, but the objects returned by avs_type::video() and
+     *  avs_type::audio() should be used from one thread at a time.
      * */
     struct manager_type {
+        // statistics of the cache of loaded scripts
+        struct cache_stats_type {
+            uint64_t hits;      // load() returned a script loaded already
+            uint64_t misses;    // load() read in a script
+            uint64_t evictions; // scripts closed to keep the budget
+            uint64_t usage;     // bytes charged for the opened scripts now
+        };
+
+        // statistics of the pool of IScriptEnvironment
+        struct env_pool_stats_type {
+            uint64_t created;   // objects created
+            uint64_t reused;    // scripts imported into a pooled object
+            uint64_t deleted;   // objects deleted instead of being pooled
+        };
+
+        // statistics of the cache of informations for load_metadata()
+        struct metadata_cache_stats_type {
+            uint64_t hits;      // answered from the cache without importing
+            uint64_t misses;    // imported since not found or modified
+        };
+
         /*
          *  Reads the file that is located on "filepath" and returns the
-         *  reference of avs_type.
+         *  reference of avs_type.  The script loaded already is returned as
+         *  is, and that is closed by eviction is read in again.
+         *
+         *  Files named "*.y4m" (YUV4MPEG2 of 8-bit 4:2:0 or 4:2:2) and "*.wav"
+         *  (RIFF WAV of PCM or float) are read directly without AviSynth,
+         *  and the others are imported as AviSynth scripts.
          * */
         virtual avs_type& load(const char* filepath) = 0;
 
+        /*
+         *  Reads the files located on "filepaths" in parallel, each with its
+         *  own IScriptEnvironment, and returns the pointers of avs_type in
+         *  the same order.  The result is the same as calling load() for
+         *  each file, but this is faster when there are several scripts that
+         *  take long time to be imported.
+         * */
+        virtual std::vector<avs_type*>
+        load_all(const std::vector<std::string>& filepaths) = 0;
+
+        /*
+         *  Reads the file the same as load(), but closes the script at once
+         *  after reading its informations, if it has not been opened yet.
+         *  The IScriptEnvironment goes back to the pool (see env_pool()), so
+         *  this is the cheapest way to scan many scripts by
+         *  avs_type::video_info() and avs_type::audio_info().
+         *  avs_type::video() and avs_type::audio() open it again.
+         * */
+        virtual avs_type& load_metadata(const char* filepath) = 0;
+
+        /*
+         *  Makes load_metadata() keep the informations of scripts, the
+         *  results of is_fine() and errmsg() with them, in the file located
+         *  on "filepath", and answer from it without importing a script
+         *  while the script is not modified.  A script is identified by its
+         *  path, its modification time, its size and a hash of its content.
+         *  Files that a script imports or loads are not checked.
+         *
+         *  If "is_refreshed" is true, scripts are imported again and the
+         *  results replace those in the file.  NULL disables the cache, and
+         *  it is default.
+         * */
+        virtual void
+        metadata_cache(const char* filepath, bool is_refreshed = false) = 0;
+        virtual metadata_cache_stats_type metadata_cache_stats(void) const
+            = 0;
+
         /*
          *  Use this member function when you don't need an object of a class
          *  avs_type any longer and you are nervous about a space efficiency.
+         *  Each call of load(), load_all() and load_metadata() for a file
+         *  counts a reference, and the object is deleted when all of them
+         *  are unloaded, so that another thread loading the same file keeps
+         *  it.
          * */
         virtual void unload(const avs_type& avs) = 0;
 
-        // destructor
-        virtual ~manager_type(void) {}
-    };
-
-    /*
-     *  A class that has basic features about AVS, by wrapping classes defined
-     *  in avisynth.h.  E.g.:
-     *
-     *      - opening AVS file
-     *      - getting the object to get video informations / frame data
-     *      - getting the object to get audio informations / samples
-     * */
-    struct avs_type {
-        // Returns informations
-        // a file path of specified AVS
-        virtual const char* filepath(void) const = 0;
-        // a status of an object
-        virtual bool is_fine(void) const = 0;
-        // Some messages to show causes of an error when is_fine() returns
-        // false.
-        virtual const char* errmsg(void) const = 0;
+        /*
+         *  Sets the upper limit of memory for loaded scripts in bytes.  Each
+         *  script is charged by the upper limit of the frame cache of its
+         *  IScriptEnvironment.  When the total exceeds "bytes", the least
+         *  recently loaded scripts are closed: the objects of avs_type are
+         *  still valid and open the scripts again when needed.  Scripts
+         *  whose objects returned by avs_type::video() or avs_type::audio()
+         *  are not released are never closed, since those objects may still
+         *  be in use.  Release them by avs_type::release_video() and
+         *  avs_type::release_audio() after reading, and the scripts are
+         *  closed when a script is loaded or the budget is set next.
+         *
+         *  "script_memory_max" sets the limit of the frame cache of each
+         *  script in megabytes, by IScriptEnvironment::SetMemoryMax().
+         *
+         *  0 means unlimited for "bytes" and the default of AviSynth for
+         *  "script_memory_max", and those are default.
+         * */
+        virtual void budget(uint64_t bytes, uint32_t script_memory_max = 0) = 0;
+        virtual cache_stats_type cache_stats(void) const = 0;
 
-        // Returns the objects to treat video/audio.
-        virtual video_type& video(void) = 0;
-        virtual audio_type& audio(void) = 0;
+        /*
+         *  Keeps up to "capacity" objects of IScriptEnvironment of scripts
+         *  that are unloaded or closed, and imports the next scripts into
+         *  them.  This saves creating IScriptEnvironment and autoloading
+         *  plugins for each script, that is the most of the time to load a
+         *  small script.
+         *
+         *  Variables and functions that a script defines as global remain
+         *  in the object and are visible from scripts imported into it
+         *  later.  An object is not reused after a failed import nor after
+         *  some scripts, to bound them.  0 disables this, and it is default.
+         * */
+        virtual void env_pool(std::size_t capacity) = 0;
+        virtual env_pool_stats_type env_pool_stats(void) const = 0;
 
         // destructor
-        virtual ~avs_type(void) {}
+        virtual ~manager_type(void) {}
     };
 
     // a class for a video
     struct video_type {
+        /*
+         *  Enumerations for planes of a frame.  DEFAULT_PLANE denotes the
+         *  only plane of interleaved (packed) frames such as RGB and YUY2, or
+         *  Y plane of planar frames.
+         * */
+        enum plane_type {
+            DEFAULT_PLANE = 0,
+            Y_PLANE = 1 << 0,
+            U_PLANE = 1 << 1,
+            V_PLANE = 1 << 2
+        };
+
+        /*
+         *  Enumerations for the representations of frames to get
+         *
+         *      RGB24:  converted to RGB24 if needed
+         *      NATIVE: the color space of the clip as is, so there is no
+         *              cost for the conversion
+         *      RGB32:  converted to RGB32 if needed
+         *
+         *  RGB is stored in the order of B, G, R (and A) from the bottom row
+         *  of the picture, as well as AviSynth.
+         * */
+        enum format_type {
+            RGB24,
+            NATIVE,
+            RGB32
+        };
+
+        // the matrices to convert YUV to RGB
+        enum matrix_type {
+            BT601,  // SDTV, the default of AviSynth
+            BT709   // HDTV
+        };
+
+        // the ranges of YUV values
+        enum range_type {
+            TV_RANGE,   // Y: 16-235, U and V: 16-240
+            PC_RANGE    // 0-255
+        };
+
         // informations of a video
         struct info_type {
             /*
@@ -149,12 +377,101 @@ namespace avsutil {
                                         // frame-based if false
             bool is_tff;                // Top Field First if true,
                                         // Bottom Field First if false
+            uint16_t planes;            // a set of plane_type,
+                                        // 0 for interleaved frames
             /*
              *  This should be evaluated only when is_fieldbased is true.
              *  AviSynth doesn't contain this information (in 2.58)
              * */
             //bool is_progressive;        // progressive if true
                                           // interlaced if false
+
+            // Returns true if frames of the video have the plane.
+            bool has_plane(plane_type plane) const {
+                return plane == DEFAULT_PLANE || (planes & plane) != 0;
+            }
+        };
+
+        /*
+         *  An interface for a frame that is shared by objects of the class
+         *  frame_view.  Don't use this directly, use frame_view instead.
+         * */
+        struct frame_type {
+            // Returns the layout of the pixels of a plane.
+            virtual const uint8_t* read_ptr(plane_type plane) const = 0;
+            // bytes per scan line
+            virtual uint32_t pitch(plane_type plane) const = 0;
+            // effective bytes per scan line
+            virtual uint32_t row_size(plane_type plane) const = 0;
+            // a number of scan lines
+            virtual uint32_t height(plane_type plane) const = 0;
+
+            // reference counting
+            virtual void add_ref(void) = 0;
+            virtual void release(void) = 0;
+
+            protected:
+                // destructor
+                // An object is deleted by release() when it isn't referred.
+                virtual ~frame_type(void) {}
+        };
+
+        /*
+         *  A handle to read pixels of a frame directly, without copies and
+         *  streambufs.  This is reference counted and the frame is released
+         *  when the last handle goes out of scope.  Usage:
+         *
+         *      video_type::frame_view frame = video.frame(n);
+         *      for (uint32_t y = 0; y < frame.height(); ++y) {
+         *          const uint8_t* line = frame.read_ptr() + frame.pitch() * y;
+         *          // use frame.row_size() bytes from line
+         *      }
+         *
+         *  For planar frames, specify the plane like frame.read_ptr(U_PLANE).
+         * */
+        class frame_view {
+            private:
+                frame_type* mv_frame;
+
+            public:
+                // constructor
+                // The reference that "frame" already has is taken over.
+                explicit frame_view(frame_type* frame = NULL)
+                    : mv_frame(frame) {}
+                // copy constructor
+                frame_view(const frame_view& rhs) : mv_frame(rhs.mv_frame) {
+                    if (mv_frame != NULL) mv_frame->add_ref();
+                }
+                // destructor
+                ~frame_view(void) {
+                    if (mv_frame != NULL) mv_frame->release();
+                }
+
+                // assignment operator
+                frame_view& operator=(const frame_view& rhs) {
+                    if (rhs.mv_frame != NULL) rhs.mv_frame->add_ref();
+                    if (mv_frame != NULL) mv_frame->release();
+                    mv_frame = rhs.mv_frame;
+                    return *this;
+                }
+
+            public:
+                // Returns false if this refers no frame.
+                bool is_valid(void) const { return mv_frame != NULL; }
+
+                const uint8_t*
+                read_ptr(plane_type plane = DEFAULT_PLANE) const {
+                    return mv_frame->read_ptr(plane);
+                }
+                uint32_t pitch(plane_type plane = DEFAULT_PLANE) const {
+                    return mv_frame->pitch(plane);
+                }
+                uint32_t row_size(plane_type plane = DEFAULT_PLANE) const {
+                    return mv_frame->row_size(plane);
+                }
+                uint32_t height(plane_type plane = DEFAULT_PLANE) const {
+                    return mv_frame->height(plane);
+                }
         };
 
         // Returns informations about a video.
@@ -162,6 +479,174 @@ namespace avsutil {
         // Returns a nth frame stream object.
         virtual std::istream& framestream(uint32_t n) = 0;
         virtual void release_framestream(std::istream& target) = 0;
+        // Returns a handle to read pixels of a nth frame directly.
+        // The pixels are represented as RGB24 by default, same as
+        // framestream().
+        virtual frame_view frame(uint32_t n, format_type format = RGB24) = 0;
+
+        /*
+         *  Writes pixels of a nth frame converted to "format" (RGB24 or
+         *  RGB32) to "dst", that has "pitch" bytes for each row.  YV12, I420
+         *  and YUY2 are converted in this library by "matrix" and "range",
+         *  and chroma samples are upsampled by replication.  Returns false
+         *  if the color space of the clip can't be converted.
+         *
+         *  framestream() and frame() also use this conversion by BT601 and
+         *  TV_RANGE.
+         * */
+        virtual bool read_rgb( uint32_t n, uint8_t* dst, uint32_t pitch,
+                               format_type format = RGB24,
+                               matrix_type matrix = BT601,
+                               range_type range = TV_RANGE) = 0;
+
+        // statistics of prefetching
+        struct prefetch_stats_type {
+            uint64_t hits;      // frames that were rendered in advance
+            uint64_t misses;    // frames that were rendered on demand
+            uint64_t wasted;    // frames that were rendered in advance but
+                                // discarded without use
+        };
+
+        /*
+         *  Enables to render frames n+1..n+window in a background thread
+         *  after a nth frame is requested by framestream() or frame().
+         *  The window shrinks when frames are requested at random, and grows
+         *  up to "window" again while they are requested sequentially.
+         *  0 disables prefetching, and that is default.
+         * */
+        virtual void prefetch(uint32_t window) = 0;
+        virtual prefetch_stats_type prefetch_stats(void) const = 0;
+
+        // statistics of the frame cache
+        struct cache_stats_type {
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t evictions;
+        };
+
+        /*
+         *  Keeps frames returned by framestream() and frame() up to "bytes"
+         *  bytes, so that the same frame in the same format is not rendered
+         *  again.  Cached frames are shared with callers without copy, and
+         *  the frames that callers still have are never evicted.  The least
+         *  recently used frame is evicted first.  0 disables caching, and
+         *  that is default.
+         * */
+        virtual void cache_budget(uint64_t bytes) = 0;
+        virtual cache_stats_type cache_stats(void) const = 0;
+
+        /*
+         *  Tells how frames will be read.  "stride" is the distance between
+         *  frames for STRIDED.  This sets the cache hints of AviSynth and
+         *  tunes the layers of this library as follows:
+         *
+         *      ADAPTIVE:   AviSynth caches all.  The prefetcher goes
+         *                  forward and the frame cache keeps frames.
+         *      SEQUENTIAL: AviSynth caches a short range.  The prefetcher
+         *                  goes forward and the frame cache keeps nothing
+         *                  new.
+         *      REVERSE:    same as SEQUENTIAL but the prefetcher goes
+         *                  backward.
+         *      RANDOM:     AviSynth caches all.  The prefetcher is stopped
+         *                  and the frame cache keeps frames.
+         *      STRIDED:    AviSynth caches nothing.  The prefetcher goes
+         *                  forward by "stride" and the frame cache keeps
+         *                  nothing new.
+         *
+         *  The renderers returned by renderer() are not affected.
+         * */
+        virtual void access_hint(access_type access, uint32_t stride = 1) = 0;
+
+        // statistics of the memory pool for framestream() and frame()
+        struct pool_stats_type {
+            uint64_t allocations;   // blocks got from the heap
+            uint64_t reuses;        // blocks recycled in the pool
+        };
+
+        /*
+         *  Streams, frame handles and their bookkeeping are recycled in a
+         *  pool for each video_type object.  "allocations" stops growing
+         *  once reading frames in the same way reaches the steady state,
+         *  so this can be used to check that no heap allocation is done
+         *  for each frame.  The pixels are not included, they are managed
+         *  by AviSynth.
+         * */
+        virtual pool_stats_type pool_stats(void) const = 0;
+
+        /*
+         *  A class to render frames in parallel and to return them in order.
+         *  Use this as follows:
+         *
+         *      video_type::renderer_type& renderer =
+         *          video.renderer(0, video.info().numof_frames);
+         *      while (renderer.next()) {
+         *          write(renderer.number(), renderer.frame());
+         *      }
+         *      video.release_renderer(renderer);
+         *
+         *  next() throws std::runtime_error in place of a frame that fails to
+         *  render, after it returns the frames before that.
+         * */
+        struct renderer_type {
+            // Waits for the next frame.  Returns false at the end.
+            virtual bool next(void) = 0;
+            // Returns the number and the pixels of the current frame.
+            virtual uint32_t number(void) const = 0;
+            virtual frame_view frame(void) const = 0;
+
+            // destructor
+            virtual ~renderer_type(void) {}
+        };
+
+        /*
+         *  Returns a renderer for frames [first, last) in "format".  Each
+         *  worker thread opens the script by itself, so the script is
+         *  evaluated "numof_workers" times.  Workers go ahead at most
+         *  "buffer_size" frames.  0 means the number of processors and twice
+         *  the number of workers respectively.  YV12, I420 and YUY2 are
+         *  converted to RGB by BT601 and TV_RANGE.
+         * */
+        virtual renderer_type& renderer(uint32_t first, uint32_t last,
+                                        format_type format = RGB24,
+                                        uint32_t numof_workers = 0,
+                                        uint32_t buffer_size = 0) = 0;
+        virtual void release_renderer(renderer_type& target) = 0;
+
+        /*
+         *  A handle of a frame requested by request_frame().  Use this as
+         *  follows:
+         *
+         *      video_type::request_type& request = video.request_frame(n);
+         *      // do something else meanwhile
+         *      video_type::frame_view frame = request.get();
+         *      video.release_request(request);
+         *
+         *  get() throws std::runtime_error if the frame fails to render or
+         *  the request has been cancelled.
+         * */
+        struct request_type {
+            // Returns true if get() returns without waiting.
+            virtual bool is_ready(void) const = 0;
+            // Waits for the frame and returns it.
+            virtual frame_view get(void) = 0;
+            // Tells that the frame is no longer needed.  The frame is not
+            // rendered if no other request waits for it.
+            virtual void cancel(void) = 0;
+
+            // destructor
+            virtual ~request_type(void) {}
+        };
+
+        /*
+         *  Starts to render a nth frame in "format" in worker threads owned
+         *  by this object, and returns immediately.  Requests for the same
+         *  frame in flight are rendered once and share the result.  The
+         *  frame cache is looked up first, and the frame is kept in it as
+         *  well as frame().  Releasing a request cancels it.
+         * */
+        virtual request_type& request_frame(uint32_t n,
+                                            format_type format = RGB24) = 0;
+        virtual void release_request(request_type& target) = 0;
 
         // destructor
         virtual ~video_type(void) {}
@@ -187,9 +672,92 @@ namespace avsutil {
         // Returns input stream for audio samples.
         virtual std::istream& stream(void) = 0;
 
+        /*
+         *  Writes "count" samples from "start_sample" to "dst" directly,
+         *  without a buffer of the stream.  "dst" must have a space of
+         *  count * info().block_size bytes at least.  Returns a number of
+         *  samples written, that is less than "count" at the end of the
+         *  audio.
+         * */
+        virtual uint32_t
+        read(uint64_t start_sample, uint32_t count, void* dst) = 0;
+
+        /*
+         *  The planar version of read().  Samples of a channel c are written
+         *  to dst[c] as float normalized to [-1.0, 1.0].  "dst" must have
+         *  info().channels pointers, and each of them must have a space of
+         *  "count" floats at least.
+         * */
+        virtual uint32_t
+        read_planar(uint64_t start_sample, uint32_t count, float* const* dst)
+            = 0;
+
+        /*
+         *  Makes the stream returned by stream() get samples in a background
+         *  thread, into "numof_pages" pages of "page_size" bytes.  The next
+         *  pages are got while the current one is read, so getting and
+         *  consuming samples overlap.  "numof_pages" less than 2 disables
+         *  prefetching, and that is default.
+         * */
+        virtual void prefetch(uint32_t page_size, uint32_t numof_pages) = 0;
+
+        /*
+         *  Tells how samples will be read.  SEQUENTIAL disables the audio
+         *  cache of AviSynth, since prefetching does the work.  REVERSE,
+         *  RANDOM and STRIDED make AviSynth cache a second of samples and
+         *  stop prefetching, since it reads ahead only forward.  ADAPTIVE
+         *  lets AviSynth decide, and that is default.
+         * */
+        virtual void access_hint(access_type access) = 0;
+
         // destructor
         virtual ~audio_type(void) {}
     };
+
+    /*
+     *  A class that has basic features about AVS, by wrapping classes defined
+     *  in avisynth.h.  E.g.:
+     *
+     *      - opening AVS file
+     *      - getting the object to get video informations / frame data
+     *      - getting the object to get audio informations / samples
+     * */
+    struct avs_type {
+        // Returns informations
+        // a file path of specified AVS
+        virtual const char* filepath(void) const = 0;
+        // a status of an object
+        virtual bool is_fine(void) const = 0;
+        // Some messages to show causes of an error when is_fine() returns
+        // false.
+        virtual const char* errmsg(void) const = 0;
+
+        // Returns the objects to treat video/audio.
+        virtual video_type& video(void) = 0;
+        virtual audio_type& audio(void) = 0;
+
+        /*
+         *  Deletes the objects returned by video() and audio(), so that the
+         *  script can be closed to keep the budget of manager_type.  The
+         *  streams, frames and others got from them must be released
+         *  before.  video() and audio() create them again.
+         * */
+        virtual void release_video(void) = 0;
+        virtual void release_audio(void) = 0;
+
+        /*
+         *  Returns the informations of video/audio, the same as
+         *  video().info() and audio().info() without creating those
+         *  objects.  They are read once when the script is imported, and
+         *  are kept while the script is closed by eviction or by
+         *  manager_type::load_metadata().
+         * */
+        virtual const video_type::info_type& video_info(void) = 0;
+        virtual const audio_type::info_type& audio_info(void) = 0;
+
+        // destructor
+        virtual ~avs_type(void) {}
+    };
 };
 
 #endif // AVSUTIL_HPP
@@ -14,8 +14,13 @@
 #include "avisynth.h"
 
 #include "iaudiostream.hpp"
+#include "metrics.hpp"
 
 #include <istream>
+#include <vector>
+
+#include "../../helper/sample.hpp"
+#include "../../helper/thread.hpp"
 
 namespace avsutil {
     namespace impl {
@@ -24,17 +29,28 @@ namespace avsutil {
                 // variables
                 const PClip mv_clip;
                 IScriptEnvironment* mv_se;
+                util::thread::mutex& mv_se_lock;
                 const info_type mv_info;
-                std::istream* mv_stream;
+                iaudiostream* mv_stream;
+                uint32_t mv_page_size;
+                uint32_t mv_numof_pages;
+                access_type mv_access;
+
+                // constants
+                // a number of samples that read_planar() handles at a time
+                static const uint32_t planar_chunk = 4096;
 
             public:
                 // constructor
                 explicit caudio_type(   PClip clip, IScriptEnvironment* se,
+                                        util::thread::mutex& se_lock,
                                         const info_type& info)
-                : mv_clip(clip), mv_se(se), mv_info(info), mv_stream(NULL) {
+                : mv_clip(clip), mv_se(se), mv_se_lock(se_lock),
+                  mv_info(info), mv_stream(NULL),
+                  mv_page_size(0), mv_numof_pages(0), mv_access(ADAPTIVE) {
                     DBGLOG( "avsutil::impl::caudio_type::"
                             "caudio_type(PClip, IScriptEnvironment*,"
-                            " const info_type&)\n"
+                            " util::thread::mutex&, const info_type&)\n"
                             "exists: " << mv_info.exists << "\n"
                             "channels: " << mv_info.channels << "\n"
                             "bit_depth: " << mv_info.bit_depth << "\n"
@@ -81,11 +97,138 @@ namespace avsutil {
                             "stream(void)");
 
                     if (mv_stream == NULL) {
-                        mv_stream = new iaudiostream(mv_clip, mv_se);
+                        mv_stream =
+                            new iaudiostream(mv_clip, mv_se, mv_se_lock);
+                        const uint32_t numof_pages = pages_to_prefetch();
+                        if (numof_pages >= 2) {
+                            mv_stream->prefetch(mv_page_size, numof_pages);
+                        }
                     }
                     return *mv_stream;
                 }
 
+                uint32_t read(uint64_t start_sample, uint32_t count, void* dst) {
+                    DBGLOG( "avsutil::impl::caudio_type::"
+                            "read(" << start_sample << ", " << count
+                            << ", void*)");
+
+                    if (mv_info.numof_samples <= start_sample) return 0;
+                    const uint64_t remainder =
+                        mv_info.numof_samples - start_sample;
+                    if (remainder < count) {
+                        count = static_cast<uint32_t>(remainder);
+                    }
+
+                    util::thread::scoped_lock lock(mv_se_lock);
+                    scoped_timer t(metrics_type::GET_AUDIO);
+                    mv_clip->GetAudio(dst, start_sample, count, mv_se);
+                    return count;
+                }
+
+                uint32_t read_planar(   uint64_t start_sample, uint32_t count,
+                                        float* const* dst) {
+                    DBGLOG( "avsutil::impl::caudio_type::"
+                            "read_planar(" << start_sample << ", " << count
+                            << ", float* const*)");
+
+                    if (mv_info.numof_samples <= start_sample) return 0;
+                    const uint64_t remainder =
+                        mv_info.numof_samples - start_sample;
+                    if (remainder < count) {
+                        count = static_cast<uint32_t>(remainder);
+                    }
+
+                    // Samples are got, normalized and deinterleaved by
+                    // chunks in order to keep buffers in cache.
+                    const uint16_t channels = mv_info.channels;
+                    const util::sample::format_type format =
+                        sample_format(mv_clip->GetVideoInfo().SampleType());
+                    uint32_t chunk = planar_chunk;
+                    if (count < chunk) chunk = count;
+                    std::vector<char> raw(chunk * mv_info.block_size);
+                    std::vector<float> interleaved(chunk * channels);
+                    std::vector<float*> planes(dst, dst + channels);
+
+                    for (uint32_t done = 0; done < count;) {
+                        const uint32_t n = (count - done < chunk)
+                            ? count - done
+                            : chunk;
+                        {
+                            util::thread::scoped_lock lock(mv_se_lock);
+                            scoped_timer t(metrics_type::GET_AUDIO);
+                            mv_clip->GetAudio(
+                                    &raw[0], start_sample + done, n, mv_se);
+                        }
+                        util::sample::convert(
+                                &raw[0], format,
+                                &interleaved[0], util::sample::FLOAT,
+                                n * channels);
+                        util::sample::deinterleave(
+                                &interleaved[0], &planes[0], channels, n);
+
+                        for (uint16_t c = 0; c < channels; ++c) planes[c] += n;
+                        done += n;
+                    }
+                    return count;
+                }
+
+                void prefetch(uint32_t page_size, uint32_t numof_pages) {
+                    DBGLOG( "avsutil::impl::caudio_type::"
+                            "prefetch(" << page_size << ", "
+                            << numof_pages << ")");
+
+                    mv_page_size = page_size;
+                    mv_numof_pages = numof_pages;
+                    if (mv_stream != NULL) {
+                        mv_stream->prefetch(
+                                mv_page_size, pages_to_prefetch());
+                    }
+                }
+
+                void access_hint(access_type access) {
+                    DBGLOG( "avsutil::impl::caudio_type::"
+                            "access_hint(" << access << ")");
+
+                    const access_type previous = mv_access;
+                    mv_access = access;
+                    {
+                        util::thread::scoped_lock lock(mv_se_lock);
+                        switch (mv_access) {
+                            case SEQUENTIAL:
+                                mv_clip->SetCacheHints(CACHE_AUDIO_NONE, 0);
+                                break;
+                            case REVERSE:
+                            case RANDOM:
+                            case STRIDED:
+                                // a second of samples in bytes
+                                mv_clip->SetCacheHints(CACHE_AUDIO,
+                                        mv_info.sampling_rate
+                                        * mv_info.block_size);
+                                break;
+                            case ADAPTIVE:
+                            default:
+                                mv_clip->SetCacheHints(CACHE_AUDIO_AUTO, 0);
+                                break;
+                        }
+                    }
+
+                    if (       mv_stream != NULL
+                            && is_forward(previous) != is_forward(mv_access)) {
+                        mv_stream->prefetch(mv_page_size, pages_to_prefetch());
+                    }
+                }
+
+            private:
+                // Prefetching reads ahead only forward.
+                static bool is_forward(access_type access) {
+                    return access == ADAPTIVE || access == SEQUENTIAL;
+                }
+
+                // Returns a number of pages to prefetch for "mv_access".
+                uint32_t pages_to_prefetch(void) const {
+                    return is_forward(mv_access) ? mv_numof_pages : 0;
+                }
+
             public:
                 // utility functions
                 static const unsigned int bit_depth(const int sample_type) {
@@ -107,6 +250,18 @@ namespace avsutil {
                             return 0;
                     }
                 }
+
+                static util::sample::format_type
+                sample_format(const int sample_type) {
+                    switch (sample_type) {
+                        case SAMPLE_INT8:   return util::sample::INT8;
+                        case SAMPLE_INT16:  return util::sample::INT16;
+                        case SAMPLE_INT24:  return util::sample::INT24;
+                        case SAMPLE_INT32:  return util::sample::INT32;
+                        case SAMPLE_FLOAT:
+                        default:            return util::sample::FLOAT;
+                    }
+                }
         };
     }
 }
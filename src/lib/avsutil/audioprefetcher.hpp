@@ -0,0 +1,219 @@
+/*
+ * audioprefetcher.hpp
+ *  Declarations and definitions of a class audioprefetcher
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef AUDIOPREFETCHER_HPP
+#define AUDIOPREFETCHER_HPP
+
+#include "avisynth.h"
+
+#include "metrics.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to get audio samples in advance in a background thread.
+         *
+         *  Samples are stored in a ring of pages.  While the consumer reads
+         *  the page returned by acquire(), the background thread fills the
+         *  following pages by GetAudio().  The page is reused after the next
+         *  call of acquire().
+         *
+         *  An object of IScriptEnvironment is not thread-safe, so every
+         *  GetAudio() is called with "se_lock" locked.
+         * */
+        class audioprefetcher : public util::thread::thread {
+            public:
+                // a page of samples
+                struct page_type {
+                    std::vector<char> buf;
+                    uint64_t start;     // the first sample in "buf"
+                    uint32_t count;     // a number of samples in "buf"
+                };
+
+            private:
+                // variables
+                const PClip clip;
+                IScriptEnvironment* se;
+                util::thread::mutex& se_lock;
+                const uint32_t sample_size;
+                const uint64_t numof_samples;
+                const uint32_t samples_per_page;
+
+                // the following variables are guarded by "lock"
+                util::thread::mutex lock;
+                util::thread::condition cond;
+                std::vector<page_type> pages;
+                std::size_t head;       // the oldest page filled
+                std::size_t filled;     // a number of pages filled
+                bool is_held;           // true if "head" is read by consumer
+                uint64_t next;          // the sample to get next
+                bool is_rendering;
+                bool is_stopping;
+                unsigned int generation;    // incremented by seek()
+                std::string errmsg;
+
+            public:
+                // constructor
+                audioprefetcher(PClip clip, IScriptEnvironment* se,
+                                util::thread::mutex& se_lock,
+                                uint64_t position,
+                                uint32_t page_size, uint32_t numof_pages)
+                    : clip(clip), se(se), se_lock(se_lock),
+                      sample_size(clip->GetVideoInfo().BytesPerAudioSample()),
+                      numof_samples(clip->GetVideoInfo().num_audio_samples),
+                      samples_per_page(page_size < sample_size
+                              ? 1 : page_size / sample_size),
+                      pages(numof_pages),
+                      head(0), filled(0), is_held(false), next(position),
+                      is_rendering(false), is_stopping(false),
+                      generation(0) {
+                    DBGLOG( "avsutil::impl::audioprefetcher::"
+                            "audioprefetcher(PClip, IScriptEnvironment*, "
+                            "util::thread::mutex&, " << position << ", "
+                            << page_size << ", " << numof_pages << ")");
+                    for (std::size_t i = 0; i < pages.size(); ++i) {
+                        pages[i].buf.resize(sample_size * samples_per_page);
+                        pages[i].start = 0;
+                        pages[i].count = 0;
+                    }
+                    start();
+                }
+
+                // destructor
+                ~audioprefetcher(void) {
+                    DBGLOG( "avsutil::impl::audioprefetcher::"
+                            "~audioprefetcher(void)");
+                    {
+                        util::thread::scoped_lock l(lock);
+                        is_stopping = true;
+                        cond.notify_all();
+                    }
+                    join();
+                }
+
+            private:
+                // copy constructor
+                audioprefetcher(const audioprefetcher& rhs);
+                // assignment operator
+                audioprefetcher& operator=(const audioprefetcher& rhs);
+
+            public:
+                /*
+                 *  Releases the page returned last time and returns the next
+                 *  page, waiting for it to be filled.  Returns NULL at the end
+                 *  of the audio.
+                 * */
+                const page_type* acquire(void) {
+                    DBGLOG("avsutil::impl::audioprefetcher::acquire(void)");
+
+                    util::thread::scoped_lock l(lock);
+                    if (is_held) {
+                        head = (head + 1) % pages.size();
+                        --filled;
+                        is_held = false;
+                        cond.notify_all();
+                    }
+
+                    while (filled == 0) {
+                        if (!errmsg.empty()) {
+                            const std::string msg(errmsg);
+                            errmsg.clear();
+                            throw std::runtime_error(msg);
+                        }
+                        if (!is_rendering && numof_samples <= next) {
+                            DBGLOG("reached to the end of avs audio stream");
+                            return NULL;
+                        }
+                        cond.wait(lock);
+                    }
+
+                    is_held = true;
+                    return &pages[head];
+                }
+
+                // Discards all pages and starts over from "position".
+                void seek(uint64_t position) {
+                    DBGLOG( "avsutil::impl::audioprefetcher::"
+                            "seek(" << position << ")");
+
+                    util::thread::scoped_lock l(lock);
+                    ++generation;
+                    filled = 0;
+                    is_held = false;
+                    next = position;
+                    errmsg.clear();
+                    cond.notify_all();
+                }
+
+            protected:
+                // an implementation of util::thread::thread::run()
+                void run(void) {
+                    util::thread::scoped_lock l(lock);
+                    while (!is_stopping) {
+                        if (       filled == pages.size()
+                                || numof_samples <= next
+                                || !errmsg.empty()) {
+                            cond.wait(lock);
+                            continue;
+                        }
+
+                        // Pages are filled in order, so the page following
+                        // the filled ones is free.
+                        page_type& page = pages[(head + filled) % pages.size()];
+                        const unsigned int current = generation;
+                        const uint64_t first = next;
+                        const uint64_t remainder = numof_samples - first;
+                        const uint32_t count =
+                            (samples_per_page < remainder)
+                            ? samples_per_page
+                            : static_cast<uint32_t>(remainder);
+                        next += count;
+                        is_rendering = true;
+
+                        std::string failure;
+                        {
+                            util::thread::scoped_unlock u(lock);
+                            util::thread::scoped_lock sl(se_lock);
+                            try {
+                                scoped_timer t(metrics_type::GET_AUDIO);
+                                clip->GetAudio(&page.buf[0], first, count, se);
+                            }
+                            catch (AvisynthError& avserr) {
+                                failure = avserr.msg;
+                            }
+                            catch (std::exception& ex) {
+                                failure = ex.what();
+                            }
+                        }
+
+                        is_rendering = false;
+                        if (current == generation) {
+                            if (failure.empty()) {
+                                page.start = first;
+                                page.count = count;
+                                ++filled;
+                            }
+                            else {
+                                errmsg = failure;
+                            }
+                        }
+                        cond.notify_all();
+                    }
+                }
+        };
+    }
+}
+
+#endif // AUDIOPREFETCHER_HPP
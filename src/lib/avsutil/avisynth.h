@@ -332,7 +332,9 @@ class AVSValue;
 // is overloaded to recycle class instances.
 
 class VideoFrame {
-  int refcount;
+  // avsutil: "long" for the casts to "long*" below on LP64 systems.  This is
+  // the same as "int" on Windows.
+  long refcount;
   VideoFrameBuffer* const vfb;
   const int offset, pitch, row_size, height, offsetU, offsetV, pitchUV;  // U&V offsets are from top of picture.
 
@@ -346,7 +348,11 @@ class VideoFrame {
   VideoFrame(VideoFrameBuffer* _vfb, int _offset, int _pitch, int _row_size, int _height);
   VideoFrame(VideoFrameBuffer* _vfb, int _offset, int _pitch, int _row_size, int _height, int _offsetU, int _offsetV, int _pitchUV);
 
-  void* operator new(unsigned size);
+  // avsutil: "size_t" is "unsigned" on Win32, and is required on LP64.
+  void* operator new(size_t size);
+  // avsutil: the pair of operator new, defined only by the stand-in that
+  // deletes frames
+  void operator delete(void* p);
 // TESTME: OFFSET U/V may be switched to what could be expected from AVI standard!
 public:
   int GetPitch() const { return pitch; }
@@ -422,7 +428,8 @@ enum {
 class IClip {
   friend class PClip;
   friend class AVSValue;
-  int refcnt;
+  // avsutil: see VideoFrame::refcount
+  long refcnt;
   void AddRef() { InterlockedIncrement((long *)&refcnt); }
   void Release() { InterlockedDecrement((long *)&refcnt); if (!refcnt) delete this; }
 public:
@@ -576,8 +583,9 @@ private:
     if (!init && IsClip() && clip)
       clip->Release();
     // make sure this copies the whole struct!
-    ((int32_t*)this)[0] = ((int32_t*)src)[0];
-    ((int32_t*)this)[1] = ((int32_t*)src)[1];
+    // avsutil: 2 words on Win32, and more with 64-bit pointers.
+    for (unsigned i = 0; i < sizeof(AVSValue) / sizeof(int32_t); ++i)
+      ((int32_t*)this)[i] = ((int32_t*)src)[i];
   }
 };
 
@@ -15,49 +15,87 @@
 
 #include "video_impl.hpp"
 #include "audio_impl.hpp"
+#include "envpool.hpp"
+#include "metrics.hpp"
+#include "sources.hpp"
 
 #include <memory>
 #include <string>
 
 #include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
 
 namespace avsutil {
     namespace impl {
         class cavs_type : public avs_type {
+            public:
+                /*
+                 *  The state of this object for cmanager_type, which reads
+                 *  it while it holds its own lock.  This is guarded by
+                 *  mv_state_lock, which is locked last, so that it is read
+                 *  without waiting for an import.
+                 * */
+                struct state_type {
+                    bool is_opened;
+                    bool is_fine;
+                    uint64_t memory_max;    // by SetMemoryMax() in bytes
+                };
+
             private:
                 // variables
 
                 /*
-                 *  "delete"ing the object of IScriptEnvironment in the
-                 *  destructor in this class is a cause of an unknown exception
-                 *  with the AviSynth function FFMpegSource that is difficult
-                 *  to cope: maybe, because the time to call the destructor is
-                 *  too early.
-                 *  So there is a need for delaying a release of the object, by
-                 *  using std::auto_ptr.
+                 *  "delete"ing the object of IScriptEnvironment before the
+                 *  clip is released is a cause of an unknown exception with
+                 *  the AviSynth function FFMpegSource that is difficult to
+                 *  cope.  So the object is given back to "mv_pool" only after
+                 *  the objects of video and audio and the clip are released.
                  * */
-                std::auto_ptr<IScriptEnvironment> mv_se;
+                envpool& mv_pool;
+                envpool::lease_type mv_se;
+                /*
+                 *  Three locks to be used from some threads:
+                 *
+                 *      mv_lock:        guards member variables of this
+                 *                      object
+                 *      mv_se_lock:     serializes calls for mv_se
+                 *      mv_state_lock:  guards mv_state
+                 *
+                 *  Lock them in this order when some of them are needed.
+                 * */
+                mutable util::thread::mutex mv_lock;
+                mutable util::thread::mutex mv_se_lock;
+                mutable util::thread::mutex mv_state_lock;
+                state_type mv_state;
                 PClip mv_clip;
                 bool mv_is_fine;
                 std::string mv_filepath;
                 std::string mv_errmsg;
                 video_type* mv_video;
                 audio_type* mv_audio;
+                // read when imported and kept after closed
+                bool mv_has_info;
+                cvideo_type::info_type mv_video_info;
+                caudio_type::info_type mv_audio_info;
 
             public:
                 // constructor
-                cavs_type(void)
-                : mv_se(CreateScriptEnvironment()), mv_is_fine(true),
-                  mv_video(NULL), mv_audio(NULL) {
-                    DBGLOG("avsutil::impl::cavs_type::cavs_type(void)");
+                explicit cavs_type(envpool& pool)
+                : mv_pool(pool),
+                  mv_is_fine(true), mv_video(NULL), mv_audio(NULL),
+                  mv_has_info(false),
+                  mv_video_info(), mv_audio_info() {
+                    DBGLOG("avsutil::impl::cavs_type::cavs_type(envpool&)");
+                    mv_state.is_opened = false;
+                    mv_state.is_fine = true;
+                    mv_state.memory_max = 0;
                 }
 
             public:
                 // destructor
                 ~cavs_type(void) {
                     DBGLOG("avsutil::impl::cavs_type::~cavs_type(void)");
-                    if (mv_audio != NULL) delete mv_audio;
-                    if (mv_video != NULL) delete mv_video;
+                    close_nolock();
                 }
 
             public:
@@ -85,8 +123,14 @@ namespace avsutil {
                 const char* filepath(void) const {
                     return mv_filepath.c_str();
                 }
-                bool is_fine(void) const { return mv_is_fine; }
-                const char* errmsg(void) const { return mv_errmsg.c_str(); }
+                bool is_fine(void) const {
+                    util::thread::scoped_lock lock(mv_lock);
+                    return mv_is_fine;
+                }
+                const char* errmsg(void) const {
+                    util::thread::scoped_lock lock(mv_lock);
+                    return mv_errmsg.c_str();
+                }
 
                 /*
                  *  An object of a class cavs_type has a possession of mv_se,
@@ -94,66 +138,195 @@ namespace avsutil {
                  *  mv_se.
                  * */
                 video_type& video(void) {
-                    const VideoInfo& vi = mv_clip->GetVideoInfo();
-                    const cvideo_type::info_type info = {
-                        vi.HasVideo(),
-                        vi.width,
-                        vi.height,
-                        static_cast<double>(vi.num_frames) * vi.fps_denominator
-                            / vi.fps_numerator,
-                        static_cast<double>(vi.fps_numerator) / vi.fps_denominator,
-                        vi.fps_numerator,
-                        vi.fps_denominator,
-                        vi.num_frames,
-                        cvideo_type::fourcc(vi.pixel_type),
-                        vi.BitsPerPixel(),
-                        vi.IsFieldBased(),
-                        vi.IsTFF()
-                    };
-
-                    if (mv_video == NULL) mv_video =
-                        new cvideo_type(mv_clip, mv_se.get(), info);
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_video == NULL) {
+                        if (mv_se.get() == NULL) {
+                            open_nolock(mv_filepath.c_str());
+                        }
+                        mv_video = new cvideo_type(
+                                mv_clip, mv_se.get(), mv_se_lock,
+                                mv_video_info, mv_filepath);
+                    }
                     return *mv_video;
                 }
 
                 audio_type& audio(void) {
-                    const VideoInfo& vi = mv_clip->GetVideoInfo();
-                    const caudio_type::info_type info = {
-                        vi.HasAudio(),
-                        vi.AudioChannels(),
-                        caudio_type::bit_depth(vi.sample_type),
-                        (vi.sample_type == SAMPLE_FLOAT ? false : true),
-                        static_cast<double>(vi.num_audio_samples)
-                            / vi.SamplesPerSecond(),
-                        vi.SamplesPerSecond(),
-                        vi.num_audio_samples,
-                        vi.BytesPerAudioSample()
-                    };
-
-                    if (mv_audio == NULL) mv_audio =
-                        new caudio_type(mv_clip, mv_se.get(), info);
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_audio == NULL) {
+                        if (mv_se.get() == NULL) {
+                            open_nolock(mv_filepath.c_str());
+                        }
+                        mv_audio = new caudio_type(
+                                mv_clip, mv_se.get(), mv_se_lock,
+                                mv_audio_info);
+                    }
                     return *mv_audio;
                 }
 
+                void release_video(void) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_video != NULL) {
+                        delete mv_video;
+                        mv_video = NULL;
+                    }
+                }
+
+                void release_audio(void) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_audio != NULL) {
+                        delete mv_audio;
+                        mv_audio = NULL;
+                    }
+                }
+
+                /*
+                 *  The informations are not read again once the script has
+                 *  been imported, even if that failed.  Then "exists" of
+                 *  them is false.
+                 * */
+                const video_type::info_type& video_info(void) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (!mv_has_info) open_nolock(mv_filepath.c_str());
+                    return mv_video_info;
+                }
+
+                const audio_type::info_type& audio_info(void) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (!mv_has_info) open_nolock(mv_filepath.c_str());
+                    return mv_audio_info;
+                }
+
             public:
                 // utility functions
                 // Opens AVS file and sets some member variables.
                 void open(const char* avsfile) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    open_nolock(avsfile);
+                }
+
+                // Opens AVS file only if it isn't opened or failed to open.
+                void open_if_needed(const char* avsfile) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_se.get() == NULL || !mv_is_fine) {
+                        open_nolock(avsfile);
+                    }
+                }
+
+                /*
+                 *  Reads the informations of AVS file and closes it at once,
+                 *  unless they were read already or it failed to open.  A
+                 *  script opened already is left as is.
+                 * */
+                void read_info_if_needed(const char* avsfile) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_has_info && mv_is_fine) return;
+
+                    open_nolock(avsfile);
+                    close_nolock();
+                }
+
+                /*
+                 *  Sets the informations and the status read from a cache
+                 *  instead of importing AVS file.  This is ignored when it
+                 *  is opened already, or it has been imported successfully.
+                 * */
+                void restore(   const char* avsfile, bool is_fine,
+                                const std::string& errmsg,
+                                const video_type::info_type& video_info,
+                                const audio_type::info_type& audio_info) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (mv_se.get() != NULL || (mv_has_info && mv_is_fine)) {
+                        return;
+                    }
+
+                    set_filepath_nolock(avsfile);
+                    mv_is_fine = is_fine;
+                    mv_errmsg = errmsg;
+                    mv_has_info = true;
+                    mv_video_info = video_info;
+                    mv_audio_info = audio_info;
+                    publish_nolock(0);
+                }
+
+                /*
+                 *  Releases the clip and IScriptEnvironment to save memory,
+                 *  and returns true.  This object is still alive and will be
+                 *  opened again by open(), video() or audio().  Returns false
+                 *  without doing anything if the objects of video() or
+                 *  audio() are not released, since the callers may still use
+                 *  them, or if another thread uses this object, e.g. to
+                 *  import it.
+                 * */
+                bool close_if_idle(void) {
+                    if (!mv_lock.try_lock()) return false;
+                    const bool is_idle = (mv_video == NULL && mv_audio == NULL);
+                    if (is_idle) close_nolock();
+                    mv_lock.unlock();
+                    return is_idle;
+                }
+
+                state_type state(void) const {
+                    util::thread::scoped_lock lock(mv_state_lock);
+                    return mv_state;
+                }
+
+                /*
+                 *  Sets the upper limit of memory that IScriptEnvironment
+                 *  uses for caching frames, by SetMemoryMax(), in megabytes.
+                 *  0 is ignored.  try_memory_max() returns false without
+                 *  doing anything if another thread uses this object.
+                 * */
+                void memory_max(uint32_t megabytes) {
+                    util::thread::scoped_lock lock(mv_lock);
+                    memory_max_nolock(megabytes);
+                }
+                bool try_memory_max(uint32_t megabytes) {
+                    if (!mv_lock.try_lock()) return false;
+                    memory_max_nolock(megabytes);
+                    mv_lock.unlock();
+                    return true;
+                }
+
+            private:
+                // These must be called with mv_lock locked.
+                void open_nolock(const char* avsfile) {
                     DBGLOG("avsutil::impl::cavs_type::open(\"" << avsfile << "\")");
 
-                    try {
-                        // pack the filename as the argument of AviSynth filter
-                        AVSValue filename = avsfile;
-                        AVSValue args = AVSValue(&filename, 1);
+                    // The informations read by a successful import are
+                    // not rewritten, since video_info() and audio_info()
+                    // have handed them out to other threads.
+                    const bool keeps_info = mv_has_info && mv_is_fine;
+
+                    // Start over if opened already.
+                    close_nolock();
+                    mv_is_fine = true;
+                    mv_errmsg.clear();
+                    // These are left empty if the import fails.
+                    if (!keeps_info) {
+                        mv_has_info = true;
+                        mv_video_info = cvideo_type::info_type();
+                        mv_audio_info = caudio_type::info_type();
+                    }
+                    // store filename
+                    set_filepath_nolock(avsfile);
 
-                        // load AviSynth script
-                        AVSValue imported = mv_se->Invoke("Import", args, 0);
+                    try {
+                        if (!mv_pool.acquire(mv_se)) {
+                            mv_is_fine = false;
+                            mv_errmsg = "Can't create IScriptEnvironment";
+                            publish_nolock(0);
+                            return;
+                        }
 
-                        // get the clip and video informations
-                        mv_clip = imported.AsClip();
+                        // load AviSynth script or a file of a native backend
+                        util::thread::scoped_lock se_lock(mv_se_lock);
+                        scoped_timer t(metrics_type::IMPORT);
+                        mv_clip = open_source(avsfile, mv_se.get());
 
-                        // store filename
-                        mv_filepath = avsfile;
+                        // get the video informations
+                        if (!keeps_info) {
+                            read_info_nolock(mv_clip->GetVideoInfo());
+                        }
                     }
                     catch (AvisynthError& avserr) {
                         mv_is_fine = false;
@@ -163,11 +336,92 @@ namespace avsutil {
                         mv_is_fine = false;
                         mv_errmsg = ex.what();
                     }
+
+                    // SetMemoryMax() returns the current value without
+                    // changes when 0 is passed.
+                    uint64_t memory_max = 0;
+                    if (mv_se.get() != NULL) {
+                        util::thread::scoped_lock se_lock(mv_se_lock);
+                        memory_max =
+                            static_cast<uint64_t>(mv_se->SetMemoryMax(0)) << 20;
+                    }
+                    publish_nolock(memory_max);
+                }
+
+                // filepath() is read without mv_lock, e.g. by unload() of
+                // cmanager_type while another thread opens this again, so
+                // the same path is not written again.
+                void set_filepath_nolock(const char* avsfile) {
+                    if (mv_filepath != avsfile) mv_filepath = avsfile;
                 }
 
-                // to identify
-                bool is_me(const char* filepath) const {
-                    return (mv_filepath.compare(filepath) == 0);
+                void memory_max_nolock(uint32_t megabytes) {
+                    if (megabytes == 0 || mv_se.get() == NULL) return;
+
+                    util::thread::scoped_lock se_lock(mv_se_lock);
+                    publish_nolock(
+                            static_cast<uint64_t>(
+                                mv_se->SetMemoryMax(megabytes)) << 20);
+                }
+
+                // Copies the current state for state().
+                void publish_nolock(uint64_t memory_max) {
+                    util::thread::scoped_lock lock(mv_state_lock);
+                    mv_state.is_opened = (mv_se.get() != NULL);
+                    mv_state.is_fine = mv_is_fine;
+                    mv_state.memory_max = memory_max;
+                }
+
+                // Computes the informations once for video() and audio().
+                void read_info_nolock(const VideoInfo& vi) {
+                    const cvideo_type::info_type video = {
+                        vi.HasVideo(),
+                        static_cast<uint32_t>(vi.width),
+                        static_cast<uint32_t>(vi.height),
+                        static_cast<double>(vi.num_frames) * vi.fps_denominator
+                            / vi.fps_numerator,
+                        static_cast<double>(vi.fps_numerator)
+                            / vi.fps_denominator,
+                        vi.fps_numerator,
+                        vi.fps_denominator,
+                        static_cast<uint32_t>(vi.num_frames),
+                        cvideo_type::fourcc(vi.pixel_type),
+                        static_cast<uint16_t>(vi.BitsPerPixel()),
+                        vi.IsFieldBased(),
+                        vi.IsTFF(),
+                        cvideo_type::planes(vi.pixel_type)
+                    };
+                    mv_video_info = video;
+
+                    const caudio_type::info_type audio = {
+                        vi.HasAudio(),
+                        static_cast<uint16_t>(vi.AudioChannels()),
+                        static_cast<uint16_t>(
+                                caudio_type::bit_depth(vi.sample_type)),
+                        (vi.sample_type == SAMPLE_FLOAT ? false : true),
+                        static_cast<double>(vi.num_audio_samples)
+                            / vi.SamplesPerSecond(),
+                        static_cast<uint32_t>(vi.SamplesPerSecond()),
+                        static_cast<uint64_t>(vi.num_audio_samples),
+                        static_cast<uint16_t>(vi.BytesPerAudioSample())
+                    };
+                    mv_audio_info = audio;
+                }
+
+                void close_nolock(void) {
+                    DBGLOG("avsutil::impl::cavs_type::close(void)");
+
+                    if (mv_audio != NULL) {
+                        delete mv_audio;
+                        mv_audio = NULL;
+                    }
+                    if (mv_video != NULL) {
+                        delete mv_video;
+                        mv_video = NULL;
+                    }
+                    mv_clip = PClip();
+                    mv_pool.release(mv_se, mv_is_fine);
+                    publish_nolock(0);
                 }
         };
     }
@@ -9,6 +9,7 @@
 #include "../../include/avsutil.hpp"
 
 #include "manager_impl.hpp"
+#include "metrics.hpp"
 
 namespace avsutil {
     const char* version(void) {
@@ -28,9 +29,33 @@ namespace avsutil {
     }
 
     // implementations for functions
+    namespace {
+        // Local static variables are not initialized in a thread-safe way
+        // with some compilers, so these are constructed before main().
+        impl::cmetrics the_metrics;
+        impl::cmanager_type the_manager;
+    }
+
     manager_type& manager(void) {
-        static impl::cmanager_type manager;
-        return manager;
+        return the_manager;
+    }
+
+    void enable_metrics(bool enabled) {
+        the_metrics.enable(enabled);
+    }
+
+    metrics_type metrics(void) {
+        return the_metrics.snapshot();
+    }
+
+    void reset_metrics(void) {
+        the_metrics.reset();
+    }
+
+    namespace impl {
+        cmetrics& metrics_registry(void) {
+            return the_metrics;
+        }
     }
 }
 
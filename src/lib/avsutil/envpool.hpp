@@ -0,0 +1,197 @@
+/*
+ * envpool.hpp
+ *  Declarations and definitions of a class envpool
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef ENVPOOL_HPP
+#define ENVPOOL_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "avisynth.h"
+
+#include <vector>
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to keep objects of IScriptEnvironment that scripts were
+         *  imported into, so that the next script skips creating one and
+         *  autoloading plugins.
+         *
+         *  An object is recycled only after all clips of the script are
+         *  released, and its limit of the frame cache is set back to the
+         *  initial value.  Variables and functions that a script defined as
+         *  global remain, so an object is deleted after "max_uses" scripts
+         *  to bound them.  The capacity is 0 by default, and then objects
+         *  are deleted as before.
+         * */
+        class envpool {
+            public:
+                // typedefs
+                typedef manager_type::env_pool_stats_type stats_type;
+
+            private:
+                struct entry_type {
+                    IScriptEnvironment* se;
+                    int memory_max;     // the initial value in megabytes
+                    unsigned int uses;  // scripts imported so far
+                };
+
+                // constants
+                static const unsigned int max_uses = 64;
+
+            private:
+                // variables guarded by "lock"
+                util::thread::mutex lock;
+                std::vector<entry_type> idle;
+                std::size_t mv_capacity;
+                stats_type stats;
+
+            public:
+                // a handle of IScriptEnvironment lent by the pool
+                class lease_type {
+                    private:
+                        friend class envpool;
+                        entry_type entry;
+
+                    public:
+                        // constructor
+                        lease_type(void) {
+                            entry.se = NULL;
+                            entry.memory_max = 0;
+                            entry.uses = 0;
+                        }
+
+                    public:
+                        IScriptEnvironment* get(void) const {
+                            return entry.se;
+                        }
+                        IScriptEnvironment* operator->(void) const {
+                            return entry.se;
+                        }
+                };
+
+            public:
+                // constructor
+                envpool(void) : mv_capacity(0) {
+                    DBGLOG("avsutil::impl::envpool::envpool(void)");
+                    stats.created = stats.reused = stats.deleted = 0;
+                }
+
+                // destructor
+                ~envpool(void) {
+                    DBGLOG("avsutil::impl::envpool::~envpool(void)");
+                    for (std::vector<entry_type>::iterator itr = idle.begin();
+                            itr != idle.end(); ++itr) {
+                        delete itr->se;
+                    }
+                }
+
+            private:
+                // copy constructor
+                envpool(const envpool& rhs);
+                // assignment operator
+                envpool& operator=(const envpool& rhs);
+
+            public:
+                // Sets the number of idle objects to keep.
+                void capacity(std::size_t n) {
+                    DBGLOG("avsutil::impl::envpool::capacity(" << n << ")");
+
+                    std::vector<entry_type> deleted;
+                    {
+                        util::thread::scoped_lock l(lock);
+                        mv_capacity = n;
+                        while (idle.size() > mv_capacity) {
+                            deleted.push_back(idle.back());
+                            idle.pop_back();
+                            ++stats.deleted;
+                        }
+                    }
+                    // IScriptEnvironment is deleted without the lock,
+                    // because it may take long time.
+                    for (std::vector<entry_type>::iterator itr =
+                                deleted.begin();
+                            itr != deleted.end(); ++itr) {
+                        delete itr->se;
+                    }
+                }
+
+                /*
+                 *  Lends an object to "lease".  Returns false if it can't be
+                 *  created.  CreateScriptEnvironment() is called without the
+                 *  lock, so that some threads can create them at a time.
+                 * */
+                bool acquire(lease_type& lease) {
+                    {
+                        util::thread::scoped_lock l(lock);
+                        if (!idle.empty()) {
+                            DBGLOG("reuse IScriptEnvironment");
+                            lease.entry = idle.back();
+                            idle.pop_back();
+                            ++lease.entry.uses;
+                            ++stats.reused;
+                            return true;
+                        }
+                    }
+
+                    IScriptEnvironment* se = CreateScriptEnvironment();
+                    if (se == NULL) return false;
+
+                    lease.entry.se = se;
+                    // SetMemoryMax() returns the current value without
+                    // changes when 0 is passed.
+                    lease.entry.memory_max = se->SetMemoryMax(0);
+                    lease.entry.uses = 1;
+
+                    util::thread::scoped_lock l(lock);
+                    ++stats.created;
+                    return true;
+                }
+
+                /*
+                 *  Takes the object back from "lease".  All clips got from it
+                 *  must be released already.  "is_reusable" is false when
+                 *  the object may be broken, e.g. the import failed.
+                 * */
+                void release(lease_type& lease, bool is_reusable) {
+                    IScriptEnvironment* se = lease.entry.se;
+                    if (se == NULL) return;
+                    lease.entry.se = NULL;
+
+                    if (is_reusable && lease.entry.uses < max_uses) {
+                        se->SetMemoryMax(lease.entry.memory_max);
+
+                        util::thread::scoped_lock l(lock);
+                        if (idle.size() < mv_capacity) {
+                            entry_type entry = lease.entry;
+                            entry.se = se;
+                            idle.push_back(entry);
+                            return;
+                        }
+                    }
+
+                    {
+                        util::thread::scoped_lock l(lock);
+                        ++stats.deleted;
+                    }
+                    delete se;
+                }
+
+                stats_type statistics(void) {
+                    util::thread::scoped_lock l(lock);
+                    return stats;
+                }
+        };
+    }
+}
+
+#endif // ENVPOOL_HPP
+
@@ -0,0 +1,281 @@
+/*
+ * frame_impl.hpp
+ *  Declarations and definitions for a class cframe_type
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef FRAME_IMPL_HPP
+#define FRAME_IMPL_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "avisynth.h"
+
+#include "metrics.hpp"
+
+#include <cstring>
+#include <vector>
+
+#include "../../helper/colorspace.hpp"
+#include "../../helper/dlogger.hpp"
+#include "../../helper/pool.hpp"
+
+namespace avsutil {
+    namespace impl {
+        // Returns true if "vi" can be converted to RGB by write_rgb().
+        inline bool is_convertible(const VideoInfo& vi) {
+            return vi.IsRGB24() || vi.IsRGB32() || vi.IsYUY2() || vi.IsYV12();
+        }
+
+        /*
+         *  Writes the pixels of "src" described by "vi" to "dst" as RGB24 or
+         *  RGB32 ("bytes" is 3 or 4) from the bottom row.  "vi" has to be
+         *  convertible.
+         * */
+        inline void write_rgb(  const VideoInfo& vi, const PVideoFrame& src,
+                                uint8_t* dst, uint32_t pitch,
+                                unsigned int bytes,
+                                util::colorspace::converter& converter) {
+            scoped_timer t(metrics_type::CONVERT_TO_RGB);
+            if (vi.IsRGB()) {
+                util::colorspace::repack_rgb(
+                        src->GetReadPtr(), src->GetPitch(),
+                        vi.BytesFromPixels(1),
+                        vi.width, vi.height, dst, pitch, bytes);
+            }
+            else if (vi.IsYUY2()) {
+                converter.from_yuy2(
+                        src->GetReadPtr(), src->GetPitch(),
+                        vi.width, vi.height, dst, pitch, bytes, true);
+            }
+            else {
+                converter.from_yv12(
+                        src->GetReadPtr(PLANAR_Y), src->GetPitch(PLANAR_Y),
+                        src->GetReadPtr(PLANAR_U), src->GetPitch(PLANAR_U),
+                        src->GetReadPtr(PLANAR_V), src->GetPitch(PLANAR_V),
+                        vi.width, vi.height, dst, pitch, bytes, true);
+            }
+        }
+
+        /*
+         *  An object of this class has a possession of PVideoFrame and
+         *  shows the pixels of it as they are.  This is created with a
+         *  reference count 1 and deleted by release() when the count reaches
+         *  0.  This can be created from an arena by "new(arena)".
+         * */
+        class cframe_type
+            : public video_type::frame_type, public util::pool::pooled {
+            public:
+                // typedefs
+                typedef video_type::plane_type  plane_type;
+
+            private:
+                // variables
+                const PVideoFrame mv_frame;
+                unsigned int mv_count;
+
+            public:
+                // constructor
+                explicit cframe_type(PVideoFrame frame)
+                : mv_frame(frame), mv_count(1) {
+                    DBGLOG("avsutil::impl::cframe_type::"
+                           "cframe_type(PVideoFrame)");
+                }
+
+            protected:
+                // destructor
+                ~cframe_type(void) {
+                    DBGLOG("avsutil::impl::cframe_type::~cframe_type(void)");
+                }
+
+            private:
+                // Inhibits copy and assignment.
+                // copy constructor
+                explicit cframe_type(const cframe_type& rhs);
+                // assignment operator
+                cframe_type& operator=(const cframe_type& rhs);
+
+            public:
+                /*
+                 *  Implementations for some member functions of a super class
+                 *  video_type::frame_type
+                 * */
+                const uint8_t* read_ptr(plane_type plane) const {
+                    return mv_frame->GetReadPtr(avs_plane(plane));
+                }
+                uint32_t pitch(plane_type plane) const {
+                    return mv_frame->GetPitch(avs_plane(plane));
+                }
+                uint32_t row_size(plane_type plane) const {
+                    return mv_frame->GetRowSize(avs_plane(plane));
+                }
+                uint32_t height(plane_type plane) const {
+                    return mv_frame->GetHeight(avs_plane(plane));
+                }
+
+                void add_ref(void) { ++mv_count; }
+                void release(void) {
+                    if (--mv_count == 0) delete this;
+                }
+
+            public:
+                // Returns true if more than one refer to this object.
+                bool is_shared(void) const { return mv_count > 1; }
+                const PVideoFrame& avs_frame(void) const { return mv_frame; }
+
+            public:
+                // utility functions
+                static int avs_plane(const plane_type plane) {
+                    switch (plane) {
+                        case video_type::Y_PLANE:   return PLANAR_Y;
+                        case video_type::U_PLANE:   return PLANAR_U;
+                        case video_type::V_PLANE:   return PLANAR_V;
+                        case video_type::DEFAULT_PLANE:
+                        default:                    return 0;
+                    }
+                }
+        };
+
+        /*
+         *  An object of this class has its own buffer for pixels, so it is
+         *  independent of IScriptEnvironment.  This is created with a
+         *  reference count 1 and deleted by release() when the count reaches
+         *  0.
+         * */
+        class cbufferframe_type : public video_type::frame_type {
+            public:
+                // typedefs
+                typedef video_type::plane_type  plane_type;
+
+            private:
+                // the layout of a plane in mv_buf
+                struct layout_type {
+                    std::size_t offset;
+                    uint32_t pitch;
+                    uint32_t row_size;
+                    uint32_t height;
+                };
+
+            private:
+                // variables
+                std::vector<uint8_t> mv_buf;
+                layout_type mv_layouts[3];  // Y (or interleaved), U, V
+                unsigned int mv_count;
+
+                // constants
+                static const uint32_t alignment = 16;
+
+            public:
+                // constructor
+                // an interleaved frame
+                cbufferframe_type(uint32_t row_size, uint32_t height)
+                : mv_count(1) {
+                    DBGLOG("avsutil::impl::cbufferframe_type::"
+                           "cbufferframe_type(" << row_size << ", "
+                           << height << ")");
+                    std::memset(mv_layouts, 0, sizeof(mv_layouts));
+                    add_plane(0, row_size, height);
+                    mv_buf.resize(mv_layouts[0].pitch * height);
+                }
+
+                // a copy of "frame"
+                cbufferframe_type(const PVideoFrame& frame, bool is_planar)
+                : mv_count(1) {
+                    DBGLOG("avsutil::impl::cbufferframe_type::"
+                           "cbufferframe_type(const PVideoFrame&, "
+                           << is_planar << ")");
+                    std::memset(mv_layouts, 0, sizeof(mv_layouts));
+                    const int planes[] = {0, PLANAR_U, PLANAR_V};
+                    const std::size_t numof_planes = is_planar ? 3 : 1;
+                    for (std::size_t i = 0; i < numof_planes; ++i) {
+                        add_plane(i, frame->GetRowSize(planes[i]),
+                                     frame->GetHeight(planes[i]));
+                    }
+                    mv_buf.resize(
+                            mv_layouts[numof_planes - 1].offset
+                            + mv_layouts[numof_planes - 1].pitch
+                              * mv_layouts[numof_planes - 1].height);
+                    for (std::size_t i = 0; i < numof_planes; ++i) {
+                        const layout_type& l = mv_layouts[i];
+                        const uint8_t* src = frame->GetReadPtr(planes[i]);
+                        for (uint32_t y = 0; y < l.height; ++y) {
+                            std::memcpy(
+                                    &mv_buf[l.offset + l.pitch * y],
+                                    src + frame->GetPitch(planes[i]) * y,
+                                    l.row_size);
+                        }
+                    }
+                }
+
+            protected:
+                // destructor
+                ~cbufferframe_type(void) {
+                    DBGLOG("avsutil::impl::cbufferframe_type::"
+                           "~cbufferframe_type(void)");
+                }
+
+            private:
+                // Inhibits copy and assignment.
+                // copy constructor
+                explicit cbufferframe_type(const cbufferframe_type& rhs);
+                // assignment operator
+                cbufferframe_type& operator=(const cbufferframe_type& rhs);
+
+            public:
+                /*
+                 *  Implementations for some member functions of a super class
+                 *  video_type::frame_type
+                 * */
+                const uint8_t* read_ptr(plane_type plane) const {
+                    return &mv_buf[layout(plane).offset];
+                }
+                uint32_t pitch(plane_type plane) const {
+                    return layout(plane).pitch;
+                }
+                uint32_t row_size(plane_type plane) const {
+                    return layout(plane).row_size;
+                }
+                uint32_t height(plane_type plane) const {
+                    return layout(plane).height;
+                }
+
+                void add_ref(void) { ++mv_count; }
+                void release(void) {
+                    if (--mv_count == 0) delete this;
+                }
+
+            public:
+                // Returns the pointer to write the pixels of an interleaved
+                // frame.
+                uint8_t* write_ptr(void) { return &mv_buf[0]; }
+
+            private:
+                // utility functions
+                void add_plane(std::size_t i, uint32_t row_size,
+                               uint32_t height) {
+                    layout_type& l = mv_layouts[i];
+                    l.offset = (i == 0)
+                        ? 0
+                        : mv_layouts[i - 1].offset
+                          + mv_layouts[i - 1].pitch * mv_layouts[i - 1].height;
+                    l.pitch = (row_size + alignment - 1) & ~(alignment - 1);
+                    l.row_size = row_size;
+                    l.height = height;
+                }
+
+                const layout_type& layout(plane_type plane) const {
+                    switch (plane) {
+                        case video_type::U_PLANE:   return mv_layouts[1];
+                        case video_type::V_PLANE:   return mv_layouts[2];
+                        case video_type::Y_PLANE:
+                        case video_type::DEFAULT_PLANE:
+                        default:                    return mv_layouts[0];
+                    }
+                }
+        };
+    }
+}
+
+#endif // FRAME_IMPL_HPP
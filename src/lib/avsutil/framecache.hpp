@@ -0,0 +1,223 @@
+/*
+ * framecache.hpp
+ *  Declarations and definitions of a class framecache
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef FRAMECACHE_HPP
+#define FRAMECACHE_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "avisynth.h"
+
+#include "frame_impl.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <utility>
+
+#ifdef _MSC_VER
+#   include <unordered_map>
+#else
+#   include <tr1/unordered_map>
+#endif
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/pool.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to keep rendered frames within a budget in bytes.
+         *
+         *  Frames are indexed by a clip, a frame number and a format, and
+         *  shared with callers by the reference count of cframe_type.  A
+         *  frame that is referred by a caller is pinned, it is not evicted
+         *  even if the cache is over the budget.  The least recently used
+         *  frame that is not pinned is evicted first.  The bookkeeping is
+         *  allocated from the arena given to the constructor.
+         * */
+        class framecache {
+            public:
+                // typedefs
+                typedef video_type::cache_stats_type stats_type;
+
+                struct key_type {
+                    const IClip* clip;
+                    uint32_t n;
+                    video_type::format_type format;
+
+                    bool operator==(const key_type& rhs) const {
+                        return clip == rhs.clip
+                            && n == rhs.n
+                            && format == rhs.format;
+                    }
+                };
+
+            private:
+                struct key_hash {
+                    std::size_t operator()(const key_type& key) const {
+                        const std::size_t clip =
+                            reinterpret_cast<std::size_t>(key.clip);
+                        return (clip >> 4) * 31 * 31
+                            + key.n * 31
+                            + key.format;
+                    }
+                };
+
+                // the most recently used is the first
+                typedef std::list<
+                    key_type, util::pool::allocator<key_type> > lru_type;
+                struct entry_type {
+                    cframe_type* frame;
+                    uint64_t size;
+                    lru_type::iterator position;    // in lru
+                };
+                typedef std::tr1::unordered_map<
+                    key_type, entry_type, key_hash, std::equal_to<key_type>,
+                    util::pool::allocator<
+                        std::pair<const key_type, entry_type> > >
+                    entries_type;
+
+                // constants
+                static const std::size_t initial_buckets = 64;
+
+            private:
+                // variables
+                entries_type entries;
+                lru_type lru;
+                uint64_t mv_budget;
+                uint64_t mv_usage;
+                stats_type stats;
+
+            public:
+                // constructor
+                explicit framecache(util::pool::arena& arena)
+                    : entries(initial_buckets, key_hash(),
+                              std::equal_to<key_type>(),
+                              entries_type::allocator_type(arena)),
+                      lru(lru_type::allocator_type(arena)),
+                      mv_budget(0), mv_usage(0) {
+                    DBGLOG( "avsutil::impl::framecache::"
+                            "framecache(util::pool::arena&)");
+                    stats.hits = stats.misses = stats.evictions = 0;
+                }
+
+                // destructor
+                ~framecache(void) {
+                    DBGLOG("avsutil::impl::framecache::~framecache(void)");
+                    clear();
+                }
+
+            private:
+                // copy constructor
+                framecache(const framecache& rhs);
+                // assignment operator
+                framecache& operator=(const framecache& rhs);
+
+            public:
+                /*
+                 *  Sets the budget in bytes and evicts frames to fit in it.
+                 *  0 disables caching and releases all frames.
+                 * */
+                void budget(uint64_t bytes) {
+                    DBGLOG( "avsutil::impl::framecache::"
+                            "budget(" << bytes << ")");
+
+                    mv_budget = bytes;
+                    if (mv_budget == 0) clear();
+                    else evict();
+                }
+
+                bool is_enabled(void) const { return mv_budget > 0; }
+
+                /*
+                 *  Returns the frame for "key" with a reference for the
+                 *  caller, or NULL if it isn't cached.
+                 * */
+                cframe_type* find(const key_type& key) {
+                    if (!is_enabled()) return NULL;
+
+                    entries_type::iterator found = entries.find(key);
+                    if (found == entries.end()) {
+                        DBGLOG("miss");
+                        ++stats.misses;
+                        return NULL;
+                    }
+
+                    DBGLOG("hit");
+                    ++stats.hits;
+                    lru.splice(lru.begin(), lru, found->second.position);
+                    found->second.frame->add_ref();
+                    return found->second.frame;
+                }
+
+                // Keeps "frame" for "key".  The reference of the caller is
+                // not moved to the cache.
+                void insert(const key_type& key, cframe_type* frame) {
+                    if (!is_enabled()) return;
+                    if (entries.find(key) != entries.end()) return;
+
+                    frame->add_ref();
+                    lru.push_front(key);
+                    const entry_type entry =
+                        {frame, bytes(*frame), lru.begin()};
+                    entries.insert(std::make_pair(key, entry));
+                    mv_usage += entry.size;
+                    evict();
+                }
+
+                uint64_t usage(void) const { return mv_usage; }
+                stats_type statistics(void) const { return stats; }
+
+            private:
+                // utility functions
+                // Evicts unpinned frames until the usage fits in the budget.
+                void evict(void) {
+                    for (lru_type::iterator itr = lru.end();
+                            mv_usage > mv_budget && itr != lru.begin();) {
+                        --itr;
+                        entries_type::iterator found = entries.find(*itr);
+                        if (found->second.frame->is_shared()) continue;
+
+                        DBGLOG("evict " << itr->n);
+                        mv_usage -= found->second.size;
+                        found->second.frame->release();
+                        entries.erase(found);
+                        itr = lru.erase(itr);
+                        ++stats.evictions;
+                    }
+                }
+
+                void clear(void) {
+                    for (entries_type::iterator itr = entries.begin();
+                            itr != entries.end(); ++itr) {
+                        itr->second.frame->release();
+                    }
+                    entries.clear();
+                    lru.clear();
+                    mv_usage = 0;
+                }
+
+                static uint64_t bytes(const cframe_type& frame) {
+                    // The pitch of U and V planes is 0 for interleaved
+                    // frames.
+                    return static_cast<uint64_t>(
+                              frame.pitch(video_type::DEFAULT_PLANE))
+                            * frame.height(video_type::DEFAULT_PLANE)
+                        + static_cast<uint64_t>(
+                              frame.pitch(video_type::U_PLANE))
+                            * frame.height(video_type::U_PLANE)
+                        + static_cast<uint64_t>(
+                              frame.pitch(video_type::V_PLANE))
+                            * frame.height(video_type::V_PLANE);
+                }
+        };
+    }
+}
+
+#endif // FRAMECACHE_HPP
@@ -0,0 +1,253 @@
+/*
+ * frameprefetcher.hpp
+ *  Declarations and definitions of a class frameprefetcher
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef FRAMEPREFETCHER_HPP
+#define FRAMEPREFETCHER_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "avisynth.h"
+
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <map>
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to render frames in advance in a background thread.
+         *
+         *  After a nth frame is requested by get(), frames n+stride,
+         *  n+stride*2, ..., n+stride*window are rendered and kept until they
+         *  are requested.  The window grows up to the specified size while
+         *  frames are requested by "stride", and becomes 0 when a frame is
+         *  requested at random.  "stride" is negative for reverse.
+         *
+         *  An object of IScriptEnvironment is not thread-safe, so every
+         *  GetFrame() is called with "se_lock" locked.
+         * */
+        class frameprefetcher : public util::thread::thread {
+            public:
+                // typedefs
+                typedef video_type::prefetch_stats_type stats_type;
+
+            private:
+                typedef std::map<uint32_t, PVideoFrame> frames_type;
+
+            private:
+                // variables
+                const PClip clip;
+                IScriptEnvironment* se;
+                util::thread::mutex& se_lock;
+                const uint32_t numof_frames;
+                const uint32_t window_max;
+                const int32_t stride;
+
+                // the following variables are guarded by "lock"
+                util::thread::mutex lock;
+                util::thread::condition cond;
+                frames_type frames;
+                uint32_t window;
+                uint32_t current;   // the frame requested last
+                int64_t next;       // the frame to render in advance next
+                uint32_t rendering; // the frame being rendered in advance
+                bool is_requested;
+                bool is_rendering;
+                bool is_stopping;
+                stats_type stats;
+
+            public:
+                // constructor
+                frameprefetcher(PClip clip, IScriptEnvironment* se,
+                                util::thread::mutex& se_lock,
+                                uint32_t window, int32_t stride = 1)
+                    : clip(clip), se(se), se_lock(se_lock),
+                      numof_frames(clip->GetVideoInfo().num_frames),
+                      window_max(window), stride(stride), window(window),
+                      current(0), next(0), rendering(0),
+                      is_requested(false), is_rendering(false),
+                      is_stopping(false) {
+                    DBGLOG( "avsutil::impl::frameprefetcher::"
+                            "frameprefetcher(PClip, IScriptEnvironment*, "
+                            "util::thread::mutex&, " << window << ", "
+                            << stride << ")");
+                    stats.hits = stats.misses = stats.wasted = 0;
+                    start();
+                }
+
+                // destructor
+                ~frameprefetcher(void) {
+                    DBGLOG( "avsutil::impl::frameprefetcher::"
+                            "~frameprefetcher(void)");
+                    {
+                        util::thread::scoped_lock l(lock);
+                        is_stopping = true;
+                        cond.notify_all();
+                    }
+                    join();
+                }
+
+            private:
+                // copy constructor
+                frameprefetcher(const frameprefetcher& rhs);
+                // assignment operator
+                frameprefetcher& operator=(const frameprefetcher& rhs);
+
+            public:
+                // Returns a nth frame rendered in advance, or renders it.
+                PVideoFrame get(uint32_t n) {
+                    DBGLOG("avsutil::impl::frameprefetcher::get(" << n << ")");
+
+                    util::thread::scoped_lock l(lock);
+                    adapt(n);
+
+                    // Wait for the frame when it is being rendered.
+                    while (is_rendering && rendering == n) cond.wait(lock);
+
+                    PVideoFrame frame;
+                    frames_type::iterator found = frames.find(n);
+                    if (found != frames.end()) {
+                        DBGLOG("hit");
+                        ++stats.hits;
+                        frame = found->second;
+                        frames.erase(found);
+                    }
+                    else {
+                        DBGLOG("miss");
+                        ++stats.misses;
+                        util::thread::scoped_unlock u(lock);
+                        util::thread::scoped_lock sl(se_lock);
+                        scoped_timer t(metrics_type::GET_FRAME);
+                        frame = clip->GetFrame(n, se);
+                    }
+
+                    cond.notify_all();
+                    return frame;
+                }
+
+                // Returns true if this renders frames of "target".
+                bool is_for(const PClip& target) const {
+                    return clip == target;
+                }
+
+                stats_type statistics(void) {
+                    util::thread::scoped_lock l(lock);
+                    return stats;
+                }
+
+                // Discards frames not requested yet, before the end of use.
+                void discard(void) {
+                    util::thread::scoped_lock l(lock);
+                    stats.wasted += frames.size();
+                    frames.clear();
+                    is_requested = false;
+                }
+
+            protected:
+                // an implementation of util::thread::thread::run()
+                void run(void) {
+                    util::thread::scoped_lock l(lock);
+                    while (!is_stopping) {
+                        if (!has_work()) {
+                            cond.wait(lock);
+                            continue;
+                        }
+
+                        const uint32_t n = static_cast<uint32_t>(next);
+                        next += stride;
+                        if (frames.find(n) != frames.end()) continue;
+                        is_rendering = true;
+                        rendering = n;
+
+                        PVideoFrame frame;
+                        bool is_fine = true;
+                        {
+                            util::thread::scoped_unlock u(lock);
+                            util::thread::scoped_lock sl(se_lock);
+                            try {
+                                scoped_timer t(metrics_type::GET_FRAME);
+                                frame = clip->GetFrame(n, se);
+                            }
+                            catch (...) {
+                                // The error will be reported when the frame
+                                // is requested and rendered again.
+                                is_fine = false;
+                            }
+                        }
+
+                        // get() waits for the frame when it has been
+                        // requested while being rendered.
+                        is_rendering = false;
+                        if (is_fine && (n == current || is_in_window(n))) {
+                            frames[n] = frame;
+                        }
+                        else {
+                            ++stats.wasted;
+                        }
+                        cond.notify_all();
+                    }
+                }
+
+            private:
+                // utility functions
+                // These must be called with "lock" locked.
+                void adapt(uint32_t n) {
+                    if (is_requested) {
+                        if (       static_cast<int64_t>(n)
+                                == static_cast<int64_t>(current) + stride) {
+                            // sequential
+                            window = (window == 0)
+                                ? 1 : std::min(window * 2, window_max);
+                        }
+                        else {
+                            // random
+                            DBGLOG("random access. shrink the window");
+                            window = 0;
+                        }
+                    }
+                    current = n;
+                    is_requested = true;
+
+                    // Discard frames out of the window.
+                    for (frames_type::iterator itr = frames.begin();
+                            itr != frames.end();) {
+                        if (itr->first != n && !is_in_window(itr->first)) {
+                            ++stats.wasted;
+                            frames.erase(itr++);
+                        }
+                        else {
+                            ++itr;
+                        }
+                    }
+
+                    if (!is_in_window(next)) {
+                        next = static_cast<int64_t>(n) + stride;
+                    }
+                }
+
+                bool is_in_window(int64_t n) const {
+                    const int64_t distance = n - current;
+                    if (distance % stride != 0) return false;
+                    const int64_t steps = distance / stride;
+                    return 0 < steps && steps <= window;
+                }
+
+                bool has_work(void) const {
+                    return is_requested
+                        && 0 <= next && next < numof_frames
+                        && is_in_window(next);
+                }
+        };
+    }
+}
+
+#endif // FRAMEPREFETCHER_HPP
@@ -0,0 +1,324 @@
+/*
+ * framerenderer.hpp
+ *  Declarations and definitions of a class framerenderer
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef FRAMERENDERER_HPP
+#define FRAMERENDERER_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "avisynth.h"
+
+#include "frame_impl.hpp"
+#include "metrics.hpp"
+#include "sources.hpp"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../helper/colorspace.hpp"
+#include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to render frames in parallel.
+         *
+         *  Each worker thread imports the script into its own
+         *  IScriptEnvironment, so they don't wait for each other.  Frame
+         *  numbers are dealt to the queues of workers in turn, and a worker
+         *  that has run out of its queue steals from the others.  Rendered
+         *  frames are copied out of IScriptEnvironment and returned in order
+         *  through a reorder buffer.  Workers don't go ahead more than
+         *  "buffer_size" frames from the frame that next() returns next.
+         *  When a frame fails, the frames before it are still rendered and
+         *  returned, and next() throws the error in place of that frame.
+         * */
+        class framerenderer : public video_type::renderer_type {
+            private:
+                typedef video_type::format_type format_type;
+                typedef video_type::frame_view frame_view;
+                typedef std::deque<uint32_t> queue_type;
+                typedef std::map<uint32_t, cbufferframe_type*> frames_type;
+
+                class worker : public util::thread::thread {
+                    private:
+                        framerenderer& owner;
+                        const std::size_t id;
+
+                    public:
+                        worker(framerenderer& owner, std::size_t id)
+                            : owner(owner), id(id) {}
+
+                    private:
+                        // copy constructor
+                        worker(const worker& rhs);
+                        // assignment operator
+                        worker& operator=(const worker& rhs);
+
+                    protected:
+                        void run(void) { owner.work(id); }
+                };
+
+            private:
+                // variables
+                const std::string filepath;
+                const uint32_t last;
+                const format_type format;
+                const uint32_t buffer_size;
+                std::vector<worker*> workers;
+
+                // the following variables are guarded by "lock"
+                util::thread::mutex lock;
+                util::thread::condition cond;
+                std::vector<queue_type> queues;
+                frames_type frames;     // the reorder buffer
+                uint32_t next_number;   // the frame returned next
+                bool is_stopping;
+                uint32_t failed_number; // the first frame that failed,
+                                        // "last" if none
+                std::string errmsg;
+
+                // the current frame, used only by the consumer
+                uint32_t mv_number;
+                frame_view mv_frame;
+
+            public:
+                // constructor
+                framerenderer(  const std::string& filepath,
+                                uint32_t first, uint32_t last,
+                                format_type format,
+                                uint32_t numof_workers, uint32_t buffer_size)
+                    : filepath(filepath), last(last), format(format),
+                      buffer_size(buffer_size == 0
+                              ? numof_workers * 2 : buffer_size),
+                      queues(numof_workers),
+                      next_number(first), is_stopping(false),
+                      failed_number(last), mv_number(first) {
+                    DBGLOG( "avsutil::impl::framerenderer::"
+                            "framerenderer(" << filepath << ", " << first
+                            << ", " << last << ", " << format << ", "
+                            << numof_workers << ", " << buffer_size << ")");
+
+                    for (uint32_t n = first; n < last; ++n) {
+                        queues[(n - first) % queues.size()].push_back(n);
+                    }
+
+                    for (std::size_t i = 0; i < queues.size(); ++i) {
+                        std::auto_ptr<worker> created(new worker(*this, i));
+                        if (!created->start()) break;
+                        workers.push_back(created.release());
+                    }
+                    if (workers.empty()) {
+                        failed_number = first;
+                        errmsg = "Can't create threads";
+                    }
+                }
+
+                // destructor
+                ~framerenderer(void) {
+                    DBGLOG( "avsutil::impl::framerenderer::"
+                            "~framerenderer(void)");
+                    {
+                        util::thread::scoped_lock l(lock);
+                        is_stopping = true;
+                        cond.notify_all();
+                    }
+                    for (std::vector<worker*>::iterator itr = workers.begin();
+                            itr != workers.end(); ++itr) {
+                        (*itr)->join();
+                        delete *itr;
+                    }
+                    for (frames_type::iterator itr = frames.begin();
+                            itr != frames.end(); ++itr) {
+                        itr->second->release();
+                    }
+                }
+
+            private:
+                // copy constructor
+                framerenderer(const framerenderer& rhs);
+                // assignment operator
+                framerenderer& operator=(const framerenderer& rhs);
+
+            public:
+                /*
+                 *  Implementations for some member functions of a super class
+                 *  video_type::renderer_type
+                 * */
+                bool next(void) {
+                    DBGLOG("avsutil::impl::framerenderer::next(void)");
+
+                    util::thread::scoped_lock l(lock);
+                    if (last <= next_number) return false;
+
+                    frames_type::iterator found;
+                    while ((found = frames.find(next_number)) == frames.end()) {
+                        if (failed_number <= next_number) {
+                            throw std::runtime_error(errmsg);
+                        }
+                        cond.wait(lock);
+                    }
+
+                    mv_frame = frame_view(found->second);
+                    mv_number = next_number++;
+                    frames.erase(found);
+                    // The window of workers has moved.
+                    cond.notify_all();
+                    return true;
+                }
+
+                uint32_t number(void) const { return mv_number; }
+                frame_view frame(void) const { return mv_frame; }
+
+            private:
+                // The procedure of worker threads.
+                void work(std::size_t id) {
+                    DBGLOG( "avsutil::impl::framerenderer::"
+                            "work(" << id << ")");
+
+                    // "clip" has to be released before "se".
+                    std::auto_ptr<IScriptEnvironment> se;
+                    PClip clip;
+                    try {
+                        se.reset(CreateScriptEnvironment());
+                        if (se.get() == NULL) {
+                            fail(0, "Can't create IScriptEnvironment");
+                            return;
+                        }
+                        scoped_timer t(metrics_type::IMPORT);
+                        clip = open_source(filepath.c_str(), se.get());
+                    }
+                    catch (AvisynthError& avserr) {
+                        fail(0, avserr.msg);
+                        return;
+                    }
+                    catch (std::exception& ex) {
+                        fail(0, ex.what());
+                        return;
+                    }
+
+                    util::colorspace::converter converter(
+                            util::colorspace::BT601,
+                            util::colorspace::TV_RANGE);
+                    uint32_t n;
+                    while (take(id, n)) {
+                        // The frames after a failed one are not needed,
+                        // but those before it are.
+                        cbufferframe_type* frame;
+                        try {
+                            frame = render(clip, se.get(), n, converter);
+                        }
+                        catch (AvisynthError& avserr) {
+                            fail(n, avserr.msg);
+                            continue;
+                        }
+                        catch (std::exception& ex) {
+                            fail(n, ex.what());
+                            continue;
+                        }
+
+                        util::thread::scoped_lock l(lock);
+                        frames[n] = frame;
+                        cond.notify_all();
+                    }
+                }
+
+                /*
+                 *  Takes a frame number to render from the queue of the
+                 *  worker "id", or steals the smallest one from the others.
+                 *  Waits while the frame is out of the window.  Returns false
+                 *  when there is nothing to do.  Queues are in ascending
+                 *  order, so one that starts at a failed frame is done.
+                 * */
+                bool take(std::size_t id, uint32_t& n) {
+                    util::thread::scoped_lock l(lock);
+                    for (;;) {
+                        if (is_stopping) return false;
+
+                        queue_type* victim = NULL;
+                        if (is_pending(queues[id])) {
+                            victim = &queues[id];
+                        }
+                        else {
+                            for (std::size_t i = 0; i < queues.size(); ++i) {
+                                if (!is_pending(queues[i])) continue;
+                                if (       victim == NULL
+                                        || queues[i].front()
+                                            < victim->front()) {
+                                    victim = &queues[i];
+                                }
+                            }
+                        }
+                        if (victim == NULL) return false;
+
+                        if (       victim->front()
+                                < static_cast<uint64_t>(next_number)
+                                  + buffer_size) {
+                            n = victim->front();
+                            victim->pop_front();
+                            return true;
+                        }
+                        cond.wait(lock);
+                    }
+                }
+
+                // This must be called with "lock" locked.
+                bool is_pending(const queue_type& queue) const {
+                    return !queue.empty() && queue.front() < failed_number;
+                }
+
+                // Keeps the error of the first frame that failed.
+                void fail(uint32_t n, const std::string& msg) {
+                    WRNLOG("failed to render " << n << ": " << msg);
+                    util::thread::scoped_lock l(lock);
+                    if (n < failed_number) {
+                        failed_number = n;
+                        errmsg = msg;
+                    }
+                    cond.notify_all();
+                }
+
+                // Renders a nth frame and copies it to a new buffer.
+                cbufferframe_type* render(
+                        const PClip& clip, IScriptEnvironment* se, uint32_t n,
+                        util::colorspace::converter& converter) {
+                    const VideoInfo& vi = clip->GetVideoInfo();
+                    PVideoFrame src;
+                    {
+                        scoped_timer t(metrics_type::GET_FRAME);
+                        src = clip->GetFrame(n, se);
+                    }
+
+                    if (format == video_type::NATIVE) {
+                        return new cbufferframe_type(src, vi.IsPlanar());
+                    }
+
+                    if (!is_convertible(vi)) {
+                        throw std::runtime_error(
+                                "Can't convert the color space to RGB");
+                    }
+
+                    const unsigned int bytes =
+                        (format == video_type::RGB32) ? 4 : 3;
+                    cbufferframe_type* dst =
+                        new cbufferframe_type(vi.width * bytes, vi.height);
+                    write_rgb(vi, src, dst->write_ptr(),
+                              dst->pitch(video_type::DEFAULT_PLANE), bytes,
+                              converter);
+                    return dst;
+                }
+        };
+    }
+}
+
+#endif // FRAMERENDERER_HPP
@@ -0,0 +1,439 @@
+/*
+ * framerequester.hpp
+ *  Declarations and definitions of classes framerequester and
+ *  crequest_type
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef FRAMEREQUESTER_HPP
+#define FRAMEREQUESTER_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "avisynth.h"
+
+#include "frame_impl.hpp"
+#include "framecache.hpp"
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../../helper/colorspace.hpp"
+#include "../../helper/dlogger.hpp"
+#include "../../helper/pool.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        class crequest_type;
+
+        /*
+         *  A class to render frames requested by request() in worker
+         *  threads.
+         *
+         *  Requests for the same frame in the same format share a job while
+         *  it is queued or being rendered, so the frame is rendered once.  A
+         *  job that all its requests are cancelled before it starts is
+         *  removed from the queue.
+         *
+         *  An object of IScriptEnvironment is not thread-safe, so every call
+         *  of it is done with "se_lock" locked.  The conversion to RGB is
+         *  done without the lock, so some workers are worth it.
+         *
+         *  Workers keep the rendered PVideoFrame, and the first get() wraps
+         *  it in cframe_type from "arena" of the video, as well as the
+         *  frames of cvideo_type.  The arena is not thread-safe, so it is
+         *  used only by the thread that uses the video.
+         * */
+        class framerequester {
+            private:
+                typedef video_type::format_type format_type;
+                typedef std::pair<uint32_t, format_type> key_type;
+
+                struct job_type {
+                    enum state_type { QUEUED, RUNNING, DONE, FAILED };
+
+                    key_type key;
+                    PClip clip;         // the clip to get the frame from
+                    state_type state;
+                    PVideoFrame rendered;   // the result when DONE
+                    cframe_type* frame;     // made from "rendered" by get()
+                    std::string errmsg; // the reason when FAILED
+                    unsigned int holders;   // requests and a worker
+                    unsigned int wanted;    // requests not cancelled
+                };
+                typedef std::map<key_type, job_type*> jobs_type;
+
+                class worker : public util::thread::thread {
+                    private:
+                        framerequester& owner;
+
+                    public:
+                        explicit worker(framerequester& owner)
+                            : owner(owner) {}
+
+                    private:
+                        // copy constructor
+                        worker(const worker& rhs);
+                        // assignment operator
+                        worker& operator=(const worker& rhs);
+
+                    protected:
+                        void run(void) { owner.work(); }
+                };
+
+                friend class crequest_type;
+
+                // constants
+                // GetFrame() is serialized, so more workers don't help.
+                static const unsigned int max_workers = 4;
+
+            private:
+                // variables
+                IScriptEnvironment* se;
+                util::thread::mutex& se_lock;
+                util::pool::arena& arena;
+                std::vector<worker*> workers;
+
+                // the following variables are guarded by "lock"
+                util::thread::mutex lock;
+                util::thread::condition cond;
+                std::deque<job_type*> queue;
+                jobs_type jobs;     // jobs queued or being rendered
+                bool is_stopping;
+
+            public:
+                // constructor
+                framerequester( IScriptEnvironment* se,
+                                util::thread::mutex& se_lock,
+                                util::pool::arena& arena)
+                    : se(se), se_lock(se_lock), arena(arena),
+                      is_stopping(false) {
+                    DBGLOG( "avsutil::impl::framerequester::"
+                            "framerequester(IScriptEnvironment*, "
+                            "util::thread::mutex&, util::pool::arena&)");
+                }
+
+                // destructor
+                ~framerequester(void) {
+                    DBGLOG( "avsutil::impl::framerequester::"
+                            "~framerequester(void)");
+                    {
+                        util::thread::scoped_lock l(lock);
+                        is_stopping = true;
+                        cond.notify_all();
+                    }
+                    for (std::vector<worker*>::iterator itr = workers.begin();
+                            itr != workers.end(); ++itr) {
+                        (*itr)->join();
+                        delete *itr;
+                    }
+                    // The requests have been released already.
+                    for (std::deque<job_type*>::iterator itr = queue.begin();
+                            itr != queue.end(); ++itr) {
+                        delete *itr;
+                    }
+                }
+
+            private:
+                // copy constructor
+                framerequester(const framerequester& rhs);
+                // assignment operator
+                framerequester& operator=(const framerequester& rhs);
+
+            public:
+                /*
+                 *  Returns a request for a nth frame of "clip" in "format".
+                 *  "clip" is already in "format" unless the color space is
+                 *  convertible by this library.  The frame is kept in
+                 *  "cache" by "key" when it is got, unless "cache" is NULL.
+                 * */
+                crequest_type* request(
+                        const PClip& clip, uint32_t n, format_type format,
+                        framecache* cache, const framecache::key_type& key);
+
+                // Returns a request that is ready with "frame".
+                crequest_type* ready(cframe_type* frame);
+
+            private:
+                // for crequest_type
+                // These must be called with "lock" locked.
+                bool is_ready(const job_type& job) const {
+                    return job.state == job_type::DONE
+                        || job.state == job_type::FAILED;
+                }
+
+                void cancel(job_type& job) {
+                    if (--job.wanted > 0 || job.state != job_type::QUEUED) {
+                        return;
+                    }
+
+                    DBGLOG("cancel " << job.key.first);
+                    queue.erase(std::find(queue.begin(), queue.end(), &job));
+                    jobs.erase(job.key);
+                    job.state = job_type::FAILED;
+                    job.errmsg = "The request has been cancelled";
+                }
+
+                void release(job_type* job) {
+                    if (--job->holders > 0) return;
+                    if (job->frame != NULL) job->frame->release();
+                    delete job;
+                }
+
+            private:
+                // The procedure of worker threads.
+                void work(void) {
+                    util::colorspace::converter converter(
+                            util::colorspace::BT601,
+                            util::colorspace::TV_RANGE);
+
+                    util::thread::scoped_lock l(lock);
+                    while (!is_stopping) {
+                        if (queue.empty()) {
+                            cond.wait(lock);
+                            continue;
+                        }
+
+                        job_type* const job = queue.front();
+                        queue.pop_front();
+                        job->state = job_type::RUNNING;
+                        ++job->holders;
+
+                        PVideoFrame frame;
+                        std::string failure;
+                        {
+                            util::thread::scoped_unlock u(lock);
+                            try {
+                                frame = render(*job, converter);
+                            }
+                            catch (AvisynthError& avserr) {
+                                failure = avserr.msg;
+                            }
+                            catch (std::exception& ex) {
+                                failure = ex.what();
+                            }
+                        }
+
+                        jobs.erase(job->key);
+                        if (frame) {
+                            job->rendered = frame;
+                            job->state = job_type::DONE;
+                        }
+                        else {
+                            job->errmsg = failure;
+                            job->state = job_type::FAILED;
+                        }
+                        // The result is discarded if no one waits.
+                        release(job);
+                        cond.notify_all();
+                    }
+                }
+
+                // Renders the frame of "job" and converts it if needed.
+                PVideoFrame render( const job_type& job,
+                                    util::colorspace::converter& converter) {
+                    const VideoInfo& vi = job.clip->GetVideoInfo();
+                    const uint32_t n = job.key.first;
+                    const format_type format = job.key.second;
+                    const int pixel_type = (format == video_type::RGB32)
+                        ? VideoInfo::CS_BGR32
+                        : VideoInfo::CS_BGR24;
+
+                    PVideoFrame src;
+                    {
+                        util::thread::scoped_lock sl(se_lock);
+                        scoped_timer t(metrics_type::GET_FRAME);
+                        src = job.clip->GetFrame(n, se);
+                    }
+                    if (       format == video_type::NATIVE
+                            || vi.pixel_type == pixel_type) {
+                        return src;
+                    }
+
+                    VideoInfo rgb_vi = vi;
+                    rgb_vi.pixel_type = pixel_type;
+                    PVideoFrame dst;
+                    {
+                        util::thread::scoped_lock sl(se_lock);
+                        dst = se->NewVideoFrame(rgb_vi);
+                    }
+                    write_rgb(vi, src, dst->GetWritePtr(), dst->GetPitch(),
+                              (format == video_type::RGB32) ? 4 : 3,
+                              converter);
+                    return dst;
+                }
+
+                // Starts workers up to "max_workers" as jobs are queued.
+                // This must be called with "lock" locked.
+                void spawn(void) {
+                    const unsigned int limit = std::min(
+                            util::thread::numof_processors(),
+                            static_cast<unsigned int>(max_workers));
+                    if (workers.size() >= limit) return;
+                    if (workers.size() >= queue.size() && !workers.empty()) {
+                        return;
+                    }
+
+                    std::auto_ptr<worker> created(new worker(*this));
+                    if (created->start()) workers.push_back(created.release());
+                }
+
+                // Fails the jobs in the queue when no worker runs.
+                // This must be called with "lock" locked.
+                void fail_all(const std::string& msg) {
+                    for (std::deque<job_type*>::iterator itr = queue.begin();
+                            itr != queue.end(); ++itr) {
+                        jobs.erase((*itr)->key);
+                        (*itr)->errmsg = msg;
+                        (*itr)->state = job_type::FAILED;
+                    }
+                    queue.clear();
+                    cond.notify_all();
+                }
+        };
+
+        /*
+         *  A class for a request returned by
+         *  video_type::request_frame().
+         * */
+        class crequest_type : public video_type::request_type {
+            private:
+                typedef framerequester::job_type job_type;
+
+            private:
+                // variables
+                framerequester& owner;
+                job_type* const job;    // NULL if ready from the start
+                framecache* const cache;
+                const framecache::key_type key;
+                video_type::frame_view mv_frame;
+                bool is_cancelled;
+
+            public:
+                // constructor
+                crequest_type(  framerequester& owner, job_type* job,
+                                framecache* cache,
+                                const framecache::key_type& key)
+                    : owner(owner), job(job), cache(cache), key(key),
+                      is_cancelled(false) {}
+                crequest_type(  framerequester& owner,
+                                const video_type::frame_view& frame)
+                    : owner(owner), job(NULL), cache(NULL), key(),
+                      mv_frame(frame), is_cancelled(false) {}
+
+                // destructor
+                ~crequest_type(void) {
+                    if (job == NULL) return;
+                    util::thread::scoped_lock l(owner.lock);
+                    if (!is_cancelled) owner.cancel(*job);
+                    owner.release(job);
+                }
+
+            private:
+                // copy constructor
+                crequest_type(const crequest_type& rhs);
+                // assignment operator
+                crequest_type& operator=(const crequest_type& rhs);
+
+            public:
+                /*
+                 *  Implementations for some member functions of a super class
+                 *  video_type::request_type
+                 * */
+                bool is_ready(void) const {
+                    if (job == NULL || is_cancelled) return true;
+                    util::thread::scoped_lock l(owner.lock);
+                    return owner.is_ready(*job);
+                }
+
+                video_type::frame_view get(void) {
+                    if (is_cancelled) {
+                        throw std::runtime_error(
+                                "The request has been cancelled");
+                    }
+                    if (job == NULL || mv_frame.is_valid()) return mv_frame;
+
+                    cframe_type* frame;
+                    {
+                        util::thread::scoped_lock l(owner.lock);
+                        while (!owner.is_ready(*job)) {
+                            owner.cond.wait(owner.lock);
+                        }
+                        if (job->state == job_type::FAILED) {
+                            throw std::runtime_error(job->errmsg);
+                        }
+                        if (job->frame == NULL) {
+                            job->frame =
+                                new(owner.arena) cframe_type(job->rendered);
+                        }
+                        frame = job->frame;
+                        frame->add_ref();
+                    }
+
+                    mv_frame = video_type::frame_view(frame);
+                    if (cache != NULL) cache->insert(key, frame);
+                    return mv_frame;
+                }
+
+                void cancel(void) {
+                    if (is_cancelled) return;
+                    is_cancelled = true;
+                    mv_frame = video_type::frame_view();
+                    if (job == NULL) return;
+                    util::thread::scoped_lock l(owner.lock);
+                    owner.cancel(*job);
+                }
+        };
+
+        inline crequest_type* framerequester::request(
+                const PClip& clip, uint32_t n, format_type format,
+                framecache* cache, const framecache::key_type& cache_key) {
+            DBGLOG( "avsutil::impl::framerequester::"
+                    "request(PClip, " << n << ", " << format << ")");
+
+            util::thread::scoped_lock l(lock);
+            const key_type key(n, format);
+            job_type* job;
+            jobs_type::iterator found = jobs.find(key);
+            if (found != jobs.end()) {
+                DBGLOG("join the job in flight");
+                job = found->second;
+            }
+            else {
+                std::auto_ptr<job_type> created(new job_type());
+                created->key = key;
+                created->clip = clip;
+                created->state = job_type::QUEUED;
+                created->frame = NULL;
+                created->holders = 0;
+                created->wanted = 0;
+                queue.push_back(created.get());
+                jobs[key] = created.get();
+                job = created.release();
+                spawn();
+                if (workers.empty()) fail_all("Can't create threads");
+                cond.notify_all();
+            }
+
+            ++job->holders;
+            ++job->wanted;
+            return new crequest_type(*this, job, cache, cache_key);
+        }
+
+        inline crequest_type* framerequester::ready(cframe_type* frame) {
+            return new crequest_type(*this, video_type::frame_view(frame));
+        }
+    }
+}
+
+#endif // FRAMEREQUESTER_HPP
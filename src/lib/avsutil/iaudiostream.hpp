@@ -9,9 +9,14 @@
 #ifndef IAUDIOSTREAM_HPP
 #define IAUDIOSTREAM_HPP
 
+#include "audioprefetcher.hpp"
+#include "metrics.hpp"
+
 #include <istream>
+#include <memory>
 
 #include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
 
 namespace avsutil {
     namespace impl {
@@ -19,6 +24,7 @@ namespace avsutil {
             private:
                 PClip clip;
                 IScriptEnvironment* se;
+                util::thread::mutex& se_lock;
 
                 // fundamental informations about AVS file
                 uint32_t sample_size;
@@ -40,13 +46,17 @@ namespace avsutil {
                 char* buf;
                 bool is_internal_buf;
 
+                // gets samples in advance if not NULL
+                std::auto_ptr<audioprefetcher> prefetcher;
+
                 // constants
                 static const uint32_t buf_size_def = 4096;
 
             public:
                 // constructor
-                audiostreambuf(PClip clip, IScriptEnvironment* se)
-                    : clip(clip), se(se),
+                audiostreambuf( PClip clip, IScriptEnvironment* se,
+                                util::thread::mutex& se_lock)
+                    : clip(clip), se(se), se_lock(se_lock),
                     sample_size(clip->GetVideoInfo().BytesPerAudioSample()),
                     numof_samples(clip->GetVideoInfo().num_audio_samples),
                     page_current(0), page_next(0),
@@ -54,7 +64,8 @@ namespace avsutil {
                     buf(new char[sample_size * samples_at_a_time]),
                     is_internal_buf(true) {
                         DBGLOG( "audiostreambuf::audiostreambuf"
-                                "(PClip, IScriptEnvironment*)");
+                                "(PClip, IScriptEnvironment*,"
+                                " util::thread::mutex&)");
                     }
 
                 // destructor
@@ -72,6 +83,31 @@ namespace avsutil {
                 // assignment operator
                 audiostreambuf& operator=(const audiostreambuf& rhs);
 
+            public:
+                /*
+                 *  Gets samples in a background thread into "numof_pages"
+                 *  pages of "page_size" bytes, from the current position.
+                 *  The pages are used instead of the buffer.  "numof_pages"
+                 *  less than 2 gets samples on demand.
+                 * */
+                void prefetch(uint32_t page_size, uint32_t numof_pages) {
+                    DBGLOG( "audiostreambuf::prefetch("
+                            << page_size << ", " << numof_pages << ")");
+
+                    const uint64_t current_pos = (gptr() && eback())
+                        ? page_current + (gptr() - eback()) / sample_size
+                        : page_current;
+                    setg(NULL, NULL, NULL);
+                    page_next = page_current = current_pos;
+
+                    prefetcher.reset();
+                    if (numof_pages >= 2) {
+                        prefetcher.reset(new audioprefetcher(
+                                    clip, se, se_lock, current_pos,
+                                    page_size, numof_pages));
+                    }
+                }
+
             protected:
                 std::streambuf* setbuf(char_type* s, std::streamsize n) {
                     DBGLOG( "audiostreambuf::setbuf(char_type*, "
@@ -94,6 +130,9 @@ namespace avsutil {
                     buf = s;
                     samples_at_a_time = static_cast<uint32_t>(n) / sample_size;
 
+                    // The specified buffer is used from now on.
+                    prefetcher.reset();
+
                     return this;
                 }
 
@@ -101,7 +140,7 @@ namespace avsutil {
                         off_type off, std::ios_base::seekdir way,
                         std::ios_base::openmode which =
                         std::ios_base::in | std::ios_base::out) {
-                    DBGLOG( "audiostreambuf::seekoff("
+                    TRCLOG( "audiostreambuf::seekoff("
                             << off << ", " << way << ", " << which << ")");
 
                     // Does only if a stream is opened in an input mode
@@ -110,18 +149,18 @@ namespace avsutil {
                             ? page_current + (gptr() - eback()) / sample_size
                             : page_current;
 
-                        DBGLOG("current position: " << current_pos);
+                        TRCLOG("current position: " << current_pos);
 
                         // In case of tellg()
                         if (way == std::ios_base::cur && off == 0) {
-                            DBGLOG("call by tellg()");
+                            TRCLOG("call by tellg()");
                             // The current position may be different from
                             // eback(), after setg().
                             return pos_type(off_type(current_pos));
                         }
 
                         // In case of seekg()
-                        DBGLOG("call by seekg()");
+                        TRCLOG("call by seekg()");
                         uint64_t target;
                         switch (way) {
                             case std::ios_base::beg:
@@ -137,19 +176,19 @@ namespace avsutil {
                                 return pos_type(off_type(-1));
                         }
 
-                        DBGLOG( "0 <= " << target << " < "
+                        TRCLOG( "0 <= " << target << " < "
                                 << numof_samples << "?");
                         if (target < 0 || numof_samples <= target) {
-                            DBGLOG("out of range. failed to seekoff");
+                            TRCLOG("out of range. failed to seekoff");
                             return pos_type(off_type(-1));
                         }
-                        DBGLOG("OK");
+                        TRCLOG("OK");
 
                         if (gptr() && eback()) {
-                            DBGLOG( page_current << " <= " << target
+                            TRCLOG( page_current << " <= " << target
                                     << " < " << page_next << "?");
                             if (page_current <= target && target < page_next) {
-                                DBGLOG("cache hit");
+                                TRCLOG("cache hit");
                                 setg(   eback(),
                                         eback()
                                             + (target - page_current)
@@ -157,14 +196,20 @@ namespace avsutil {
                                         egptr());
                             }
                             else {
-                                DBGLOG("out of cache");
+                                TRCLOG("out of cache");
                                 setg(NULL, NULL, NULL);
                                 page_next = page_current = target;
+                                if (prefetcher.get() != NULL) {
+                                    prefetcher->seek(target);
+                                }
                             }
                         }
                         else {
-                            DBGLOG("before getting");
+                            TRCLOG("before getting");
                             page_next = page_current = target;
+                            if (prefetcher.get() != NULL) {
+                                prefetcher->seek(target);
+                            }
                         }
 
                         return pos_type(off_type(target));
@@ -176,30 +221,100 @@ namespace avsutil {
                         pos_type sp,
                         std::ios_base::openmode which =
                         std::ios_base::in | std::ios_base::out) {
-                    DBGLOG( "audiostreambuf::seekpos("
+                    TRCLOG( "audiostreambuf::seekpos("
                             << sp << ", " << which << ")");
                     return seekoff(off_type(sp), std::ios_base::beg, which);
                 }
 
+                /*
+                 *  Writes samples to "s" directly by GetAudio() when "n" is
+                 *  larger than the buffer, to save copying through it.
+                 * */
+                std::streamsize xsgetn(char_type* s, std::streamsize n) {
+                    TRCLOG("audiostreambuf::xsgetn(char_type*, " << n << ")");
+
+                    // The pages are filled in the background, so copying
+                    // from them is cheaper.
+                    if (       prefetcher.get() != NULL
+                            || n < static_cast<std::streamsize>(
+                                sample_size * samples_at_a_time)) {
+                        return std::streambuf::xsgetn(s, n);
+                    }
+
+                    // The rest of the buffer that ends at a boundary of
+                    // samples.
+                    std::streamsize done = 0;
+                    if (gptr() && eback()) {
+                        done = egptr() - gptr();
+                        traits_type::copy(s, gptr(), done);
+                        setg(NULL, NULL, NULL);
+                        page_current = page_next;
+                    }
+
+                    // whole samples
+                    const uint64_t remainder = (page_next < numof_samples)
+                        ? numof_samples - page_next
+                        : 0;
+                    uint64_t samples = (n - done) / sample_size;
+                    if (remainder < samples) samples = remainder;
+                    if (samples > 0) {
+                        {
+                            util::thread::scoped_lock lock(se_lock);
+                            scoped_timer t(metrics_type::GET_AUDIO);
+                            clip->GetAudio(s + done, page_next, samples, se);
+                        }
+                        done += static_cast<std::streamsize>(
+                                samples * sample_size);
+                        page_current = page_next += samples;
+                    }
+
+                    // a fragment of a sample
+                    if (done < n && page_next < numof_samples) {
+                        done += std::streambuf::xsgetn(s + done, n - done);
+                    }
+                    return done;
+                }
+
                 int_type underflow(void) {
-                    DBGLOG("audiostreambuf::underflow(void)");
+                    TRCLOG("audiostreambuf::underflow(void)");
+                    if (prefetcher.get() != NULL) return underflow_prefetched();
+
                     if (numof_samples <= page_next) {
-                        DBGLOG("reached to the end of avs audio stream");
+                        TRCLOG("reached to the end of avs audio stream");
                         return traits_type::eof();
                     }
 
-                    uint64_t remainder = numof_samples - page_next;
-                    get_audio_data(
-                            (samples_at_a_time < remainder)
-                            ? samples_at_a_time
-                            : remainder);
+                    // The last page may be shorter than the buffer.
+                    const uint64_t remainder = numof_samples - page_next;
+                    const uint64_t samples = (samples_at_a_time < remainder)
+                        ? samples_at_a_time
+                        : remainder;
+                    get_audio_data(samples);
                     page_current = page_next;
-                    page_next += samples_at_a_time;
+                    page_next += samples;
 
                     return traits_type::to_int_type(*gptr());
                 }
 
                 // utility function
+                // underflow() with the prefetcher
+                int_type underflow_prefetched(void) {
+                    const audioprefetcher::page_type* page =
+                        prefetcher->acquire();
+                    if (page == NULL) {
+                        setg(NULL, NULL, NULL);
+                        return traits_type::eof();
+                    }
+
+                    // a pointer to the page for setg(), which never writes
+                    char* p = const_cast<char*>(&page->buf[0]);
+                    setg(p, p, p + sample_size * page->count);
+                    page_current = page->start;
+                    page_next = page->start + page->count;
+
+                    return traits_type::to_int_type(*gptr());
+                }
+
                 /*
                  * function GetAudio() returns audio data in the following
                  * format:
@@ -224,23 +339,29 @@ namespace avsutil {
                  *      br: back right      (for 5.1ch)
                  * */
                 void get_audio_data(uint64_t samples) {
-                    DBGLOG("get_audio_data(" << samples << ")");
-                    clip->GetAudio(buf, page_next, samples, se);
+                    TRCLOG("get_audio_data(" << samples << ")");
+                    {
+                        util::thread::scoped_lock lock(se_lock);
+                        scoped_timer t(metrics_type::GET_AUDIO);
+                        clip->GetAudio(buf, page_next, samples, se);
+                    }
                     setg(buf, buf, buf + sample_size * samples);
                 }
         };
 
         class iaudiostream : public std::istream {
             private:
-                const std::streambuf* internal_buf;
+                audiostreambuf* internal_buf;
 
             public:
                 // constructor
-                iaudiostream(PClip clip, IScriptEnvironment* se)
-                : std::istream(new audiostreambuf(clip, se)),
-                  internal_buf(rdbuf()) {
+                iaudiostream(   PClip clip, IScriptEnvironment* se,
+                                util::thread::mutex& se_lock)
+                : std::istream(new audiostreambuf(clip, se, se_lock)),
+                  internal_buf(static_cast<audiostreambuf*>(rdbuf())) {
                     DBGLOG( "iaudiostream::iaudiostream"
-                            "(PClip, IScriptEnvironment*)");
+                            "(PClip, IScriptEnvironment*,"
+                            " util::thread::mutex&)");
                 }
 
                 // destructor
@@ -252,6 +373,14 @@ namespace avsutil {
                     }
                 }
 
+            public:
+                // see audiostreambuf::prefetch()
+                void prefetch(uint32_t page_size, uint32_t numof_pages) {
+                    if (rdbuf() == internal_buf) {
+                        internal_buf->prefetch(page_size, numof_pages);
+                    }
+                }
+
             private:
                 // copy constructor
                 iaudiostream(const iaudiostream& rhs);
@@ -13,31 +13,26 @@
 
 #include "../../helper/cast.hpp"
 #include "../../helper/dlogger.hpp"
+#include "../../helper/pool.hpp"
 
 namespace avsutil {
     namespace impl {
-        class framestreambuf : public std::streambuf {
+        class framestreambuf
+            : public std::streambuf, public util::pool::pooled {
             private:
-                const PVideoFrame frame;
+                PVideoFrame frame;
                 char* beginning;
-                const uint32_t pitch;
-                const uint32_t height;
-                const uint32_t size;
+                uint32_t pitch;
+                uint32_t height;
+                uint32_t size;
 
             public:
                 // constructor
-                framestreambuf(PVideoFrame frame)
-                    : frame(frame),
-                      beginning(
-                              const_cast<char*>(
-                                  util::cast::constpointer_cast<const char*>(
-                                      frame->GetReadPtr()))),
-                      pitch(frame->GetPitch()), height(frame->GetHeight()),
-                      size(pitch * height) {
-                        DBGLOG( "framestreambuf::framestreambuf"
-                                "(PVideoFrame)");
-                        setg(beginning, beginning, beginning + size);
-                    }
+                framestreambuf(PVideoFrame frame) {
+                    DBGLOG( "framestreambuf::framestreambuf"
+                            "(PVideoFrame)");
+                    reset(frame);
+                }
 
                 // destructor
                 ~framestreambuf(void) {
@@ -50,30 +45,50 @@ namespace avsutil {
                 // assignment operator
                 framestreambuf& operator=(const framestreambuf& rhs);
 
+            public:
+                // Shows the pixels of "target" from the beginning.  An empty
+                // "target" releases the current frame.
+                void reset(PVideoFrame target) {
+                    frame = target;
+                    if (!frame) {
+                        beginning = NULL;
+                        pitch = height = size = 0;
+                    }
+                    else {
+                        beginning = const_cast<char*>(
+                                util::cast::constpointer_cast<const char*>(
+                                    frame->GetReadPtr()));
+                        pitch = frame->GetPitch();
+                        height = frame->GetHeight();
+                        size = pitch * height;
+                    }
+                    setg(beginning, beginning, beginning + size);
+                }
+
             protected:
                 pos_type seekoff(
                         off_type off, std::ios_base::seekdir way,
                         std::ios_base::openmode which =
                         std::ios_base::in | std::ios_base::out) {
-                    DBGLOG( "framestreambuf::seekoff(" << off << ", "
+                    TRCLOG( "framestreambuf::seekoff(" << off << ", "
                             << way << ", " << which << ")");
 
                     // Does only if a stream is opened in an input mode
                     if ((which & std::ios_base::in) == std::ios_base::in) {
                         uint64_t current_pos = gptr() - eback();
 
-                        DBGLOG("current position: " << current_pos);
+                        TRCLOG("current position: " << current_pos);
 
                         // In case of tellg()
                         if (way == std::ios_base::cur && off == 0) {
-                            DBGLOG("call by tellg()");
+                            TRCLOG("call by tellg()");
                             // The current position may be different from
                             // eback(), after setg().
                             return pos_type(off_type(current_pos));
                         }
 
                         // In case of seekg()
-                        DBGLOG("call by seekg()");
+                        TRCLOG("call by seekg()");
                         uint64_t target;
                         switch (way) {
                             case std::ios_base::beg:
@@ -89,12 +104,12 @@ namespace avsutil {
                                 return pos_type(off_type(-1));
                         }
 
-                        DBGLOG("0 <= " << target << " < " << size << "?");
+                        TRCLOG("0 <= " << target << " < " << size << "?");
                         if (target < 0 || size <= target) {
-                            DBGLOG("out of range. failed to seekoff");
+                            TRCLOG("out of range. failed to seekoff");
                             return pos_type(off_type(-1));
                         }
-                        DBGLOG("OK");
+                        TRCLOG("OK");
 
                         setg(beginning, beginning + target, beginning + size);
 
@@ -107,43 +122,54 @@ namespace avsutil {
                         pos_type sp,
                         std::ios_base::openmode which =
                         std::ios_base::in | std::ios_base::out) {
-                    DBGLOG( "framestreambuf::seekpos("
+                    TRCLOG( "framestreambuf::seekpos("
                             << sp << ", " << which << ")");
                     return seekoff(off_type(sp), std::ios_base::beg, which);
                 }
         };
 
-        class iframestream : public std::istream {
+        /*
+         *  An object of this class can be reused for other frames by
+         *  reset(), so that streams don't have to be created for each frame.
+         *  The internal streambuf is created from the arena given to the
+         *  constructor.
+         * */
+        class iframestream
+            : public std::istream, public util::pool::pooled {
             private:
-                const std::streambuf* internal_buf;
-                unsigned int n;
+                framestreambuf* const internal_buf;
 
             public:
                 // constructor
-                iframestream(PVideoFrame frame, unsigned int n)
-                : std::istream(new framestreambuf(frame)),
-                  internal_buf(rdbuf()), n(n) {
-                    DBGLOG( "iframestream::iframestream"
-                            "(PVideoFrame, " << n << ")");
+                iframestream(PVideoFrame frame, util::pool::arena& arena)
+                : std::istream(new(arena) framestreambuf(frame)),
+                  internal_buf(static_cast<framestreambuf*>(rdbuf())) {
+                    DBGLOG( "iframestream::iframestream(PVideoFrame, "
+                            "util::pool::arena&)");
                 }
 
                 // destructor
                 ~iframestream(void) {
                     DBGLOG("iframestream::~iframestream(void)");
-                    if (rdbuf() == internal_buf) {
-                        DBGLOG( "delete the internal streambuf.");
-                        delete rdbuf();
-                    }
+                    // The internal streambuf may be replaced by a caller but
+                    // it is still owned by this.
+                    delete internal_buf;
                 }
 
-                // utility function
-                bool is_me(unsigned int n) { return (this->n == n); }
-
             private:
                 // copy constructor
                 iframestream(const iframestream& rhs);
                 // assignment operator
                 iframestream& operator=(const iframestream& rhs);
+
+            public:
+                // Restores the internal streambuf and the state, and shows
+                // "frame" from the beginning.
+                void reset(PVideoFrame frame) {
+                    DBGLOG("iframestream::reset(PVideoFrame)");
+                    rdbuf(internal_buf);
+                    internal_buf->reset(frame);
+                }
         };
     }
 }
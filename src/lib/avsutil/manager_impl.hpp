@@ -12,35 +12,123 @@
 #include "../../include/avsutil.hpp"
 
 #include "avs_impl.hpp"
+#include "envpool.hpp"
+#include "metacache.hpp"
 
-#include <list>
 #include <algorithm>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#   include <unordered_map>
+#else
+#   include <tr1/unordered_map>
+#endif
 
-#include "../../helper/algorithm.hpp"
 #include "../../helper/dlogger.hpp"
+#include "../../helper/thread.hpp"
 
 namespace avsutil {
     namespace impl {
         class cmanager_type : public manager_type {
             private:
-                typedef std::list<cavs_type*> cavses_type;
+                // the most recently loaded is the first
+                typedef std::list<cavs_type*> lru_type;
+                struct entry_type {
+                    cavs_type* avs;
+                    lru_type::iterator position;    // in lru
+                    // calls of load() and so on that are not unloaded, to
+                    // keep "avs" for those in progress on other threads
+                    uint32_t references;
+                };
+                typedef std::tr1::unordered_map<std::string, entry_type>
+                    cavses_type;
+
+                /*
+                 *  A thread to open scripts for load_all().  Some objects of
+                 *  this class share "jobs" and take a script one by one.
+                 * */
+                struct jobs_type {
+                    util::thread::mutex lock;
+                    const std::vector<std::string>* filepaths;
+                    const std::vector<cavs_type*>* targets;
+                    uint32_t memory_max;
+                    std::size_t next;   // guarded by "lock"
+                };
+                class opener : public util::thread::thread {
+                    private:
+                        jobs_type& jobs;
+
+                    public:
+                        explicit opener(jobs_type& jobs) : jobs(jobs) {}
+
+                    private:
+                        // copy constructor
+                        opener(const opener& rhs);
+                        // assignment operator
+                        opener& operator=(const opener& rhs);
+
+                    public:
+                        void run(void) {
+                            for (;;) {
+                                std::size_t i;
+                                {
+                                    util::thread::scoped_lock l(jobs.lock);
+                                    if (jobs.next >= jobs.targets->size()) {
+                                        return;
+                                    }
+                                    i = jobs.next++;
+                                }
+                                (*jobs.targets)[i]->open_if_needed(
+                                        (*jobs.filepaths)[i].c_str());
+                                (*jobs.targets)[i]->memory_max(
+                                        jobs.memory_max);
+                            }
+                        }
+                };
 
             private:
+                // This has its own lock and outlives objects of cavs_type.
+                mutable envpool mv_envpool;
+                // This has its own lock too.
+                mutable metacache mv_metacache;
+
+                /*
+                 *  guards all variables below
+                 *  Objects of cavs_type are not waited for with this locked,
+                 *  so that an import doesn't block other threads: their
+                 *  states are read by cavs_type::state() and they are
+                 *  changed only when they are not used.
+                 * */
+                mutable util::thread::mutex mv_lock;
                 cavses_type cavses;
+                lru_type lru;
+                uint64_t mv_budget;
+                uint32_t mv_script_memory_max;
+                cache_stats_type mv_stats;
 
             public:
                 // constructor
-                cmanager_type(void) {
+                cmanager_type(void)
+                    : mv_budget(0), mv_script_memory_max(0) {
                     DBGLOG("cmanager_type::cmanager_type(void)");
+                    mv_stats.hits = 0;
+                    mv_stats.misses = 0;
+                    mv_stats.evictions = 0;
+                    mv_stats.usage = 0;
                 }
 
             public:
                 // destructor
                 ~cmanager_type(void) {
                     DBGLOG("cmanager_type::~cmanager_type(void)");
-                    std::for_each(
-                            cavses.rbegin(), cavses.rend(),
-                            util::algorithm::sweeper());
+                    for (lru_type::iterator itr = lru.begin();
+                            itr != lru.end(); ++itr) {
+                        delete *itr;
+                    }
                 }
 
             public:
@@ -68,39 +156,236 @@ namespace avsutil {
                 avs_type& load(const char* file_path) {
                     DBGLOG("cavs_loader_type::load(" << file_path << ")");
 
-                    cavses_type::iterator found =
-                        std::find_if(
-                                cavses.begin(), cavses.end(),
-                                std::bind2nd(
-                                    std::mem_fun(
-                                        &avsutil::impl::cavs_type::is_me),
-                                    file_path));
+                    // Scripts are opened without mv_lock so that other
+                    // threads can load other scripts meanwhile.
+                    cavs_type* target = entry(file_path);
+                    target->open_if_needed(file_path);
+                    target->memory_max(script_memory_max());
 
-                    // found
-                    if (found != cavses.end()) return **found;
+                    util::thread::scoped_lock lock(mv_lock);
+                    evict(&target, &target + 1);
+                    return *target;
+                }
 
-                    // not found and create
-                    cavs_type* created = new impl::cavs_type();
-                    created->open(file_path);
-                    cavses.push_back(created);
-                    return *created;
+                std::vector<avs_type*>
+                load_all(const std::vector<std::string>& filepaths) {
+                    DBGLOG( "cavs_loader_type::load_all("
+                            << filepaths.size() << " files)");
+
+                    std::vector<cavs_type*> targets;
+                    targets.reserve(filepaths.size());
+                    for (std::size_t i = 0; i < filepaths.size(); ++i) {
+                        targets.push_back(entry(filepaths[i].c_str()));
+                    }
+
+                    // The current thread is one of the openers.
+                    jobs_type jobs;
+                    jobs.filepaths = &filepaths;
+                    jobs.targets = &targets;
+                    jobs.memory_max = script_memory_max();
+                    jobs.next = 0;
+                    const std::size_t numof_threads = std::min<std::size_t>(
+                            filepaths.size(),
+                            util::thread::numof_processors());
+                    std::vector<opener*> openers;
+                    for (std::size_t i = 1; i < numof_threads; ++i) {
+                        std::auto_ptr<opener> created(new opener(jobs));
+                        if (!created->start()) break;
+                        openers.push_back(created.release());
+                    }
+                    opener(jobs).run();
+                    for (std::vector<opener*>::iterator itr = openers.begin();
+                            itr != openers.end(); ++itr) {
+                        (*itr)->join();
+                        delete *itr;
+                    }
+
+                    util::thread::scoped_lock lock(mv_lock);
+                    if (!targets.empty()) {
+                        evict(&targets[0], &targets[0] + targets.size());
+                    }
+                    return std::vector<avs_type*>(
+                            targets.begin(), targets.end());
+                }
+
+                avs_type& load_metadata(const char* file_path) {
+                    DBGLOG("cavs_loader_type::load_metadata("
+                            << file_path << ")");
+
+                    // The script is closed at once unless it was opened
+                    // already, so the budget is not needed to be applied.
+                    cavs_type* target = entry(file_path);
+                    if (!mv_metacache.is_enabled()) {
+                        target->read_info_if_needed(file_path);
+                        return *target;
+                    }
+
+                    metacache::entry_type cached;
+                    if (mv_metacache.find(file_path, cached)) {
+                        target->restore(
+                                file_path, cached.is_fine, cached.errmsg,
+                                cached.video_info, cached.audio_info);
+                        return *target;
+                    }
+
+                    target->read_info_if_needed(file_path);
+                    cached.is_fine = target->is_fine();
+                    cached.errmsg = target->errmsg();
+                    cached.video_info = target->video_info();
+                    cached.audio_info = target->audio_info();
+                    mv_metacache.store(file_path, cached);
+                    return *target;
                 }
 
+                /*
+                 *  The caller must make sure that no other threads use
+                 *  "target" by the reference that the caller got.  Those
+                 *  that load it by themselves have their own references.
+                 * */
                 void unload(const avs_type& target) {
                     DBGLOG( "cavs_loader_type::release("
                             << target.filepath() << ")");
 
+                    util::thread::scoped_lock lock(mv_lock);
+
                     cavses_type::iterator found =
-                        std::find(cavses.begin(), cavses.end(), &target);
+                        cavses.find(target.filepath());
 
-                    if (found != cavses.end()) {
-                        delete *found;
+                    if (       found != cavses.end()
+                            && found->second.avs == &target
+                            && --found->second.references == 0) {
+                        delete found->second.avs;
+                        lru.erase(found->second.position);
                         cavses.erase(found);
                     }
                 }
+
+                void budget(uint64_t bytes, uint32_t script_memory_max) {
+                    DBGLOG( "cavs_loader_type::budget(" << bytes << ", "
+                            << script_memory_max << ")");
+
+                    // Scripts used by other threads now are set when they
+                    // are loaded next.
+                    util::thread::scoped_lock lock(mv_lock);
+                    mv_budget = bytes;
+                    mv_script_memory_max = script_memory_max;
+                    for (lru_type::iterator itr = lru.begin();
+                            itr != lru.end(); ++itr) {
+                        (*itr)->try_memory_max(mv_script_memory_max);
+                    }
+                    evict(static_cast<cavs_type* const*>(NULL),
+                          static_cast<cavs_type* const*>(NULL));
+                }
+
+                cache_stats_type cache_stats(void) const {
+                    util::thread::scoped_lock lock(mv_lock);
+                    cache_stats_type stats = mv_stats;
+                    stats.usage = usage_nolock();
+                    return stats;
+                }
+
+                void env_pool(std::size_t capacity) {
+                    DBGLOG( "cavs_loader_type::env_pool("
+                            << capacity << ")");
+                    mv_envpool.capacity(capacity);
+                }
+
+                env_pool_stats_type env_pool_stats(void) const {
+                    return mv_envpool.statistics();
+                }
+
+                void metadata_cache(const char* filepath, bool is_refreshed) {
+                    mv_metacache.open(filepath, is_refreshed);
+                }
+
+                metadata_cache_stats_type metadata_cache_stats(void) const {
+                    return mv_metacache.statistics();
+                }
+
+            private:
+                // utility functions
+                /*
+                 *  Returns the object for "file_path" as the most recently
+                 *  loaded, creating it if needed, with a reference for the
+                 *  caller.  The object may not be opened yet.
+                 * */
+                cavs_type* entry(const char* file_path) {
+                    util::thread::scoped_lock lock(mv_lock);
+
+                    cavses_type::iterator found = cavses.find(file_path);
+                    if (found != cavses.end()) {
+                        // found
+                        cavs_type* target = found->second.avs;
+                        ++found->second.references;
+                        lru.splice(lru.begin(), lru, found->second.position);
+
+                        // closed by eviction or failed to open last time
+                        // unless it is ready
+                        const cavs_type::state_type state = target->state();
+                        if (state.is_opened && state.is_fine) {
+                            ++mv_stats.hits;
+                        }
+                        else {
+                            ++mv_stats.misses;
+                        }
+                        return target;
+                    }
+
+                    // not found and create
+                    ++mv_stats.misses;
+                    std::auto_ptr<cavs_type> created(
+                            new cavs_type(mv_envpool));
+                    lru.push_front(created.get());
+                    entry_type entry = {created.get(), lru.begin(), 1};
+                    cavses.insert(std::make_pair(file_path, entry));
+                    return created.release();
+                }
+
+                uint32_t script_memory_max(void) const {
+                    util::thread::scoped_lock lock(mv_lock);
+                    return mv_script_memory_max;
+                }
+
+                // Returns the memory charged for the opened scripts.
+                // This must be called with mv_lock locked.
+                uint64_t usage_nolock(void) const {
+                    uint64_t usage = 0;
+                    for (lru_type::const_iterator itr = lru.begin();
+                            itr != lru.end(); ++itr) {
+                        usage += (*itr)->state().memory_max;
+                    }
+                    return usage;
+                }
+
+                // Closes the least recently loaded scripts except those in
+                // [first, last) until the memory usage fits in the budget.
+                // Scripts whose objects of video() or audio() are not
+                // released are kept, because the callers have the
+                // references of them, and so are those used by other
+                // threads now.
+                // This must be called with mv_lock locked.
+                template<typename ForwardIterator>
+                void evict(ForwardIterator first, ForwardIterator last) {
+                    if (mv_budget == 0) return;
+
+                    uint64_t usage = usage_nolock();
+
+                    for (lru_type::reverse_iterator itr = lru.rbegin();
+                            usage > mv_budget && itr != lru.rend(); ++itr) {
+                        const cavs_type::state_type state = (*itr)->state();
+                        if (       !state.is_opened
+                                || std::find(first, last, *itr) != last
+                                || !(*itr)->close_if_idle()) {
+                            continue;
+                        }
+
+                        DBGLOG("evict " << (*itr)->filepath());
+                        usage -= state.memory_max;
+                        ++mv_stats.evictions;
+                    }
+                }
         };
     }
 }
 
 #endif // MANAGER_IMPL_HPP
-
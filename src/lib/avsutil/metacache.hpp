@@ -0,0 +1,474 @@
+/*
+ * metacache.hpp
+ *  Declarations and definitions of a class metacache
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef METACACHE_HPP
+#define METACACHE_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include "sources.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _MSC_VER
+#   include <windows.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/mmap.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to keep the informations of scripts and the results of
+         *  their imports in a file, for manager_type::load_metadata().
+         *
+         *  The file is a header and records appended one after another, and
+         *  it is mapped into memory to read at once when it is opened.  The
+         *  numbers are in the byte order of the machine, and a file written
+         *  by a machine of another order is discarded.
+         *
+         *      header: "AVSUMETA", uint32 version, uint32 0x01020304
+         *      record: uint32 length, uint32 checksum, the body and zeros
+         *              to align the length to 8 bytes
+         *
+         *  A later record replaces an earlier one of the same path.  A
+         *  broken record, e.g. written halfway, and the records after it
+         *  are ignored, and the file is rewritten at the next store.
+         * */
+        class metacache {
+            public:
+                // typedefs
+                typedef manager_type::metadata_cache_stats_type stats_type;
+
+                // what a script is identified by besides its path
+                struct key_type {
+                    bool is_valid;      // false if the script can't be read
+                    uint64_t mtime;     // the modification time
+                    uint64_t size;      // the size in bytes
+                    uint64_t hash;      // FNV-1a of the content, 0 for
+                                        // the files of native backends
+                };
+
+                struct entry_type {
+                    key_type key;
+                    bool is_fine;
+                    std::string errmsg;
+                    video_type::info_type video_info;
+                    audio_type::info_type audio_info;
+                };
+
+            private:
+                typedef std::map<std::string, entry_type> entries_type;
+
+                // constants
+                static const uint32_t version = 1;
+                static const uint32_t byte_order = 0x01020304;
+                static const std::size_t header_size = 16;
+                static const std::size_t record_header_size = 8;
+                // the file is rewritten when stale records exceed this
+                static const std::size_t max_stale_records = 256;
+
+            private:
+                // variables guarded by "lock"
+                util::thread::mutex lock;
+                std::string mv_filepath;    // empty when disabled
+                bool mv_is_refreshed;
+                entries_type entries;
+                std::size_t numof_records;  // in the file, stale ones too
+                bool is_rewrite_needed;
+                stats_type stats;
+
+            public:
+                // constructor
+                metacache(void)
+                    : mv_is_refreshed(false),
+                      numof_records(0), is_rewrite_needed(false) {
+                    DBGLOG("avsutil::impl::metacache::metacache(void)");
+                    stats.hits = stats.misses = 0;
+                }
+
+            private:
+                // copy constructor
+                metacache(const metacache& rhs);
+                // assignment operator
+                metacache& operator=(const metacache& rhs);
+
+            public:
+                /*
+                 *  Reads the file located on "filepath".  If "is_refreshed"
+                 *  is true, find() misses always and store() replaces the
+                 *  entries.  NULL disables.
+                 * */
+                void open(const char* filepath, bool is_refreshed) {
+                    DBGLOG("avsutil::impl::metacache::open("
+                            << (filepath != NULL ? filepath : "NULL") << ", "
+                            << is_refreshed << ")");
+
+                    util::thread::scoped_lock l(lock);
+                    mv_filepath = (filepath != NULL) ? filepath : "";
+                    mv_is_refreshed = is_refreshed;
+                    entries.clear();
+                    numof_records = 0;
+                    is_rewrite_needed = true;
+                    if (mv_filepath.empty()) return;
+
+                    util::io::mapped_file file;
+                    if (!file.open(mv_filepath.c_str())) return;
+                    is_rewrite_needed = !read(file.data(), file.size());
+                }
+
+                bool is_enabled(void) {
+                    util::thread::scoped_lock l(lock);
+                    return !mv_filepath.empty();
+                }
+
+                /*
+                 *  Makes the key of the script located on "path" into
+                 *  "found.key", and copies the entry into "found" if it
+                 *  matches.  The content of a script is read to compute the
+                 *  key, but it is much cheaper than to import the script.
+                 *  A file of a native backend, e.g. a video of some GB, is
+                 *  identified by its modification time and size only.
+                 * */
+                bool find(const char* path, entry_type& found) {
+                    found.key = make_key(path);
+
+                    util::thread::scoped_lock l(lock);
+                    if (mv_filepath.empty()) return false;
+
+                    entries_type::const_iterator itr = entries.find(path);
+                    if (       mv_is_refreshed
+                            || !found.key.is_valid
+                            || itr == entries.end()
+                            || !is_same(itr->second.key, found.key)) {
+                        ++stats.misses;
+                        return false;
+                    }
+
+                    ++stats.hits;
+                    found = itr->second;
+                    return true;
+                }
+
+                // Keeps "entry" with the key made by find().
+                void store(const char* path, const entry_type& entry) {
+                    if (!entry.key.is_valid) return;
+
+                    util::thread::scoped_lock l(lock);
+                    if (mv_filepath.empty()) return;
+
+                    entries[path] = entry;
+                    ++numof_records;
+                    if (       is_rewrite_needed
+                            || numof_records - entries.size()
+                                > max_stale_records) {
+                        rewrite();
+                    }
+                    else {
+                        append(path, entry);
+                    }
+                }
+
+                stats_type statistics(void) {
+                    util::thread::scoped_lock l(lock);
+                    return stats;
+                }
+
+            private:
+                // Reads records.  Returns false if the file is broken.
+                // These must be called with "lock" locked.
+                bool read(const uint8_t* data, std::size_t size) {
+                    if (       size < header_size
+                            || std::memcmp(data, "AVSUMETA", 8) != 0
+                            || load<uint32_t>(data + 8) != version
+                            || load<uint32_t>(data + 12) != byte_order) {
+                        return false;
+                    }
+
+                    std::size_t offset = header_size;
+                    while (offset + record_header_size <= size) {
+                        const uint8_t* record = data + offset;
+                        const uint32_t length = load<uint32_t>(record);
+                        if (       length < record_header_size
+                                || length % 8 != 0
+                                || length > size - offset
+                                || load<uint32_t>(record + 4)
+                                    != checksum(
+                                        record + record_header_size,
+                                        length - record_header_size)) {
+                            return false;
+                        }
+
+                        std::string path;
+                        entry_type entry;
+                        if (!decode(record + record_header_size,
+                                    length - record_header_size,
+                                    path, entry)) {
+                            return false;
+                        }
+                        entries[path] = entry;
+                        ++numof_records;
+                        offset += length;
+                    }
+                    return offset == size;
+                }
+
+                void append(const char* path, const entry_type& entry) {
+                    std::vector<uint8_t> record;
+                    encode(path, entry, record);
+
+                    std::FILE* fp = std::fopen(mv_filepath.c_str(), "ab");
+                    if (fp == NULL) return;
+                    std::fwrite(&record[0], 1, record.size(), fp);
+                    std::fclose(fp);
+                }
+
+                // Writes all entries to a new file and replaces the file.
+                void rewrite(void) {
+                    DBGLOG("rewrite " << mv_filepath);
+
+                    const std::string temporary = mv_filepath + ".tmp";
+                    std::FILE* fp = std::fopen(temporary.c_str(), "wb");
+                    if (fp == NULL) return;
+
+                    std::vector<uint8_t> buffer;
+                    buffer.insert(buffer.end(), "AVSUMETA", "AVSUMETA" + 8);
+                    save(buffer, version);
+                    save(buffer, byte_order);
+                    for (entries_type::const_iterator itr = entries.begin();
+                            itr != entries.end(); ++itr) {
+                        encode(itr->first.c_str(), itr->second, buffer);
+                    }
+                    const bool is_written =
+                        std::fwrite(&buffer[0], 1, buffer.size(), fp)
+                            == buffer.size();
+                    if (std::fclose(fp) != 0 || !is_written) {
+                        std::remove(temporary.c_str());
+                        return;
+                    }
+
+#ifdef _MSC_VER
+                    if (!MoveFileExA(
+                                temporary.c_str(), mv_filepath.c_str(),
+                                MOVEFILE_REPLACE_EXISTING)) {
+#else
+                    if (std::rename(
+                                temporary.c_str(),
+                                mv_filepath.c_str()) != 0) {
+#endif
+                        std::remove(temporary.c_str());
+                        return;
+                    }
+                    numof_records = entries.size();
+                    is_rewrite_needed = false;
+                }
+
+                // Appends a record of "entry" to "buffer".
+                static void encode( const char* path, const entry_type& entry,
+                                    std::vector<uint8_t>& buffer) {
+                    const std::size_t head = buffer.size();
+                    buffer.resize(head + record_header_size);
+
+                    const std::size_t path_length = std::strlen(path);
+                    const video_type::info_type& v = entry.video_info;
+                    const audio_type::info_type& a = entry.audio_info;
+                    save(buffer, entry.key.mtime);
+                    save(buffer, entry.key.size);
+                    save(buffer, entry.key.hash);
+                    save(buffer, static_cast<uint32_t>(path_length));
+                    save(buffer, static_cast<uint32_t>(entry.errmsg.size()));
+                    save(buffer, static_cast<uint8_t>(entry.is_fine));
+
+                    save(buffer, static_cast<uint8_t>(v.exists));
+                    save(buffer, v.width);
+                    save(buffer, v.height);
+                    save(buffer, v.time);
+                    save(buffer, v.fps);
+                    save(buffer, v.fps_numerator);
+                    save(buffer, v.fps_denominator);
+                    save(buffer, v.numof_frames);
+                    save(buffer, static_cast<uint32_t>(v.color_space));
+                    save(buffer, v.bpp);
+                    save(buffer, static_cast<uint8_t>(v.is_fieldbased));
+                    save(buffer, static_cast<uint8_t>(v.is_tff));
+                    save(buffer, v.planes);
+
+                    save(buffer, static_cast<uint8_t>(a.exists));
+                    save(buffer, a.channels);
+                    save(buffer, a.bit_depth);
+                    save(buffer, static_cast<uint8_t>(a.is_int));
+                    save(buffer, a.time);
+                    save(buffer, a.sampling_rate);
+                    save(buffer, a.numof_samples);
+                    save(buffer, a.block_size);
+
+                    buffer.insert(buffer.end(), path, path + path_length);
+                    buffer.insert(
+                            buffer.end(),
+                            entry.errmsg.begin(), entry.errmsg.end());
+                    buffer.resize(head + (buffer.size() - head + 7) / 8 * 8);
+
+                    const uint32_t length =
+                        static_cast<uint32_t>(buffer.size() - head);
+                    const uint32_t sum = checksum(
+                            &buffer[head + record_header_size],
+                            length - record_header_size);
+                    std::memcpy(&buffer[head], &length, sizeof(length));
+                    std::memcpy(&buffer[head + 4], &sum, sizeof(sum));
+                }
+
+                // Reads a body of a record.  Returns false if it is broken.
+                static bool decode( const uint8_t* body, std::size_t size,
+                                    std::string& path, entry_type& entry) {
+                    const uint8_t* p = body;
+                    const uint8_t* const end = body + size;
+                    uint32_t path_length, errmsg_length;
+                    video_type::info_type& v = entry.video_info;
+                    audio_type::info_type& a = entry.audio_info;
+                    uint32_t color_space;
+
+                    entry.key.is_valid = true;
+                    if (       !fetch(p, end, entry.key.mtime)
+                            || !fetch(p, end, entry.key.size)
+                            || !fetch(p, end, entry.key.hash)
+                            || !fetch(p, end, path_length)
+                            || !fetch(p, end, errmsg_length)
+                            || !fetch_bool(p, end, entry.is_fine)
+
+                            || !fetch_bool(p, end, v.exists)
+                            || !fetch(p, end, v.width)
+                            || !fetch(p, end, v.height)
+                            || !fetch(p, end, v.time)
+                            || !fetch(p, end, v.fps)
+                            || !fetch(p, end, v.fps_numerator)
+                            || !fetch(p, end, v.fps_denominator)
+                            || !fetch(p, end, v.numof_frames)
+                            || !fetch(p, end, color_space)
+                            || !fetch(p, end, v.bpp)
+                            || !fetch_bool(p, end, v.is_fieldbased)
+                            || !fetch_bool(p, end, v.is_tff)
+                            || !fetch(p, end, v.planes)
+
+                            || !fetch_bool(p, end, a.exists)
+                            || !fetch(p, end, a.channels)
+                            || !fetch(p, end, a.bit_depth)
+                            || !fetch_bool(p, end, a.is_int)
+                            || !fetch(p, end, a.time)
+                            || !fetch(p, end, a.sampling_rate)
+                            || !fetch(p, end, a.numof_samples)
+                            || !fetch(p, end, a.block_size)
+
+                            || static_cast<std::size_t>(end - p)
+                                < static_cast<uint64_t>(path_length)
+                                    + errmsg_length) {
+                        return false;
+                    }
+                    v.color_space =
+                        static_cast<video_type::info_type::fourcc_type>(
+                                color_space);
+
+                    const char* chars = reinterpret_cast<const char*>(p);
+                    path.assign(chars, path_length);
+                    entry.errmsg.assign(chars + path_length, errmsg_length);
+                    return true;
+                }
+
+                template<typename T>
+                static void save(std::vector<uint8_t>& buffer, T value) {
+                    const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+                    buffer.insert(buffer.end(), p, p + sizeof(T));
+                }
+
+                // Records are not aligned for T, so these copy bytes.
+                template<typename T>
+                static T load(const uint8_t* p) {
+                    T value;
+                    std::memcpy(&value, p, sizeof(T));
+                    return value;
+                }
+
+                template<typename T>
+                static bool fetch(  const uint8_t*& p, const uint8_t* end,
+                                    T& value) {
+                    if (static_cast<std::size_t>(end - p) < sizeof(T)) {
+                        return false;
+                    }
+                    value = load<T>(p);
+                    p += sizeof(T);
+                    return true;
+                }
+
+                static bool fetch_bool( const uint8_t*& p, const uint8_t* end,
+                                        bool& value) {
+                    uint8_t byte;
+                    if (!fetch(p, end, byte)) return false;
+                    value = (byte != 0);
+                    return true;
+                }
+
+                static bool is_same(const key_type& lhs, const key_type& rhs) {
+                    return     lhs.mtime == rhs.mtime
+                            && lhs.size == rhs.size
+                            && lhs.hash == rhs.hash;
+                }
+
+                // Makes the key of the script located on "path".
+                static key_type make_key(const char* path) {
+                    key_type key = {false, 0, 0, 0};
+
+#ifdef _MSC_VER
+                    struct _stat64 st;
+                    if (_stat64(path, &st) != 0) return key;
+#else
+                    struct stat st;
+                    if (stat(path, &st) != 0) return key;
+#endif
+                    key.mtime = static_cast<uint64_t>(st.st_mtime);
+                    key.size = static_cast<uint64_t>(st.st_size);
+                    if (!source_of(path).is_native) {
+                        util::io::mapped_file file;
+                        if (!file.open(path)) return key;
+                        key.hash = fnv1a(file.data(), file.size());
+                    }
+                    key.is_valid = true;
+                    return key;
+                }
+
+                // the 64-bit FNV-1a hash
+                static uint64_t fnv1a(const uint8_t* data, std::size_t size) {
+                    // C++03 has no literals of 64 bits.
+                    const uint64_t prime =
+                        (static_cast<uint64_t>(0x100) << 32) | 0x1b3;
+                    uint64_t hash =
+                        (static_cast<uint64_t>(0xcbf29ce4) << 32) | 0x84222325;
+                    for (std::size_t i = 0; i < size; ++i) {
+                        hash ^= data[i];
+                        hash *= prime;
+                    }
+                    return hash;
+                }
+
+                static uint32_t
+                checksum(const uint8_t* data, std::size_t size) {
+                    const uint64_t hash = fnv1a(data, size);
+                    return static_cast<uint32_t>(hash ^ (hash >> 32));
+                }
+        };
+    }
+}
+
+#endif // METACACHE_HPP
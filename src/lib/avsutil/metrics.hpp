@@ -0,0 +1,123 @@
+/*
+ * metrics.hpp
+ *  Declarations and definitions of classes cmetrics and scoped_timer
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include "../../include/avsutil.hpp"
+
+#include <cstring>
+
+#include "../../helper/clock.hpp"
+#include "../../helper/thread.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A class to collect metrics_type.  The flag is read without the
+         *  lock, so a call that is running when the measurement is enabled
+         *  or disabled may or may not be counted.
+         * */
+        class cmetrics {
+            private:
+                typedef metrics_type::kind_type kind_type;
+
+            private:
+                // variables
+                volatile bool mv_enabled;
+                util::thread::mutex lock;
+                metrics_type data;      // guarded by "lock"
+
+            public:
+                // constructor
+                cmetrics(void) : mv_enabled(false) { clear(); }
+
+            private:
+                // copy constructor
+                cmetrics(const cmetrics& rhs);
+                // assignment operator
+                cmetrics& operator=(const cmetrics& rhs);
+
+            public:
+                bool is_enabled(void) const { return mv_enabled; }
+                void enable(bool enabled) { mv_enabled = enabled; }
+
+                void record(kind_type kind, uint64_t ns) {
+                    util::thread::scoped_lock l(lock);
+                    metrics_type::entry_type& e = data.entries[kind];
+                    ++e.count;
+                    e.total_ns += ns;
+                    if (e.max_ns < ns) e.max_ns = ns;
+                    ++e.histogram[bucket(ns)];
+                }
+
+                metrics_type snapshot(void) {
+                    util::thread::scoped_lock l(lock);
+                    return data;
+                }
+
+                void reset(void) {
+                    util::thread::scoped_lock l(lock);
+                    clear();
+                }
+
+            private:
+                void clear(void) { std::memset(&data, 0, sizeof(data)); }
+
+                // Returns the index of the highest bit of "ns".
+                static unsigned int bucket(uint64_t ns) {
+                    unsigned int i = 0;
+                    while (ns > 1 && i + 1 < metrics_type::numof_buckets) {
+                        ns >>= 1;
+                        ++i;
+                    }
+                    return i;
+                }
+        };
+
+        // the object shared by the library, defined in avsutil_impl.cpp
+        cmetrics& metrics_registry(void);
+
+        /*
+         *  A class to record the time of a scope as "kind".  The clock is not
+         *  read while the measurement is disabled.
+         *
+         *      {
+         *          scoped_timer t(metrics_type::GET_FRAME);
+         *          frame = clip->GetFrame(n, se);
+         *      }
+         * */
+        class scoped_timer {
+            private:
+                const metrics_type::kind_type kind;
+                const bool is_timing;
+                const uint64_t start;
+
+            public:
+                explicit scoped_timer(metrics_type::kind_type kind)
+                    : kind(kind),
+                      is_timing(metrics_registry().is_enabled()),
+                      start(is_timing ? util::time::monotonic_ns() : 0) {}
+
+                ~scoped_timer(void) {
+                    if (!is_timing) return;
+                    metrics_registry().record(
+                            kind, util::time::monotonic_ns() - start);
+                }
+
+            private:
+                // copy constructor
+                scoped_timer(const scoped_timer& rhs);
+                // assignment operator
+                scoped_timer& operator=(const scoped_timer& rhs);
+        };
+    }
+}
+
+#endif // METRICS_HPP
+
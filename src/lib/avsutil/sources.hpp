@@ -0,0 +1,107 @@
+/*
+ * sources.hpp
+ *  Declarations and definitions for backends to open files as clips
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef SOURCES_HPP
+#define SOURCES_HPP
+
+#include "avisynth.h"
+
+#include "wavclip.hpp"
+#include "y4mclip.hpp"
+
+#include <cctype>
+#include <cstring>
+#include <string>
+
+#include "../../helper/dlogger.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  The registry of backends that open files as clips.  A backend is
+         *  chosen by the extension of a file, and the files that no backend
+         *  takes are imported by AviSynth as scripts.  Add a backend to the
+         *  table in open_source() with a function to open a file, that
+         *  throws AvisynthError by "se" if it fails.
+         *
+         *  Native backends read files without AviSynth, and use "se" only to
+         *  allocate frames.  They also work for the workers of
+         *  framerenderer, since each of them opens a file by itself.  The
+         *  informations of a native file depend on nothing but the file.
+         * */
+        struct source_type {
+            const char* extension;  // in lower case without ".",
+                                    // NULL matches any file
+            PClip (*open)(const char* filepath, IScriptEnvironment* se);
+            bool is_native;
+        };
+
+        inline PClip open_y4m(const char* filepath, IScriptEnvironment* se) {
+            return new y4mclip(filepath, se);
+        }
+
+        inline PClip open_wav(const char* filepath, IScriptEnvironment* se) {
+            return new wavclip(filepath, se);
+        }
+
+        inline PClip
+        open_script(const char* filepath, IScriptEnvironment* se) {
+            // pack the filename as the argument of AviSynth filter
+            AVSValue filename = filepath;
+            AVSValue args = AVSValue(&filename, 1);
+            return se->Invoke("Import", args, 0).AsClip();
+        }
+
+        // Returns the extension of "filepath" in lower case.
+        inline std::string extension_of(const char* filepath) {
+            const char* const dot = std::strrchr(filepath, '.');
+            if (       dot == NULL
+                    || std::strchr(dot, '/') != NULL
+                    || std::strchr(dot, '\\') != NULL) {
+                return std::string();
+            }
+
+            std::string extension(dot + 1);
+            for (std::string::iterator itr = extension.begin();
+                    itr != extension.end(); ++itr) {
+                *itr = static_cast<char>(
+                        std::tolower(static_cast<unsigned char>(*itr)));
+            }
+            return extension;
+        }
+
+        // Returns the backend for the type of "filepath".
+        inline const source_type& source_of(const char* filepath) {
+            // This is initialized statically and safe for threads.
+            static const source_type sources[] = {
+                {"y4m", &open_y4m,      true},
+                {"wav", &open_wav,      true},
+                {NULL,  &open_script,   false}
+            };
+
+            const std::string extension = extension_of(filepath);
+            const source_type* source = sources;
+            while (       source->extension != NULL
+                       && extension != source->extension) {
+                ++source;
+            }
+            return *source;
+        }
+
+        /*
+         *  Opens "filepath" by the backend for its type.  Throws
+         *  AvisynthError if it fails.
+         * */
+        inline PClip open_source(const char* filepath, IScriptEnvironment* se) {
+            DBGLOG("avsutil::impl::open_source(" << filepath << ")");
+            return source_of(filepath).open(filepath, se);
+        }
+    }
+}
+
+#endif // SOURCES_HPP
@@ -13,38 +13,128 @@
 
 #include "avisynth.h"
 
+#include "frame_impl.hpp"
+#include "framecache.hpp"
+#include "frameprefetcher.hpp"
+#include "framerenderer.hpp"
+#include "framerequester.hpp"
 #include "iframestream.hpp"
+#include "metrics.hpp"
 
 #include <algorithm>
 #include <functional>
 #include <istream>
 #include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
-#include "../../helper/algorithm.hpp"
+#ifdef _MSC_VER
+#   include <unordered_map>
+#else
+#   include <tr1/unordered_map>
+#endif
+
+#include "../../helper/colorspace.hpp"
+#include "../../helper/pool.hpp"
+#include "../../helper/thread.hpp"
 
 namespace avsutil {
     namespace impl {
         class cvideo_type: public video_type {
             private:
-                typedef std::list<iframestream*>  framestreams_type;
+                /*
+                 *  Frame streams are indexed by both a frame number and an
+                 *  address of the stream.  Some callers can share a stream
+                 *  of the same frame, and it is kept for reuse when all of
+                 *  them release it.  These and frames are allocated from
+                 *  "mv_arena", so reading frames one after another doesn't
+                 *  use the heap in the steady state.
+                 * */
+                struct framestream_entry_type {
+                    iframestream* stream;
+                    cframe_type* frame;     // pinned while the stream lives
+                    unsigned int count;     // a number of callers
+                };
+                typedef std::tr1::unordered_map<
+                    uint32_t, framestream_entry_type,
+                    std::tr1::hash<uint32_t>, std::equal_to<uint32_t>,
+                    util::pool::allocator<
+                        std::pair<const uint32_t, framestream_entry_type> > >
+                    framestreams_type;
+                typedef std::tr1::unordered_map<
+                    const std::istream*, uint32_t,
+                    std::tr1::hash<const std::istream*>,
+                    std::equal_to<const std::istream*>,
+                    util::pool::allocator<
+                        std::pair<const std::istream* const, uint32_t> > >
+                    framenumbers_type;
+                typedef std::list<framerenderer*> renderers_type;
+                typedef std::list<crequest_type*> requests_type;
+
+                // constants
+                static const std::size_t initial_buckets = 16;
 
             private:
                 // variables
+                // This has to be destroyed after all objects allocated from
+                // this.
+                util::pool::arena mv_arena;
                 const PClip mv_clip;
+                // for color spaces that can't be converted in this library
                 PClip mv_rgb_clip;
                 IScriptEnvironment* mv_se;
+                util::thread::mutex& mv_se_lock;
                 const info_type mv_info;
                 framestreams_type framestreams;
+                framenumbers_type framenumbers;
+                std::vector<iframestream*> idle_streams;
+                uint32_t mv_prefetch_window;
+                std::auto_ptr<frameprefetcher> mv_prefetcher;
+                // statistics of prefetchers that have been already deleted
+                prefetch_stats_type mv_prefetch_stats;
+                // for framestream() and frame()
+                util::colorspace::converter mv_converter;
+                framecache mv_cache;
+                access_type mv_access;
+                uint32_t mv_stride;
+                // for renderers to open the script by themselves
+                const std::string mv_filepath;
+                renderers_type renderers;
+                // created when a frame is requested first
+                std::auto_ptr<framerequester> mv_requester;
+                requests_type requests;
 
             public:
                 // constructor
                 explicit cvideo_type(   PClip clip, IScriptEnvironment* se,
-                                        const info_type& info)
+                                        util::thread::mutex& se_lock,
+                                        const info_type& info,
+                                        const std::string& filepath)
                 : mv_clip(clip), mv_rgb_clip(clip),
-                  mv_se(se), mv_info(info) {
+                  mv_se(se), mv_se_lock(se_lock), mv_info(info),
+                  framestreams(initial_buckets,
+                               framestreams_type::hasher(),
+                               framestreams_type::key_equal(),
+                               framestreams_type::allocator_type(mv_arena)),
+                  framenumbers(initial_buckets,
+                               framenumbers_type::hasher(),
+                               framenumbers_type::key_equal(),
+                               framenumbers_type::allocator_type(mv_arena)),
+                  mv_prefetch_window(0),
+                  mv_converter(util::colorspace::BT601,
+                               util::colorspace::TV_RANGE),
+                  mv_cache(mv_arena),
+                  mv_access(ADAPTIVE), mv_stride(1),
+                  mv_filepath(filepath) {
+                    mv_prefetch_stats.hits = 0;
+                    mv_prefetch_stats.misses = 0;
+                    mv_prefetch_stats.wasted = 0;
                     DBGLOG( "avsutil::impl::cvideo_type::"
                             "cvideo_type(Pclip, IScriptEnvironment*,"
-                            " const info_type&)\n"
+                            " util::thread::mutex&, const info_type&, "
+                            << filepath << ")\n"
                             "exists: " << mv_info.exists << "\n"
                             "width: " << mv_info.width << "\n"
                             "height: " << mv_info.height << "\n"
@@ -59,16 +149,36 @@ namespace avsutil {
                                 << "\n"
                             "bpp: " << mv_info.bpp << "\n"
                             "is_fieldbased: " << mv_info.is_fieldbased << "\n"
-                            "is_tff: " << mv_info.is_tff << "\n");
+                            "is_tff: " << mv_info.is_tff << "\n"
+                            "planes: " << mv_info.planes << "\n");
                 }
 
             public:
                 // destructor
                 ~cvideo_type(void) {
                     DBGLOG("avsutil::impl::cvideo_type::~cvideo_type(void)");
-                    std::for_each(
-                            framestreams.rbegin(), framestreams.rend(),
-                            util::algorithm::sweeper());
+                    // Stop the background thread before frames are released.
+                    mv_prefetcher.reset();
+                    for (requests_type::iterator itr = requests.begin();
+                            itr != requests.end(); ++itr) {
+                        delete *itr;
+                    }
+                    mv_requester.reset();
+                    for (renderers_type::iterator itr = renderers.begin();
+                            itr != renderers.end(); ++itr) {
+                        delete *itr;
+                    }
+                    for (framestreams_type::iterator itr =
+                            framestreams.begin();
+                            itr != framestreams.end(); ++itr) {
+                        delete itr->second.stream;
+                        itr->second.frame->release();
+                    }
+                    for (std::vector<iframestream*>::iterator itr =
+                            idle_streams.begin();
+                            itr != idle_streams.end(); ++itr) {
+                        delete *itr;
+                    }
                 }
 
             public:
@@ -99,44 +209,371 @@ namespace avsutil {
                     DBGLOG( "avsutil::impl::cvideo_type::"
                             "framestream(" << n << ")");
 
-                    if (!mv_rgb_clip->GetVideoInfo().IsRGB24()) {
-                        DBGLOG("convert to RGB24");
-                        AVSValue clip = mv_rgb_clip;
-                        AVSValue args = AVSValue(&clip, 1);
-                        AVSValue converted =
-                            mv_se->Invoke("ConvertToRGB24", args);
-                        mv_rgb_clip = converted.AsClip();
-                    }
-
-                    framestreams_type::iterator found =
-                        std::find_if(
-                                framestreams.begin(), framestreams.end(),
-                                std::bind2nd(std::mem_fun(
-                                        &avsutil::impl::iframestream::is_me
-                                        ), n));
+                    framestreams_type::iterator found = framestreams.find(n);
 
                     // found
-                    if (found != framestreams.end()) return **found;
+                    if (found != framestreams.end()) {
+                        ++found->second.count;
+                        return *found->second.stream;
+                    }
 
-                    // not found and create
-                    PVideoFrame frame = mv_rgb_clip->GetFrame(n, mv_se);
-                    iframestream* created = new iframestream(frame, n);
-                    framestreams.push_back(created);
-                    return *created;
+                    // not found and reuse or create
+                    cframe_type* frame = cached_frame(n, RGB24);
+                    std::auto_ptr<iframestream> stream;
+                    try {
+                        if (idle_streams.empty()) {
+                            stream.reset(new(mv_arena) iframestream(
+                                        frame->avs_frame(), mv_arena));
+                        }
+                        else {
+                            stream.reset(idle_streams.back());
+                            idle_streams.pop_back();
+                            stream->reset(frame->avs_frame());
+                        }
+                        framenumbers[stream.get()] = n;
+                    }
+                    catch (...) {
+                        frame->release();
+                        throw;
+                    }
+                    framestream_entry_type& entry = framestreams[n];
+                    entry.count = 1;
+                    entry.frame = frame;
+                    entry.stream = stream.release();
+                    return *entry.stream;
                 }
 
                 void release_framestream(std::istream& target) {
                     DBGLOG( "avsutil::impl::cvideo_type::"
                             "release_framestream(std::istream&)");
 
-                    framestreams_type::iterator found =
-                        std::find(
-                                framestreams.begin(), framestreams.end(),
-                                &target);
+                    framenumbers_type::iterator number =
+                        framenumbers.find(&target);
+                    if (number == framenumbers.end()) return;
 
-                    if (found != framestreams.end()) {
-                        delete *found;
+                    framestreams_type::iterator found =
+                        framestreams.find(number->second);
+                    if (--found->second.count == 0) {
+                        iframestream* const stream = found->second.stream;
+                        found->second.frame->release();
                         framestreams.erase(found);
+                        framenumbers.erase(number);
+
+                        // Keep the stream for the next frame.
+                        stream->reset(PVideoFrame());
+                        idle_streams.push_back(stream);
+                    }
+                }
+
+                frame_view frame(uint32_t n, format_type format) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "frame(" << n << ", " << format << ")");
+
+                    return frame_view(cached_frame(n, format));
+                }
+
+                bool read_rgb(  uint32_t n, uint8_t* dst, uint32_t pitch,
+                                format_type format,
+                                matrix_type matrix, range_type range) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "read_rgb(" << n << ", uint8_t*, " << pitch
+                            << ", " << format << ", " << matrix << ", "
+                            << range << ")");
+
+                    if (!is_convertible()) return false;
+
+                    util::colorspace::converter converter(
+                            matrix == BT709
+                                ? util::colorspace::BT709
+                                : util::colorspace::BT601,
+                            range == PC_RANGE
+                                ? util::colorspace::PC_RANGE
+                                : util::colorspace::TV_RANGE);
+                    convert(get_frame(mv_clip, n), dst, pitch, format,
+                            converter);
+                    return true;
+                }
+
+                void prefetch(uint32_t window) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "prefetch(" << window << ")");
+
+                    mv_prefetch_window = window;
+                    reset_prefetcher();
+                }
+
+                prefetch_stats_type prefetch_stats(void) const {
+                    prefetch_stats_type stats = mv_prefetch_stats;
+                    if (mv_prefetcher.get() != NULL) {
+                        const prefetch_stats_type current =
+                            mv_prefetcher->statistics();
+                        stats.hits += current.hits;
+                        stats.misses += current.misses;
+                        stats.wasted += current.wasted;
+                    }
+                    return stats;
+                }
+
+                renderer_type& renderer(uint32_t first, uint32_t last,
+                                        format_type format,
+                                        uint32_t numof_workers,
+                                        uint32_t buffer_size) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "renderer(" << first << ", " << last << ", "
+                            << format << ", " << numof_workers << ", "
+                            << buffer_size << ")");
+
+                    if (last > mv_info.numof_frames) {
+                        last = mv_info.numof_frames;
+                    }
+                    if (first > last) first = last;
+                    if (numof_workers == 0) {
+                        numof_workers = util::thread::numof_processors();
+                    }
+
+                    std::auto_ptr<framerenderer> created(new framerenderer(
+                                mv_filepath, first, last, format,
+                                numof_workers, buffer_size));
+                    renderers.push_back(created.get());
+                    return *created.release();
+                }
+
+                void release_renderer(renderer_type& target) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "release_renderer(renderer_type&)");
+
+                    renderers_type::iterator found = std::find(
+                            renderers.begin(), renderers.end(), &target);
+                    if (found == renderers.end()) return;
+
+                    delete *found;
+                    renderers.erase(found);
+                }
+
+                request_type& request_frame(uint32_t n, format_type format) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "request_frame(" << n << ", " << format << ")");
+
+                    if (mv_requester.get() == NULL) {
+                        mv_requester.reset(new framerequester(
+                                    mv_se, mv_se_lock, mv_arena));
+                    }
+
+                    const framecache::key_type key = {
+                        mv_clip.operator->(), n, format
+                    };
+                    crequest_type* created;
+                    cframe_type* cached = mv_cache.find(key);
+                    if (cached != NULL) {
+                        created = mv_requester->ready(cached);
+                    }
+                    else {
+                        const PClip& clip =
+                            (format == NATIVE || is_convertible())
+                            ? mv_clip
+                            : rgb_clip(format);
+                        const bool is_kept =
+                            mv_access == ADAPTIVE || mv_access == RANDOM;
+                        created = mv_requester->request(
+                                clip, n, format,
+                                is_kept ? &mv_cache : NULL, key);
+                    }
+                    requests.push_back(created);
+                    return *created;
+                }
+
+                void release_request(request_type& target) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "release_request(request_type&)");
+
+                    requests_type::iterator found = std::find(
+                            requests.begin(), requests.end(), &target);
+                    if (found == requests.end()) return;
+
+                    delete *found;
+                    requests.erase(found);
+                }
+
+                void cache_budget(uint64_t bytes) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "cache_budget(" << bytes << ")");
+                    mv_cache.budget(bytes);
+                }
+
+                cache_stats_type cache_stats(void) const {
+                    return mv_cache.statistics();
+                }
+
+                pool_stats_type pool_stats(void) const {
+                    const pool_stats_type stats = {
+                        mv_arena.allocations(), mv_arena.reuses()
+                    };
+                    return stats;
+                }
+
+                void access_hint(access_type access, uint32_t stride) {
+                    DBGLOG( "avsutil::impl::cvideo_type::"
+                            "access_hint(" << access << ", " << stride
+                            << ")");
+
+                    mv_access = access;
+                    mv_stride = (stride == 0) ? 1 : stride;
+                    set_cache_hints(mv_clip);
+                    if (mv_rgb_clip != mv_clip) set_cache_hints(mv_rgb_clip);
+                    reset_prefetcher();
+                }
+
+            private:
+                // Returns a nth frame in "format" with a reference for the
+                // caller, from the cache if possible.
+                cframe_type* cached_frame(uint32_t n, format_type format) {
+                    const framecache::key_type key = {
+                        mv_clip.operator->(), n, format
+                    };
+                    cframe_type* frame = mv_cache.find(key);
+                    if (frame != NULL) return frame;
+
+                    const PVideoFrame rendered = (format == NATIVE)
+                        ? get_frame(mv_clip, n)
+                        : rgb_frame(n, format);
+                    frame = new(mv_arena) cframe_type(rendered);
+                    // Frames read only once are not worth keeping.
+                    if (mv_access == ADAPTIVE || mv_access == RANDOM) {
+                        mv_cache.insert(key, frame);
+                    }
+                    return frame;
+                }
+
+                // Gives the cache hints of AviSynth for "mv_access" to
+                // "clip".
+                void set_cache_hints(const PClip& clip) {
+                    int hints;
+                    int range = 0;
+                    switch (mv_access) {
+                        case SEQUENTIAL:
+                        case REVERSE:
+                            // for filters that refer adjacent frames
+                            hints = CACHE_RANGE;
+                            range = 2;
+                            break;
+                        case STRIDED:
+                            hints = CACHE_NOTHING;
+                            break;
+                        case RANDOM:
+                        case ADAPTIVE:
+                        default:
+                            hints = CACHE_ALL;
+                            break;
+                    }
+
+                    util::thread::scoped_lock lock(mv_se_lock);
+                    clip->SetCacheHints(hints, range);
+                }
+
+                // Returns true if the clip can be converted to RGB in this
+                // library.
+                bool is_convertible(void) const {
+                    return impl::is_convertible(mv_clip->GetVideoInfo());
+                }
+
+                // Returns a nth frame converted to RGB24 or RGB32.
+                PVideoFrame rgb_frame(uint32_t n, format_type format) {
+                    const VideoInfo& vi = mv_clip->GetVideoInfo();
+                    const int pixel_type = (format == RGB32)
+                        ? VideoInfo::CS_BGR32
+                        : VideoInfo::CS_BGR24;
+
+                    if (vi.pixel_type == pixel_type) {
+                        return get_frame(mv_clip, n);
+                    }
+                    if (!is_convertible()) {
+                        return get_frame(rgb_clip(format), n);
+                    }
+
+                    const PVideoFrame src = get_frame(mv_clip, n);
+                    VideoInfo rgb_vi = vi;
+                    rgb_vi.pixel_type = pixel_type;
+                    PVideoFrame dst;
+                    {
+                        util::thread::scoped_lock lock(mv_se_lock);
+                        dst = mv_se->NewVideoFrame(rgb_vi);
+                    }
+                    convert(src, dst->GetWritePtr(), dst->GetPitch(), format,
+                            mv_converter);
+                    return dst;
+                }
+
+                // Writes "src" of the clip to "dst" as RGB24 or RGB32.
+                void convert(   const PVideoFrame& src,
+                                uint8_t* dst, uint32_t pitch,
+                                format_type format,
+                                util::colorspace::converter& converter) {
+                    write_rgb(mv_clip->GetVideoInfo(), src, dst, pitch,
+                              (format == RGB32) ? 4 : 3, converter);
+                }
+
+                // Returns the clip converted to RGB24 or RGB32 by AviSynth,
+                // for color spaces that this library doesn't know.
+                const PClip& rgb_clip(format_type format) {
+                    const char* filter = (format == RGB32)
+                        ? "ConvertToRGB32"
+                        : "ConvertToRGB24";
+                    const VideoInfo& vi = mv_rgb_clip->GetVideoInfo();
+                    if ((format == RGB32) ? !vi.IsRGB32() : !vi.IsRGB24()) {
+                        DBGLOG(filter);
+                        {
+                            util::thread::scoped_lock lock(mv_se_lock);
+                            scoped_timer t(metrics_type::CONVERT_TO_RGB);
+                            AVSValue clip = mv_clip;
+                            AVSValue args = AVSValue(&clip, 1);
+                            AVSValue converted = mv_se->Invoke(filter, args);
+                            mv_rgb_clip = converted.AsClip();
+                        }
+                        if (mv_access != ADAPTIVE) {
+                            set_cache_hints(mv_rgb_clip);
+                        }
+                    }
+                    return mv_rgb_clip;
+                }
+
+                // Returns a nth frame of "clip", through the prefetcher if
+                // enabled.
+                PVideoFrame get_frame(const PClip& clip, uint32_t n) {
+                    if (mv_prefetch_window > 0 && mv_access != RANDOM) {
+                        if (       mv_prefetcher.get() == NULL
+                                || !mv_prefetcher->is_for(clip)) {
+                            reset_prefetcher(clip);
+                        }
+                        return mv_prefetcher->get(n);
+                    }
+
+                    util::thread::scoped_lock lock(mv_se_lock);
+                    scoped_timer t(metrics_type::GET_FRAME);
+                    return clip->GetFrame(n, mv_se);
+                }
+
+                // Deletes the current prefetcher and creates new one for
+                // "clip" if specified.
+                void reset_prefetcher(const PClip& clip = PClip()) {
+                    if (mv_prefetcher.get() != NULL) {
+                        mv_prefetcher->discard();
+                        const prefetch_stats_type stats =
+                            mv_prefetcher->statistics();
+                        mv_prefetch_stats.hits += stats.hits;
+                        mv_prefetch_stats.misses += stats.misses;
+                        mv_prefetch_stats.wasted += stats.wasted;
+                        mv_prefetcher.reset();
+                    }
+
+                    if (clip && mv_prefetch_window > 0) {
+                        const int32_t stride =
+                              (mv_access == REVERSE) ? -1
+                            : (mv_access == STRIDED)
+                                ? static_cast<int32_t>(mv_stride)
+                            : 1;
+                        mv_prefetcher.reset(new frameprefetcher(
+                                    clip, mv_se, mv_se_lock,
+                                    mv_prefetch_window, stride));
                     }
                 }
 
@@ -154,6 +591,16 @@ namespace avsutil {
                         default:                    return info_type::UNKOWN;
                     }
                 }
+
+                static const uint16_t planes(const int pixel_type) {
+                    switch (pixel_type) {
+                        case VideoInfo::CS_YV12:
+                        case VideoInfo::CS_I420:
+                            return Y_PLANE | U_PLANE | V_PLANE;
+                        default:
+                            return 0;
+                    }
+                }
         };
     }
 }
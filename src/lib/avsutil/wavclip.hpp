@@ -0,0 +1,215 @@
+/*
+ * wavclip.hpp
+ *  Declarations and definitions for a class wavclip
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef WAVCLIP_HPP
+#define WAVCLIP_HPP
+
+#include "avisynth.h"
+
+#include <cstring>
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/mmap.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A clip of a RIFF WAV file that is mapped into memory.  Linear PCM
+         *  of 8, 16, 24 and 32 bit and IEEE float of 32 bit are supported,
+         *  also in WAVE_FORMAT_EXTENSIBLE.  The clip has no video, and
+         *  GetAudio() copies samples from the mapping.
+         * */
+        class wavclip : public IClip {
+            private:
+                // constants
+                static const uint16_t format_pcm = 0x0001;
+                static const uint16_t format_float = 0x0003;
+                static const uint16_t format_extensible = 0xFFFE;
+
+                util::io::mapped_file mv_file;
+                VideoInfo mv_vi;
+                const BYTE* mv_samples;
+                unsigned int mv_block_size;
+
+            public:
+                // constructor
+                // Throws AvisynthError by "se" if "filepath" is bad.
+                wavclip(const char* filepath, IScriptEnvironment* se)
+                    : mv_samples(NULL), mv_block_size(0) {
+                    DBGLOG( "avsutil::impl::wavclip::wavclip("
+                            << filepath << ", IScriptEnvironment*)");
+
+                    std::memset(&mv_vi, 0, sizeof(mv_vi));
+                    if (!mv_file.open(filepath)) {
+                        se->ThrowError("WAV: can't open \"%s\"", filepath);
+                    }
+                    const BYTE* const data = mv_file.data();
+                    const std::size_t size = mv_file.size();
+                    if (       size < 12
+                            || std::memcmp(data, "RIFF", 4) != 0
+                            || std::memcmp(data + 8, "WAVE", 4) != 0) {
+                        se->ThrowError(
+                                "WAV: not a RIFF WAV file \"%s\"", filepath);
+                    }
+
+                    // Chunks are aligned to 2 bytes.  The size of "data"
+                    // may be wrong when it was written to a pipe, so it is
+                    // cut at the end of the file.
+                    const BYTE* fmt = NULL;
+                    std::size_t fmt_size = 0;
+                    std::size_t samples_size = 0;
+                    std::size_t position = 12;
+                    while (       position + 8 <= size
+                            && (fmt == NULL || mv_samples == NULL)) {
+                        const BYTE* const chunk = data + position;
+                        const std::size_t rest = size - position - 8;
+                        std::size_t chunk_size = le32(chunk + 4);
+                        if (chunk_size > rest) chunk_size = rest;
+
+                        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+                            fmt = chunk + 8;
+                            fmt_size = chunk_size;
+                        }
+                        else if (std::memcmp(chunk, "data", 4) == 0) {
+                            mv_samples = chunk + 8;
+                            samples_size = chunk_size;
+                        }
+                        position += 8 + chunk_size + (chunk_size & 1);
+                    }
+                    if (fmt == NULL || fmt_size < 16 || mv_samples == NULL) {
+                        se->ThrowError(
+                                "WAV: no \"fmt \" or \"data\" chunk "
+                                "in \"%s\"", filepath);
+                    }
+                    if (!read_format(fmt, fmt_size)) {
+                        se->ThrowError(
+                                "WAV: unsupported format in \"%s\"",
+                                filepath);
+                    }
+
+                    mv_vi.num_audio_samples = samples_size / mv_block_size;
+                }
+
+            private:
+                // copy constructor
+                wavclip(const wavclip& rhs);
+                // assignment operator
+                wavclip& operator=(const wavclip& rhs);
+
+            public:
+                /*
+                 *  Implementations for the member functions of a super class
+                 *  IClip.
+                 * */
+                // There is no video.
+                PVideoFrame __stdcall GetFrame(int, IScriptEnvironment*) {
+                    return PVideoFrame();
+                }
+
+                bool __stdcall GetParity(int) { return false; }
+
+                // Samples out of the range are silent.
+                void __stdcall GetAudio(
+                        void* buf, int64_t start, int64_t count,
+                        IScriptEnvironment*) {
+                    BYTE* dst = static_cast<BYTE*>(buf);
+                    const int silence =
+                        (mv_vi.sample_type == SAMPLE_INT8) ? 0x80 : 0;
+
+                    if (start < 0) {
+                        const int64_t n = (-start < count) ? -start : count;
+                        std::memset(dst, silence,
+                                static_cast<std::size_t>(n) * mv_block_size);
+                        dst += n * mv_block_size;
+                        start += n;
+                        count -= n;
+                    }
+
+                    const int64_t rest = (start < mv_vi.num_audio_samples)
+                        ? mv_vi.num_audio_samples - start
+                        : 0;
+                    const int64_t n = (rest < count) ? rest : count;
+                    if (n > 0) {
+                        std::memcpy(dst, mv_samples + start * mv_block_size,
+                                static_cast<std::size_t>(n) * mv_block_size);
+                    }
+                    std::memset(dst + n * mv_block_size, silence,
+                            static_cast<std::size_t>(count - n)
+                            * mv_block_size);
+                }
+
+                const VideoInfo& __stdcall GetVideoInfo(void) {
+                    return mv_vi;
+                }
+
+                void __stdcall SetCacheHints(int, int) {}
+
+            private:
+                // Reads "fmt " chunk.  Returns false if it isn't supported.
+                bool read_format(const BYTE* fmt, std::size_t size) {
+                    uint16_t format = le16(fmt);
+                    const uint16_t channels = le16(fmt + 2);
+                    const uint32_t sampling_rate = le32(fmt + 4);
+                    const uint16_t block_size = le16(fmt + 12);
+                    const uint16_t bit_depth = le16(fmt + 14);
+
+                    // The sub format begins with the format code.
+                    if (format == format_extensible) {
+                        if (size < 40) return false;
+                        format = le16(fmt + 24);
+                    }
+
+                    if (       channels == 0 || sampling_rate == 0
+                            || block_size != channels * (bit_depth / 8)) {
+                        return false;
+                    }
+
+                    if (format == format_pcm) {
+                        switch (bit_depth) {
+                            case 8:     mv_vi.sample_type = SAMPLE_INT8;
+                                        break;
+                            case 16:    mv_vi.sample_type = SAMPLE_INT16;
+                                        break;
+                            case 24:    mv_vi.sample_type = SAMPLE_INT24;
+                                        break;
+                            case 32:    mv_vi.sample_type = SAMPLE_INT32;
+                                        break;
+                            default:    return false;
+                        }
+                    }
+                    else if (format == format_float && bit_depth == 32) {
+                        mv_vi.sample_type = SAMPLE_FLOAT;
+                    }
+                    else {
+                        return false;
+                    }
+
+                    mv_vi.nchannels = channels;
+                    mv_vi.audio_samples_per_second = sampling_rate;
+                    mv_block_size = block_size;
+                    // Only to avoid a division by zero for the time of the
+                    // video.
+                    mv_vi.SetFPS(1, 1);
+                    return true;
+                }
+
+                // Values in RIFF are little endian.
+                static uint16_t le16(const BYTE* p) {
+                    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+                }
+                static uint32_t le32(const BYTE* p) {
+                    return      static_cast<uint32_t>(p[0])
+                            | (static_cast<uint32_t>(p[1]) << 8)
+                            | (static_cast<uint32_t>(p[2]) << 16)
+                            | (static_cast<uint32_t>(p[3]) << 24);
+                }
+        };
+    }
+}
+
+#endif // WAVCLIP_HPP
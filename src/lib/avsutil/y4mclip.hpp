@@ -0,0 +1,296 @@
+/*
+ * y4mclip.hpp
+ *  Declarations and definitions for a class y4mclip
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef Y4MCLIP_HPP
+#define Y4MCLIP_HPP
+
+#include "avisynth.h"
+
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../helper/dlogger.hpp"
+#include "../../helper/mmap.hpp"
+
+namespace avsutil {
+    namespace impl {
+        /*
+         *  A clip of a YUV4MPEG2 file that is mapped into memory.  4:2:0 of
+         *  8 bits is represented as YV12 and 4:2:2 as YUY2, and the others,
+         *  e.g. "C420p10", are not supported since AviSynth 2.5 doesn't
+         *  have them.  A frame is
+         *  copied from the mapping into a frame of IScriptEnvironment when it
+         *  is requested, and nothing else is read.  Sizes in the header are
+         *  untrusted, so frames larger than the file or than INT_MAX bytes,
+         *  that AviSynth can't address, are rejected.
+         * */
+        class y4mclip : public IClip {
+            private:
+                util::io::mapped_file mv_file;
+                VideoInfo mv_vi;
+                // offsets of the data of each frame
+                std::vector<std::size_t> mv_offsets;
+                std::size_t mv_frame_size;
+                bool mv_is_tff;
+
+            public:
+                // constructor
+                // Throws AvisynthError by "se" if "filepath" is bad.
+                y4mclip(const char* filepath, IScriptEnvironment* se)
+                    : mv_frame_size(0), mv_is_tff(false) {
+                    DBGLOG( "avsutil::impl::y4mclip::y4mclip("
+                            << filepath << ", IScriptEnvironment*)");
+
+                    std::memset(&mv_vi, 0, sizeof(mv_vi));
+                    if (!mv_file.open(filepath)) {
+                        se->ThrowError("Y4M: can't open \"%s\"", filepath);
+                    }
+                    const char* const data =
+                        reinterpret_cast<const char*>(mv_file.data());
+                    const std::size_t size = mv_file.size();
+
+                    // the stream header
+                    static const char signature[] = "YUV4MPEG2 ";
+                    const std::size_t signature_size = sizeof(signature) - 1;
+                    const char* eol = (data == NULL)
+                        ? NULL
+                        : static_cast<const char*>(
+                                std::memchr(data, '\n', size));
+                    if (       eol == NULL
+                            || static_cast<std::size_t>(eol - data)
+                                < signature_size
+                            || std::memcmp(data, signature, signature_size)
+                                != 0) {
+                        se->ThrowError(
+                                "Y4M: not a YUV4MPEG2 file \"%s\"", filepath);
+                    }
+                    if (!read_header(
+                                std::string(data + signature_size, eol))) {
+                        se->ThrowError(
+                                "Y4M: unsupported or bad stream header "
+                                "in \"%s\"", filepath);
+                    }
+                    if (mv_frame_size > size) {
+                        se->ThrowError(
+                                "Y4M: a frame is larger than the file "
+                                "\"%s\"", filepath);
+                    }
+
+                    // Frames have their own headers that may have
+                    // parameters.  A broken frame at the end is ignored.
+                    static const char frame[] = "FRAME";
+                    const std::size_t frame_tag_size = sizeof(frame) - 1;
+                    std::size_t position = eol - data + 1;
+                    while (       position + frame_tag_size <= size
+                               && std::memcmp(
+                                   data + position, frame, frame_tag_size)
+                                   == 0) {
+                        const char* const frame_eol =
+                            static_cast<const char*>(std::memchr(
+                                        data + position, '\n',
+                                        size - position));
+                        if (frame_eol == NULL) break;
+                        const std::size_t offset = frame_eol - data + 1;
+                        if (size - offset < mv_frame_size) break;
+
+                        mv_offsets.push_back(offset);
+                        position = offset + mv_frame_size;
+                    }
+                    if (mv_offsets.empty()) {
+                        se->ThrowError("Y4M: no frames in \"%s\"", filepath);
+                    }
+                    mv_vi.num_frames = static_cast<int>(mv_offsets.size());
+                }
+
+            private:
+                // copy constructor
+                y4mclip(const y4mclip& rhs);
+                // assignment operator
+                y4mclip& operator=(const y4mclip& rhs);
+
+            public:
+                /*
+                 *  Implementations for the member functions of a super class
+                 *  IClip.
+                 * */
+                PVideoFrame __stdcall
+                GetFrame(int n, IScriptEnvironment* env) {
+                    if (n < 0) n = 0;
+                    if (n >= mv_vi.num_frames) n = mv_vi.num_frames - 1;
+
+                    const BYTE* src = mv_file.data() + mv_offsets[n];
+                    const int width = mv_vi.width;
+                    const int height = mv_vi.height;
+                    // within mv_frame_size, so they fit in int as well
+                    const std::size_t luma_size =
+                        static_cast<std::size_t>(width) * height;
+                    PVideoFrame dst = env->NewVideoFrame(mv_vi);
+                    if (mv_vi.IsYV12()) {
+                        // Y, U and V planes in this order
+                        const std::size_t plane_size = luma_size / 4;
+                        env->BitBlt(
+                                dst->GetWritePtr(PLANAR_Y),
+                                dst->GetPitch(PLANAR_Y),
+                                src, width, width, height);
+                        env->BitBlt(
+                                dst->GetWritePtr(PLANAR_U),
+                                dst->GetPitch(PLANAR_U),
+                                src + luma_size,
+                                width / 2, width / 2, height / 2);
+                        env->BitBlt(
+                                dst->GetWritePtr(PLANAR_V),
+                                dst->GetPitch(PLANAR_V),
+                                src + luma_size + plane_size,
+                                width / 2, width / 2, height / 2);
+                        return dst;
+                    }
+
+                    // Planes of 4:2:2 are interleaved as Y0 U Y1 V.
+                    const BYTE* y = src;
+                    const BYTE* u = src + luma_size;
+                    const BYTE* v = u + luma_size / 2;
+                    BYTE* line = dst->GetWritePtr();
+                    const int pitch = dst->GetPitch();
+                    for (int row = 0; row < height; ++row) {
+                        BYTE* p = line;
+                        for (int x = 0; x < width / 2; ++x) {
+                            *p++ = y[x * 2];
+                            *p++ = u[x];
+                            *p++ = y[x * 2 + 1];
+                            *p++ = v[x];
+                        }
+                        y += width;
+                        u += width / 2;
+                        v += width / 2;
+                        line += pitch;
+                    }
+                    return dst;
+                }
+
+                bool __stdcall GetParity(int) { return mv_is_tff; }
+
+                // There is no audio.
+                void __stdcall GetAudio(
+                        void*, int64_t, int64_t, IScriptEnvironment*) {}
+
+                const VideoInfo& __stdcall GetVideoInfo(void) {
+                    return mv_vi;
+                }
+
+                void __stdcall SetCacheHints(int, int) {}
+
+            private:
+                /*
+                 *  Reads the parameters of the stream header, for example
+                 *  "W640 H480 F30000:1001 Ip A1:1 C420jpeg".  Returns false
+                 *  if those are not supported.
+                 * */
+                bool read_header(const std::string& header) {
+                    std::string colorspace = "420jpeg";
+                    int fps_numerator = 0;
+                    int fps_denominator = 0;
+                    std::string::size_type first = 0;
+                    while (first < header.size()) {
+                        std::string::size_type last =
+                            header.find(' ', first);
+                        if (last == std::string::npos) last = header.size();
+                        const std::string token =
+                            header.substr(first, last - first);
+                        first = last + 1;
+                        if (token.empty()) continue;
+
+                        const char* const value = token.c_str() + 1;
+                        switch (token[0]) {
+                            case 'W':
+                                if (!read_size(value, mv_vi.width)) {
+                                    return false;
+                                }
+                                break;
+                            case 'H':
+                                if (!read_size(value, mv_vi.height)) {
+                                    return false;
+                                }
+                                break;
+                            case 'F': {
+                                const char* colon = std::strchr(value, ':');
+                                if (colon == NULL) return false;
+                                fps_numerator = std::atoi(value);
+                                fps_denominator = std::atoi(colon + 1);
+                                break;
+                            }
+                            case 'I':
+                                mv_is_tff = (*value == 't');
+                                if (*value == 't') {
+                                    mv_vi.Set(VideoInfo::IT_TFF);
+                                }
+                                else if (*value == 'b') {
+                                    mv_vi.Set(VideoInfo::IT_BFF);
+                                }
+                                break;
+                            case 'C':
+                                colorspace = value;
+                                break;
+                            default:
+                                // aspect ratio and extensions
+                                break;
+                        }
+                    }
+
+                    if (       mv_vi.width <= 0 || mv_vi.height <= 0
+                            || fps_numerator <= 0 || fps_denominator <= 0) {
+                        return false;
+                    }
+                    mv_vi.SetFPS(fps_numerator, fps_denominator);
+
+                    // Chroma planes of AviSynth need even sizes.
+                    const uint64_t luma_size =
+                        static_cast<uint64_t>(mv_vi.width) * mv_vi.height;
+                    uint64_t frame_size;
+                    // 8-bit 4:2:0 with any siting, and not "420p10" etc.
+                    if (       colorspace == "420"
+                            || colorspace == "420jpeg"
+                            || colorspace == "420paldv"
+                            || colorspace == "420mpeg2") {
+                        if (mv_vi.width % 2 != 0 || mv_vi.height % 2 != 0) {
+                            return false;
+                        }
+                        mv_vi.pixel_type = VideoInfo::CS_YV12;
+                        frame_size = luma_size / 2 * 3;
+                    }
+                    else if (colorspace == "422") {
+                        if (mv_vi.width % 2 != 0) return false;
+                        mv_vi.pixel_type = VideoInfo::CS_YUY2;
+                        frame_size = luma_size * 2;
+                    }
+                    else {
+                        return false;
+                    }
+
+                    if (frame_size > INT_MAX) return false;
+                    mv_frame_size = static_cast<std::size_t>(frame_size);
+                    return true;
+                }
+
+                // Reads a positive size that fits in int into "size".
+                static bool read_size(const char* value, int& size) {
+                    char* end;
+                    const long parsed = std::strtol(value, &end, 10);
+                    if (end == value || parsed <= 0 || parsed > INT_MAX) {
+                        return false;
+                    }
+                    size = static_cast<int>(parsed);
+                    return true;
+                }
+        };
+    }
+}
+
+#endif // Y4MCLIP_HPP
@@ -0,0 +1,51 @@
+/*
+ * objbase.h
+ *  the part of Windows API that avisynth.h needs, for other systems
+ *
+ *  avisynth.h includes <objbase.h> of Windows SDK only for some types,
+ *  macros and the interlocked functions.  Add this directory to the include
+ *  path when the library is built with the stand-in (see standin.cpp) on
+ *  systems other than Windows.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef STANDIN_OBJBASE_H
+#define STANDIN_OBJBASE_H
+
+#ifdef _WIN32
+#   error "Use objbase.h of Windows SDK on Windows."
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One calling convention is used in the library and the stand-in.
+#define __stdcall
+#define __cdecl
+#define __declspec(x)
+
+typedef unsigned char BYTE;
+
+#ifndef FALSE
+#   define FALSE 0
+#endif
+#ifndef TRUE
+#   define TRUE 1
+#endif
+
+#define UInt32x32To64(a, b)                             \
+    (   static_cast<uint64_t>(static_cast<uint32_t>(a))     \
+      * static_cast<uint32_t>(b))
+#define Int64ShrlMod32(a, b) (static_cast<uint64_t>(a) >> (b))
+
+inline long InterlockedIncrement(long volatile* p) {
+    return __sync_add_and_fetch(p, 1);
+}
+
+inline long InterlockedDecrement(long volatile* p) {
+    return __sync_sub_and_fetch(p, 1);
+}
+
+#endif // STANDIN_OBJBASE_H
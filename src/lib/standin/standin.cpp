@@ -0,0 +1,503 @@
+/*
+ * standin.cpp
+ *  A stand-in for avisynth.dll that makes synthetic clips
+ *
+ *  This defines CreateScriptEnvironment() and the members of the classes in
+ *  avisynth.h that avisynth.dll has, so that the library and the
+ *  applications run without AviSynth, e.g. to measure them on Linux.
+ *  Import() makes a clip from BlankClip() and Tone() in a script (see
+ *  synthetic.hpp), and the other functions of AviSynth are not available.
+ *
+ *  Build the library with this file instead of linking avisynth.lib.  On
+ *  systems other than Windows, this directory has to be in the include path
+ *  for "objbase.h".  contrib/gcc/Makefile does so:
+ *
+ *      > make -C contrib/gcc
+ *      > contrib/gcc/build/avsinfo test/16bit_44100_stereo.avs
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "../avsutil/avisynth.h"
+
+#include "synthetic.hpp"
+
+#include <cctype>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../helper/thread.hpp"
+
+/*
+ *  Definitions for members of the classes in avisynth.h that avisynth.dll
+ *  has.  These work as those in AviSynth 2.5.
+ * */
+VideoFrameBuffer::VideoFrameBuffer(int size)
+    : data(new BYTE[size]), data_size(size),
+      sequence_number(0), refcount(0) {}
+
+VideoFrameBuffer::VideoFrameBuffer(void)
+    : data(NULL), data_size(0), sequence_number(0), refcount(0) {}
+
+VideoFrameBuffer::~VideoFrameBuffer(void) {
+    delete[] data;
+}
+
+VideoFrame::VideoFrame(
+        VideoFrameBuffer* _vfb,
+        int _offset, int _pitch, int _row_size, int _height)
+    : refcount(0), vfb(_vfb),
+      offset(_offset), pitch(_pitch), row_size(_row_size), height(_height),
+      offsetU(_offset), offsetV(_offset), pitchUV(0) {
+    InterlockedIncrement(&vfb->refcount);
+}
+
+VideoFrame::VideoFrame(
+        VideoFrameBuffer* _vfb,
+        int _offset, int _pitch, int _row_size, int _height,
+        int _offsetU, int _offsetV, int _pitchUV)
+    : refcount(0), vfb(_vfb),
+      offset(_offset), pitch(_pitch), row_size(_row_size), height(_height),
+      offsetU(_offsetU), offsetV(_offsetV), pitchUV(_pitchUV) {
+    InterlockedIncrement(&vfb->refcount);
+}
+
+// AviSynth recycles objects here, and ScriptEnvironment does instead.
+void* VideoFrame::operator new(size_t size) {
+    return ::operator new(size);
+}
+
+void VideoFrame::operator delete(void* p) {
+    ::operator delete(p);
+}
+
+VideoFrame* VideoFrame::Subframe(
+        int rel_offset, int new_pitch, int new_row_size, int new_height)
+    const {
+    return new VideoFrame(
+            vfb, offset + rel_offset, new_pitch, new_row_size, new_height);
+}
+
+VideoFrame* VideoFrame::Subframe(
+        int rel_offset, int new_pitch, int new_row_size, int new_height,
+        int rel_offsetU, int rel_offsetV, int new_pitchUV)
+    const {
+    return new VideoFrame(
+            vfb, offset + rel_offset, new_pitch, new_row_size, new_height,
+            offsetU + rel_offsetU, offsetV + rel_offsetV, new_pitchUV);
+}
+
+/*
+ *  The implementation of IScriptEnvironment.  The name is given as a friend
+ *  by VideoFrame and VideoFrameBuffer in avisynth.h.
+ *
+ *  VideoFrame objects are never deleted by PVideoFrame as in AviSynth, so
+ *  this keeps all of them and deletes those no longer referred to when a
+ *  new frame is made.  Buffers are reused, and the free buffers are deleted
+ *  while the total size exceeds the value of SetMemoryMax().
+ * */
+class ScriptEnvironment : public IScriptEnvironment {
+    private:
+        typedef std::list<VideoFrame*> frames_type;
+        typedef std::list<VideoFrameBuffer*> buffers_type;
+        typedef std::pair<ShutdownFunc, void*> shutdown_type;
+        typedef std::pair<ApplyFunc, void*> function_type;
+
+        // constants
+        // the default of SetMemoryMax() in megabytes
+        static const int default_memory_max = 64;
+
+    private:
+        // Frames are released by other threads.
+        util::thread::mutex lock;
+        frames_type frames;
+        buffers_type buffers;
+        uint64_t buffer_bytes;
+        int memory_max;
+
+        std::list<std::string> strings;
+        std::map<std::string, function_type> functions;
+        std::map<std::string, AVSValue> variables;
+        std::vector<shutdown_type> shutdowns;
+
+    public:
+        // constructor
+        ScriptEnvironment(void)
+            : buffer_bytes(0), memory_max(default_memory_max) {}
+
+        // destructor
+        ~ScriptEnvironment(void) {
+            for (std::vector<shutdown_type>::reverse_iterator itr =
+                        shutdowns.rbegin();
+                    itr != shutdowns.rend(); ++itr) {
+                itr->first(itr->second, this);
+            }
+            variables.clear();
+
+            // All frames must be released already as with AviSynth.
+            for (frames_type::iterator itr = frames.begin();
+                    itr != frames.end(); ++itr) {
+                delete_frame(*itr);
+            }
+            for (buffers_type::iterator itr = buffers.begin();
+                    itr != buffers.end(); ++itr) {
+                delete *itr;
+            }
+        }
+
+    private:
+        // copy constructor
+        ScriptEnvironment(const ScriptEnvironment& rhs);
+        // assignment operator
+        ScriptEnvironment& operator=(const ScriptEnvironment& rhs);
+
+    public:
+        long __stdcall GetCPUFlags(void) { return 0; }
+
+        char* __stdcall SaveString(const char* s, int length) {
+            util::thread::scoped_lock l(lock);
+            strings.push_back(
+                    (length < 0) ? std::string(s) : std::string(s, length));
+            strings.back().push_back('\0');
+            return &strings.back()[0];
+        }
+
+        char* __stdcall Sprintf(const char* fmt, ...) {
+            va_list args;
+            va_start(args, fmt);
+            char* result = format(fmt, args);
+            va_end(args);
+            return result;
+        }
+
+        // "val" can't be taken back to va_list on some systems, where it is
+        // not a pointer.  The library doesn't call this.
+        char* __stdcall VSprintf(const char* fmt, void*) {
+            return SaveString(fmt, -1);
+        }
+
+        void __stdcall ThrowError(const char* fmt, ...) {
+            va_list args;
+            va_start(args, fmt);
+            const char* message = format(fmt, args);
+            va_end(args);
+            throw AvisynthError(message);
+        }
+
+        void __stdcall AddFunction(
+                const char* name, const char*,
+                ApplyFunc apply, void* user_data) {
+            functions[lowercase(name)] = function_type(apply, user_data);
+        }
+
+        bool __stdcall FunctionExists(const char* name) {
+            const std::string key = lowercase(name);
+            return is_builtin(key) || functions.find(key) != functions.end();
+        }
+
+        AVSValue __stdcall Invoke(
+                const char* name, const AVSValue args, const char**) {
+            const std::string key = lowercase(name);
+            if (key == "import") {
+                return import(args.IsArray() ? args[0] : args);
+            }
+            if (key == "converttorgb24" || key == "converttorgb32") {
+                return to_rgb(
+                        args.IsArray() ? args[0] : args,
+                        (key == "converttorgb24")
+                            ? VideoInfo::CS_BGR24
+                            : VideoInfo::CS_BGR32);
+            }
+
+            std::map<std::string, function_type>::const_iterator found =
+                functions.find(key);
+            if (found == functions.end()) throw NotFound();
+            return found->second.first(args, found->second.second, this);
+        }
+
+        AVSValue __stdcall GetVar(const char* name) {
+            std::map<std::string, AVSValue>::const_iterator found =
+                variables.find(lowercase(name));
+            if (found == variables.end()) throw NotFound();
+            return found->second;
+        }
+
+        // Variables have no scope in this stand-in.
+        bool __stdcall SetVar(const char* name, const AVSValue& val) {
+            const std::string key = lowercase(name);
+            const bool is_new = (variables.find(key) == variables.end());
+            variables[key] = val;
+            return is_new;
+        }
+
+        bool __stdcall SetGlobalVar(const char* name, const AVSValue& val) {
+            return SetVar(name, val);
+        }
+
+        void __stdcall PushContext(int) {}
+        void __stdcall PopContext(void) {}
+
+        PVideoFrame __stdcall NewVideoFrame(const VideoInfo& vi, int align) {
+            if (align < FRAME_ALIGN) align = FRAME_ALIGN;
+
+            const int row_size = vi.RowSize();
+            const int height = vi.height;
+            util::thread::scoped_lock l(lock);
+            if (!vi.IsPlanar()) {
+                const int pitch = round_up(row_size, align);
+                VideoFrameBuffer* vfb = buffer(pitch * height + align);
+                const int base = alignment(vfb, align);
+                return track(
+                        new VideoFrame(vfb, base, pitch, row_size, height));
+            }
+
+            // Y, and V and U for YV12 or U and V for I420
+            const int pitch_uv = round_up(row_size / 2, align);
+            const int pitch = pitch_uv * 2;
+            const int y_size = pitch * height;
+            const int uv_size = pitch_uv * (height / 2);
+            VideoFrameBuffer* vfb = buffer(y_size + uv_size * 2 + align);
+            const int base = alignment(vfb, align);
+            const int first = base + y_size;
+            const int second = first + uv_size;
+            const bool is_v_first = vi.IsVPlaneFirst();
+            return track(new VideoFrame(
+                        vfb, base, pitch, row_size, height,
+                        is_v_first ? second : first,
+                        is_v_first ? first : second,
+                        pitch_uv));
+        }
+
+        bool __stdcall MakeWritable(PVideoFrame* pvf) {
+            const VideoFrame* src = pvf->operator->();
+            if (src->IsWritable()) return false;
+
+            util::thread::scoped_lock l(lock);
+            VideoFrameBuffer* vfb = buffer(src->vfb->data_size);
+            std::memcpy(vfb->data, src->vfb->data, src->vfb->data_size);
+            *pvf = track(new VideoFrame(
+                        vfb, src->offset, src->pitch,
+                        src->row_size, src->height,
+                        src->offsetU, src->offsetV, src->pitchUV));
+            return true;
+        }
+
+        void __stdcall BitBlt(
+                BYTE* dstp, int dst_pitch, const BYTE* srcp, int src_pitch,
+                int row_size, int height) {
+            for (int y = 0; y < height; ++y) {
+                std::memcpy(dstp, srcp, row_size);
+                dstp += dst_pitch;
+                srcp += src_pitch;
+            }
+        }
+
+        void __stdcall AtExit(ShutdownFunc function, void* user_data) {
+            shutdowns.push_back(shutdown_type(function, user_data));
+        }
+
+        void __stdcall CheckVersion(int version) {
+            if (version > AVISYNTH_INTERFACE_VERSION) {
+                ThrowError(
+                        "Plugin was designed for a later version of "
+                        "Avisynth (%d)", version);
+            }
+        }
+
+        PVideoFrame __stdcall Subframe(
+                PVideoFrame src,
+                int rel_offset, int new_pitch, int new_row_size,
+                int new_height) {
+            util::thread::scoped_lock l(lock);
+            return track(src->Subframe(
+                        rel_offset, new_pitch, new_row_size, new_height));
+        }
+
+        // The unit is megabyte.  0 only returns the current value.
+        int __stdcall SetMemoryMax(int mem) {
+            util::thread::scoped_lock l(lock);
+            if (mem > 0) memory_max = mem;
+            return memory_max;
+        }
+
+        int __stdcall SetWorkingDir(const char*) { return -1; }
+
+        void* __stdcall ManageCache(int, void*) { return NULL; }
+
+        bool __stdcall PlanarChromaAlignment(PlanarChromaAlignmentMode) {
+            return true;
+        }
+
+        PVideoFrame __stdcall SubframePlanar(
+                PVideoFrame src,
+                int rel_offset, int new_pitch, int new_row_size,
+                int new_height,
+                int rel_offsetU, int rel_offsetV, int new_pitchUV) {
+            util::thread::scoped_lock l(lock);
+            return track(src->Subframe(
+                        rel_offset, new_pitch, new_row_size, new_height,
+                        rel_offsetU, rel_offsetV, new_pitchUV));
+        }
+
+    private:
+        // Makes a synthetic clip from the script file "filename".
+        AVSValue import(const AVSValue& filename) {
+            const char* const path = filename.AsString();
+            std::ifstream in(path, std::ios::in | std::ios::binary);
+            if (!in.is_open()) {
+                ThrowError("Import: couldn't open \"%s\"", path);
+            }
+            const std::string text(
+                    (std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+
+            try {
+                standin::script_parser parser(text);
+                const standin::params_type params =
+                    standin::make_params(parser.parse());
+                standin::idle(params.import_cost);
+                return AVSValue(new standin::synthetic_clip(params));
+            }
+            catch (const std::runtime_error& ex) {
+                ThrowError("Import: %s in \"%s\"", ex.what(), path);
+            }
+            return AVSValue();
+        }
+
+        // Makes the same clip as "clip" in RGB.
+        AVSValue to_rgb(const AVSValue& clip, int pixel_type) {
+            const PClip src = clip.AsClip();
+            const standin::synthetic_clip* synthetic =
+                dynamic_cast<const standin::synthetic_clip*>(
+                        src.operator->());
+            if (synthetic == NULL) throw NotFound();
+
+            standin::params_type params = synthetic->parameters();
+            params.vi.pixel_type = pixel_type;
+            return AVSValue(new standin::synthetic_clip(params));
+        }
+
+        bool is_builtin(const std::string& key) const {
+            return     key == "import"
+                    || key == "converttorgb24"
+                    || key == "converttorgb32";
+        }
+
+        char* format(const char* fmt, va_list args) {
+            char buffer[4096];
+#ifdef _MSC_VER
+            _vsnprintf(buffer, sizeof(buffer) - 1, fmt, args);
+            buffer[sizeof(buffer) - 1] = '\0';
+#else
+            vsnprintf(buffer, sizeof(buffer), fmt, args);
+#endif
+            return SaveString(buffer, -1);
+        }
+
+        // Returns a free buffer of "size" bytes, deleting unused frames and
+        // buffers.  This and track() must be called with "lock" locked
+        // until the buffer is given to a frame.
+        VideoFrameBuffer* buffer(int size) {
+            collect();
+
+            VideoFrameBuffer* found = NULL;
+            for (buffers_type::iterator itr = buffers.begin();
+                    itr != buffers.end(); ++itr) {
+                if (is_unused((*itr)->refcount) && (*itr)->data_size == size) {
+                    found = *itr;
+                    buffers.erase(itr);
+                    break;
+                }
+            }
+            if (found == NULL) {
+                found = new VideoFrameBuffer(size);
+                buffer_bytes += size;
+            }
+
+            const uint64_t limit = static_cast<uint64_t>(memory_max) << 20;
+            for (buffers_type::iterator itr = buffers.begin();
+                    buffer_bytes > limit && itr != buffers.end();) {
+                if (is_unused((*itr)->refcount)) {
+                    buffer_bytes -= (*itr)->data_size;
+                    delete *itr;
+                    itr = buffers.erase(itr);
+                }
+                else {
+                    ++itr;
+                }
+            }
+
+            // The most recently used is the first.
+            buffers.push_front(found);
+            return found;
+        }
+
+        PVideoFrame track(VideoFrame* frame) {
+            frames.push_back(frame);
+            return frame;
+        }
+
+        // Deletes frames no longer referred to.
+        void collect(void) {
+            for (frames_type::iterator itr = frames.begin();
+                    itr != frames.end();) {
+                if (is_unused((*itr)->refcount)) {
+                    delete_frame(*itr);
+                    itr = frames.erase(itr);
+                }
+                else {
+                    ++itr;
+                }
+            }
+        }
+
+        // Frames are released by other threads without "lock", so the
+        // count is read atomically.
+        static bool is_unused(const long& refcount) {
+            return __atomic_load_n(&refcount, __ATOMIC_ACQUIRE) == 0;
+        }
+
+        static void delete_frame(VideoFrame* frame) {
+            // The buffer was released by the last PVideoFrame already, and
+            // the destructor releases it again.
+            if (frame->refcount == 0) {
+                InterlockedIncrement(&frame->vfb->refcount);
+            }
+            delete frame;
+        }
+
+        static int round_up(int n, int align) {
+            return (n + align - 1) / align * align;
+        }
+
+        // Returns the offset to align the data of "vfb".
+        static int alignment(const VideoFrameBuffer* vfb, int align) {
+            const std::size_t address =
+                reinterpret_cast<std::size_t>(vfb->GetReadPtr());
+            return static_cast<int>((align - address % align) % align);
+        }
+
+        static std::string lowercase(const char* name) {
+            std::string result(name);
+            for (std::string::iterator itr = result.begin();
+                    itr != result.end(); ++itr) {
+                *itr = static_cast<char>(
+                        std::tolower(static_cast<unsigned char>(*itr)));
+            }
+            return result;
+        }
+};
+
+IScriptEnvironment* __stdcall CreateScriptEnvironment(int version) {
+    if (version > AVISYNTH_INTERFACE_VERSION) return NULL;
+    return new ScriptEnvironment();
+}
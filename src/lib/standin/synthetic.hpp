@@ -0,0 +1,720 @@
+/*
+ * synthetic.hpp
+ *  Declarations and definitions of classes to make synthetic clips
+ *
+ *  Import() of the stand-in reads the calls of the functions below from a
+ *  script, without evaluating it.  Only literal arguments given by name are
+ *  read, and a later call replaces the values of an earlier call of the same
+ *  function.  A call of any other function is an error, since the stand-in
+ *  can't do what it does.
+ *
+ *      BlankClip(length=240, width=640, height=480, pixel_type="RGB32",
+ *                fps=24, fps_denominator=1, audio_rate=44100,
+ *                stereo=false, sixteen_bit=true, channels=1,
+ *                sample_type="16bit", color=$000000)
+ *          video of a color, and silent audio unless KillAudio is called
+ *          pixel_type:  RGB24, RGB32, YUY2, YV12, I420
+ *          sample_type: 8bit, 16bit, 24bit, 32bit, float
+ *
+ *      Tone(length=10.0, frequency=440, samplerate=48000, channels=2,
+ *           type="Sine", level=1.0)
+ *          audio in float, that replaces the audio of BlankClip
+ *          length:      in seconds
+ *          type:        Sine, Noise, Square, Triangle, Sawtooth, Silence
+ *
+ *      KillVideo, KillAudio
+ *      ConvertAudioTo8bit, ConvertAudioTo16bit, ConvertAudioTo24bit,
+ *      ConvertAudioTo32bit, ConvertAudioToFloat
+ *      AudioDub
+ *          These are accepted as AviSynth does for the clips above.
+ *
+ *      SyntheticCost(frame=0, audio=0, import=0)
+ *          Makes GetFrame() and GetAudio() spend the time in microseconds
+ *          per call, to imitate the filters that take time.  Import() of
+ *          the script waits for "import" microseconds without the CPU, as
+ *          a script that opens large files.  This is only for the
+ *          stand-in.
+ *
+ *      SyntheticFrame(numbered=false, broken=-1)
+ *          numbered:    fills the nth frame with the color n instead of
+ *                       "color" of BlankClip, so that frames can be told
+ *                       apart
+ *          broken:      the number of a frame whose GetFrame() throws
+ *                       AvisynthError, -1 for none
+ *          This is only for the stand-in, too.
+ *
+ *  The scripts in "test" directory are read as they are.  E.g.:
+ *
+ *      v = BlankClip(width=1920, height=1080, pixel_type="YV12").KillAudio
+ *      a = Tone(length=60, samplerate=48000, channels=6)
+ *      AudioDub(v, a).ConvertAudioTo24bit
+ *      SyntheticCost(frame=2000)
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef SYNTHETIC_HPP
+#define SYNTHETIC_HPP
+
+#include "../avsutil/avisynth.h"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "../../helper/clock.hpp"
+#include "../../helper/thread.hpp"
+
+namespace standin {
+    // lowercase names of arguments to their literal values
+    typedef std::map<std::string, std::string> arguments_type;
+
+    struct call_type {
+        std::string name;       // in lowercase
+        arguments_type arguments;
+    };
+
+    /*
+     *  A class to pick the calls of known functions from a script.  Errors
+     *  are thrown as std::runtime_error.
+     * */
+    class script_parser {
+        private:
+            const std::string& text;
+            std::size_t pos;
+
+        public:
+            // constructor
+            explicit script_parser(const std::string& text)
+                : text(text), pos(0) {}
+
+        private:
+            // copy constructor
+            script_parser(const script_parser& rhs);
+            // assignment operator
+            script_parser& operator=(const script_parser& rhs);
+
+        public:
+            std::vector<call_type> parse(void) {
+                std::vector<call_type> calls;
+                while (pos < text.size()) {
+                    const char c = text[pos];
+                    if (c == '#') {
+                        while (pos < text.size() && text[pos] != '\n') ++pos;
+                    }
+                    else if (c == '"') {
+                        string_literal();
+                    }
+                    else if (is_first_of_name(c)) {
+                        const std::string name = identifier();
+                        skip_blanks();
+                        const bool has_arguments = (peek() == '(');
+                        if (name == "audiodub") {
+                            // The arguments are clips to be read as well.
+                            continue;
+                        }
+                        if (!is_known(name)) {
+                            if (has_arguments) {
+                                throw std::runtime_error(
+                                        "unsupported function: " + name);
+                            }
+                            // a variable
+                            continue;
+                        }
+
+                        call_type call;
+                        call.name = name;
+                        if (has_arguments) arguments(call.arguments);
+                        calls.push_back(call);
+                    }
+                    else {
+                        ++pos;
+                    }
+                }
+                return calls;
+            }
+
+        private:
+            static bool is_known(const std::string& name) {
+                static const char* const names[] = {
+                    "blankclip", "tone", "killvideo", "killaudio",
+                    "convertaudioto8bit", "convertaudioto16bit",
+                    "convertaudioto24bit", "convertaudioto32bit",
+                    "convertaudiotofloat", "syntheticcost", "syntheticframe"
+                };
+                for (std::size_t i = 0;
+                        i < sizeof(names) / sizeof(names[0]); ++i) {
+                    if (name == names[i]) return true;
+                }
+                return false;
+            }
+
+            // Reads "(name=value, ...)".  Positional arguments are skipped.
+            void arguments(arguments_type& args) {
+                ++pos;  // '('
+                for (;;) {
+                    skip_spaces();
+                    if (peek() == ')') break;
+
+                    if (is_first_of_name(peek())) {
+                        const std::string name = identifier();
+                        skip_spaces();
+                        if (peek() == '=') {
+                            ++pos;
+                            skip_spaces();
+                            args[name] = value(name);
+                        }
+                        // Otherwise "name" is a variable of a clip.
+                    }
+                    else {
+                        value("");
+                    }
+
+                    skip_spaces();
+                    if (peek() == ',') {
+                        ++pos;
+                    }
+                    else if (peek() != ')') {
+                        throw std::runtime_error(
+                                "only literal arguments are supported");
+                    }
+                }
+                ++pos;  // ')'
+            }
+
+            // Reads a literal and returns it as a string.
+            std::string value(const std::string& name) {
+                const char c = peek();
+                if (c == '"') return string_literal();
+                if (c == '$') {
+                    ++pos;
+                    const std::size_t first = pos;
+                    while (pos < text.size()
+                            && std::isxdigit(
+                                static_cast<unsigned char>(text[pos]))) {
+                        ++pos;
+                    }
+                    const unsigned long n = std::strtoul(
+                            text.substr(first, pos - first).c_str(), NULL, 16);
+                    char buffer[16];
+                    std::sprintf(buffer, "%lu", n);
+                    return buffer;
+                }
+                if (is_first_of_name(c)) {
+                    const std::string word = identifier();
+                    if (word == "true" || word == "false") return word;
+                }
+                else if (c == '+' || c == '-' || c == '.'
+                        || std::isdigit(static_cast<unsigned char>(c))) {
+                    const std::size_t first = pos++;
+                    while (pos < text.size()
+                            && (std::isdigit(
+                                    static_cast<unsigned char>(text[pos]))
+                                || text[pos] == '.')) {
+                        ++pos;
+                    }
+                    return text.substr(first, pos - first);
+                }
+                throw std::runtime_error(
+                        "only literal arguments are supported: " + name);
+            }
+
+            std::string string_literal(void) {
+                const std::size_t first = ++pos;
+                while (pos < text.size() && text[pos] != '"') ++pos;
+                if (pos == text.size()) {
+                    throw std::runtime_error("unterminated string");
+                }
+                return text.substr(first, pos++ - first);
+            }
+
+            // Returns a name in lowercase, since AviSynth ignores the case.
+            std::string identifier(void) {
+                std::string name;
+                while (pos < text.size()
+                        && (is_first_of_name(text[pos])
+                            || std::isdigit(
+                                static_cast<unsigned char>(text[pos])))) {
+                    name += static_cast<char>(std::tolower(
+                                static_cast<unsigned char>(text[pos])));
+                    ++pos;
+                }
+                return name;
+            }
+
+            // Skips spaces in a line.
+            void skip_blanks(void) {
+                while (pos < text.size()
+                        && (text[pos] == ' ' || text[pos] == '\t')) {
+                    ++pos;
+                }
+            }
+
+            // Skips spaces, new lines and line continuations.
+            void skip_spaces(void) {
+                while (pos < text.size()
+                        && (std::isspace(static_cast<unsigned char>(text[pos]))
+                            || text[pos] == '\\')) {
+                    ++pos;
+                }
+            }
+
+            char peek(void) const {
+                return (pos < text.size()) ? text[pos] : '\0';
+            }
+
+            static bool is_first_of_name(char c) {
+                return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+            }
+    };
+
+    // what a synthetic clip makes
+    struct params_type {
+        VideoInfo vi;
+        uint32_t color;             // 0xAARRGGBB
+        enum waveform_type {
+            SILENCE, SINE, NOISE, SQUARE, TRIANGLE, SAWTOOTH
+        } waveform;
+        double frequency;           // in Hz
+        double level;               // the amplitude in [0, 1]
+        uint32_t frame_cost;        // in microseconds per GetFrame()
+        uint32_t audio_cost;        // in microseconds per GetAudio()
+        uint32_t import_cost;       // in microseconds per Import()
+        bool is_numbered;           // the nth frame has the color n
+        int broken_frame;           // GetFrame() fails, -1 for none
+    };
+
+    // helpers to read arguments
+    inline std::string get_string(  const arguments_type& args,
+                                    const char* name, const char* def) {
+        arguments_type::const_iterator found = args.find(name);
+        return (found != args.end()) ? found->second : def;
+    }
+
+    inline double get_double(   const arguments_type& args,
+                                const char* name, double def) {
+        arguments_type::const_iterator found = args.find(name);
+        if (found == args.end()) return def;
+
+        const char* first = found->second.c_str();
+        char* last;
+        const double value = std::strtod(first, &last);
+        if (*first == '\0' || *last != '\0') {
+            throw std::runtime_error(
+                    std::string(name) + " must be a number");
+        }
+        return value;
+    }
+
+    inline uint32_t get_uint(   const arguments_type& args,
+                                const char* name, uint32_t def) {
+        const double value = get_double(args, name, def);
+        if (value < 0 || value > 0x7fffffff || value != std::floor(value)) {
+            throw std::runtime_error(
+                    std::string(name) + " must be a positive integer");
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    inline bool get_bool(   const arguments_type& args,
+                            const char* name, bool def) {
+        const std::string value =
+            get_string(args, name, def ? "true" : "false");
+        if (value != "true" && value != "false") {
+            throw std::runtime_error(std::string(name) + " must be a bool");
+        }
+        return value == "true";
+    }
+
+    // Sets a frame rate by "fps" and "fps_denominator".
+    inline void fps(const arguments_type& args, VideoInfo& vi) {
+        const double rate = get_double(args, "fps", 24);
+        if (args.find("fps_denominator") != args.end()) {
+            vi.fps_numerator = static_cast<unsigned>(rate);
+            vi.fps_denominator = get_uint(args, "fps_denominator", 1);
+        }
+        else if (rate == std::floor(rate)) {
+            vi.fps_numerator = static_cast<unsigned>(rate);
+            vi.fps_denominator = 1;
+        }
+        else {
+            vi.fps_numerator = static_cast<unsigned>(rate * 1000 + 0.5);
+            vi.fps_denominator = 1000;
+        }
+        if (vi.fps_numerator == 0 || vi.fps_denominator == 0) {
+            throw std::runtime_error("fps must be positive");
+        }
+    }
+
+    inline int pixel_type(const std::string& name) {
+        if (name == "RGB24") return VideoInfo::CS_BGR24;
+        if (name == "RGB32") return VideoInfo::CS_BGR32;
+        if (name == "YUY2")  return VideoInfo::CS_YUY2;
+        if (name == "YV12")  return VideoInfo::CS_YV12;
+        if (name == "I420")  return VideoInfo::CS_I420;
+        throw std::runtime_error("unknown pixel_type: " + name);
+    }
+
+    inline int sample_type_of(const std::string& name) {
+        if (name == "8bit")  return SAMPLE_INT8;
+        if (name == "16bit") return SAMPLE_INT16;
+        if (name == "24bit") return SAMPLE_INT24;
+        if (name == "32bit") return SAMPLE_INT32;
+        if (name == "float") return SAMPLE_FLOAT;
+        throw std::runtime_error("unknown sample_type: " + name);
+    }
+
+    inline params_type::waveform_type waveform(const std::string& name) {
+        if (name == "Silence")  return params_type::SILENCE;
+        if (name == "Sine")     return params_type::SINE;
+        if (name == "Noise")    return params_type::NOISE;
+        if (name == "Square")   return params_type::SQUARE;
+        if (name == "Triangle") return params_type::TRIANGLE;
+        if (name == "Sawtooth") return params_type::SAWTOOTH;
+        throw std::runtime_error("unknown type: " + name);
+    }
+
+    /*
+     *  Makes params_type from the calls.  Errors are thrown as
+     *  std::runtime_error.
+     * */
+    inline params_type make_params(const std::vector<call_type>& calls) {
+        params_type params;
+        std::memset(&params, 0, sizeof(params));
+        params.waveform = params_type::SILENCE;
+        params.broken_frame = -1;
+
+        bool has_blankclip = false;
+        bool has_tone = false;
+        bool is_video_killed = false;
+        bool is_audio_killed = false;
+        int sample_type = 0;
+        arguments_type blankclip, tone;
+        for (std::vector<call_type>::const_iterator itr = calls.begin();
+                itr != calls.end(); ++itr) {
+            const std::string& name = itr->name;
+            if (name == "blankclip") {
+                has_blankclip = true;
+                blankclip = itr->arguments;
+            }
+            else if (name == "tone") {
+                has_tone = true;
+                tone = itr->arguments;
+            }
+            else if (name == "killvideo") {
+                is_video_killed = true;
+            }
+            else if (name == "killaudio") {
+                is_audio_killed = true;
+            }
+            else if (name == "convertaudioto8bit") {
+                sample_type = SAMPLE_INT8;
+            }
+            else if (name == "convertaudioto16bit") {
+                sample_type = SAMPLE_INT16;
+            }
+            else if (name == "convertaudioto24bit") {
+                sample_type = SAMPLE_INT24;
+            }
+            else if (name == "convertaudioto32bit") {
+                sample_type = SAMPLE_INT32;
+            }
+            else if (name == "convertaudiotofloat") {
+                sample_type = SAMPLE_FLOAT;
+            }
+            else if (name == "syntheticcost") {
+                params.frame_cost = get_uint(itr->arguments, "frame", 0);
+                params.audio_cost = get_uint(itr->arguments, "audio", 0);
+                params.import_cost = get_uint(itr->arguments, "import", 0);
+            }
+            else if (name == "syntheticframe") {
+                params.is_numbered =
+                    get_bool(itr->arguments, "numbered", false);
+                const double broken =
+                    get_double(itr->arguments, "broken", -1);
+                if (       broken < -1 || broken > 0x7fffffff
+                        || broken != std::floor(broken)) {
+                    throw std::runtime_error(
+                            "broken must be a frame number or -1");
+                }
+                params.broken_frame = static_cast<int>(broken);
+            }
+        }
+        if (!has_blankclip && !has_tone) {
+            throw std::runtime_error("neither BlankClip nor Tone is found");
+        }
+
+        VideoInfo& vi = params.vi;
+        // the frame rate is needed for audio only clips, too
+        vi.fps_numerator = 24;
+        vi.fps_denominator = 1;
+        if (has_blankclip && !is_video_killed) {
+            vi.num_frames = get_uint(blankclip, "length", 240);
+            vi.width = get_uint(blankclip, "width", 640);
+            vi.height = get_uint(blankclip, "height", 480);
+            vi.pixel_type =
+                pixel_type(get_string(blankclip, "pixel_type", "RGB32"));
+            if ((vi.IsYUY2() || vi.IsYV12()) && vi.width % 2 != 0) {
+                throw std::runtime_error("width must be even for YUV");
+            }
+            if (vi.IsYV12() && vi.height % 2 != 0) {
+                throw std::runtime_error("height must be even for YV12");
+            }
+            fps(blankclip, vi);
+            params.color = get_uint(blankclip, "color", 0);
+        }
+
+        if (has_tone) {
+            vi.audio_samples_per_second =
+                get_uint(tone, "samplerate", 48000);
+            vi.nchannels = get_uint(tone, "channels", 2);
+            vi.sample_type = SAMPLE_FLOAT;
+            vi.num_audio_samples = static_cast<int64_t>(
+                    get_double(tone, "length", 10.0)
+                    * vi.audio_samples_per_second + 0.5);
+            params.waveform = waveform(get_string(tone, "type", "Sine"));
+            params.frequency = get_double(tone, "frequency", 440);
+            params.level = get_double(tone, "level", 1.0);
+        }
+        else if (has_blankclip && !is_audio_killed) {
+            vi.audio_samples_per_second =
+                get_uint(blankclip, "audio_rate", 44100);
+            vi.nchannels = get_uint(
+                    blankclip, "channels",
+                    get_bool(blankclip, "stereo", false) ? 2 : 1);
+            vi.sample_type = sample_type_of(get_string(
+                        blankclip, "sample_type",
+                        get_bool(blankclip, "sixteen_bit", true)
+                            ? "16bit" : "float"));
+            vi.num_audio_samples = vi.AudioSamplesFromFrames(vi.num_frames);
+        }
+        if (vi.audio_samples_per_second > 0 && vi.nchannels == 0) {
+            throw std::runtime_error("channels must be positive");
+        }
+        if (vi.HasAudio() && sample_type != 0) vi.sample_type = sample_type;
+
+        return params;
+    }
+
+    // Spends "us" microseconds with the CPU busy, as filters do.
+    inline void spin(uint32_t us) {
+        if (us == 0) return;
+        const uint64_t end =
+            util::time::monotonic_ns() + static_cast<uint64_t>(us) * 1000;
+        while (util::time::monotonic_ns() < end) {}
+    }
+
+    // Spends "us" microseconds without the CPU, as reading files does.
+    inline void idle(uint32_t us) {
+        util::thread::mutex lock;
+        util::thread::condition never;
+        const uint64_t end =
+            util::time::monotonic_ns() + static_cast<uint64_t>(us) * 1000;
+        util::thread::scoped_lock l(lock);
+        for (uint64_t now = util::time::monotonic_ns(); now < end;
+                now = util::time::monotonic_ns()) {
+            never.wait_for(
+                    lock, static_cast<unsigned int>((end - now) / 1000000 + 1));
+        }
+    }
+
+    /*
+     *  A clip that returns the same frame for all numbers as BlankClip does,
+     *  or a frame of its own for each number if it is numbered, and a
+     *  waveform for audio.
+     * */
+    class synthetic_clip : public IClip {
+        private:
+            const params_type params;
+            PVideoFrame frame;  // made by the first GetFrame()
+
+        public:
+            // constructor
+            explicit synthetic_clip(const params_type& params)
+                : params(params) {}
+
+        private:
+            // copy constructor
+            synthetic_clip(const synthetic_clip& rhs);
+            // assignment operator
+            synthetic_clip& operator=(const synthetic_clip& rhs);
+
+        public:
+            const params_type& parameters(void) const { return params; }
+
+            PVideoFrame __stdcall GetFrame(int n, IScriptEnvironment* env) {
+                spin(params.frame_cost);
+                if (n == params.broken_frame) {
+                    env->ThrowError("SyntheticFrame: frame %d is broken", n);
+                }
+                if (params.is_numbered) {
+                    return render(env, static_cast<uint32_t>(n));
+                }
+                if (!frame) frame = render(env, params.color);
+                return frame;
+            }
+
+            bool __stdcall GetParity(int) { return params.vi.IsTFF(); }
+
+            void __stdcall GetAudio(void* buf, int64_t start, int64_t count,
+                                    IScriptEnvironment*) {
+                spin(params.audio_cost);
+
+                const VideoInfo& vi = params.vi;
+                const int channels = vi.AudioChannels();
+                const int bytes = vi.BytesPerChannelSample();
+                uint8_t* dst = static_cast<uint8_t*>(buf);
+                for (int64_t n = start; n < start + count; ++n) {
+                    const double value =
+                        (n < 0 || n >= vi.num_audio_samples) ? 0 : sample(n);
+                    for (int c = 0; c < channels; ++c) {
+                        write(value, dst);
+                        dst += bytes;
+                    }
+                }
+            }
+
+            void __stdcall SetCacheHints(int, int) {}
+
+            const VideoInfo& __stdcall GetVideoInfo(void) {
+                return params.vi;
+            }
+
+        private:
+            // Makes a frame of "color" (0xAARRGGBB).
+            PVideoFrame render(IScriptEnvironment* env, uint32_t color) const {
+                const VideoInfo& vi = params.vi;
+                PVideoFrame f = env->NewVideoFrame(vi);
+                const uint8_t r = static_cast<uint8_t>(color >> 16);
+                const uint8_t g = static_cast<uint8_t>(color >> 8);
+                const uint8_t b = static_cast<uint8_t>(color);
+                const uint8_t a = static_cast<uint8_t>(color >> 24);
+
+                if (vi.IsRGB()) {
+                    const int bpp = vi.BitsPerPixel() / 8;
+                    const uint8_t pixel[] = {b, g, r, a};
+                    fill(f, PLANAR_Y, pixel, bpp);
+                    return f;
+                }
+
+                // ITU-R BT.601 in the TV range as AviSynth does
+                const uint8_t y = static_cast<uint8_t>(
+                        ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+                const uint8_t u = static_cast<uint8_t>(
+                        ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+                const uint8_t v = static_cast<uint8_t>(
+                        ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+                if (vi.IsYUY2()) {
+                    const uint8_t pixels[] = {y, u, y, v};
+                    fill(f, PLANAR_Y, pixels, 4);
+                }
+                else {
+                    fill(f, PLANAR_Y, &y, 1);
+                    fill(f, PLANAR_U, &u, 1);
+                    fill(f, PLANAR_V, &v, 1);
+                }
+                return f;
+            }
+
+            // Fills "plane" with a pattern of "size" bytes.
+            static void fill(   PVideoFrame& f, int plane,
+                                const uint8_t* pattern, int size) {
+                BYTE* dst = f->GetWritePtr(plane);
+                const int pitch = f->GetPitch(plane);
+                const int row_size = f->GetRowSize(plane);
+                const int height = f->GetHeight(plane);
+                for (int y = 0; y < height; ++y) {
+                    for (int x = 0; x < row_size; ++x) {
+                        dst[x] = pattern[x % size];
+                    }
+                    dst += pitch;
+                }
+            }
+
+            // Returns the nth sample in [-level, level].
+            double sample(int64_t n) const {
+                const double pi = 3.14159265358979323846;
+                const double rate = params.vi.audio_samples_per_second;
+                // the position in a cycle in [0, 1)
+                const double phase = std::fmod(
+                        params.frequency * static_cast<double>(n), rate)
+                    / rate;
+
+                double value = 0;
+                switch (params.waveform) {
+                    case params_type::SILENCE:
+                        break;
+                    case params_type::SINE:
+                        value = std::sin(2 * pi * phase);
+                        break;
+                    case params_type::NOISE: {
+                        // a hash of "n" so that any range is reproducible
+                        uint32_t x = static_cast<uint32_t>(n) * 2654435761u;
+                        x ^= x >> 15;
+                        x *= 2246822519u;
+                        x ^= x >> 13;
+                        value = x / 2147483647.5 - 1;
+                        break;
+                    }
+                    case params_type::SQUARE:
+                        value = (phase < 0.5) ? 1 : -1;
+                        break;
+                    case params_type::TRIANGLE:
+                        value = (phase < 0.5) ? 4 * phase - 1 : 3 - 4 * phase;
+                        break;
+                    case params_type::SAWTOOTH:
+                        value = 2 * phase - 1;
+                        break;
+                }
+                return value * params.level;
+            }
+
+            // Writes "value" in [-1, 1] as the sample type of the clip.
+            void write(double value, uint8_t* dst) const {
+                if (value > 1) value = 1;
+                if (value < -1) value = -1;
+
+                switch (params.vi.SampleType()) {
+                    case SAMPLE_INT8:
+                        // unsigned as WAV
+                        *dst = static_cast<uint8_t>(
+                                std::floor(value * 127 + 0.5) + 128);
+                        break;
+                    case SAMPLE_INT16: {
+                        const int16_t s = static_cast<int16_t>(
+                                std::floor(value * 32767 + 0.5));
+                        std::memcpy(dst, &s, sizeof(s));
+                        break;
+                    }
+                    case SAMPLE_INT24: {
+                        const int32_t s = static_cast<int32_t>(
+                                std::floor(value * 8388607 + 0.5));
+                        dst[0] = static_cast<uint8_t>(s);
+                        dst[1] = static_cast<uint8_t>(s >> 8);
+                        dst[2] = static_cast<uint8_t>(s >> 16);
+                        break;
+                    }
+                    case SAMPLE_INT32: {
+                        const int32_t s = static_cast<int32_t>(
+                                std::floor(value * 2147483647.0 + 0.5));
+                        std::memcpy(dst, &s, sizeof(s));
+                        break;
+                    }
+                    case SAMPLE_FLOAT: {
+                        const float s = static_cast<float>(value);
+                        std::memcpy(dst, &s, sizeof(s));
+                        break;
+                    }
+                }
+            }
+    };
+}
+
+#endif // SYNTHETIC_HPP
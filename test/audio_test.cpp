@@ -0,0 +1,180 @@
+/*
+ * audio_test.cpp
+ *  A test of the audio stream at the end of samples and with prefetching
+ *
+ *  A WAV file whose samples don't fill the last buffer of the stream is read
+ *  by istream::read() larger than the buffer.  The stream has to stop at the
+ *  last sample and report the end, and the samples have to be the same as
+ *  the ones read by audio_type::read().
+ *
+ *  The same has to hold with prefetch(): pieces that cross the boundaries
+ *  of pages, seekg() into the current page, seekg() outside of the pages
+ *  in both directions, and the last page that is shorter than the others.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace avsutil;
+
+namespace {
+    void write_le(std::ostream& out, uint32_t value, unsigned int bytes) {
+        for (unsigned int i = 0; i < bytes; ++i) {
+            out.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+        }
+    }
+
+    // Writes a PCM WAV file of "numof_samples" samples, whose bytes count
+    // up from 0.
+    void write_wav( const std::string& filepath, uint32_t numof_samples,
+                    uint16_t bit_depth, uint16_t channels) {
+        const uint32_t block_size = bit_depth / 8 * channels;
+        const uint32_t data_size = numof_samples * block_size;
+        std::ofstream out(filepath.c_str(), std::ios::binary);
+        out << "RIFF";
+        write_le(out, 36 + data_size, 4);
+        out << "WAVEfmt ";
+        write_le(out, 16, 4);
+        write_le(out, 1, 2);                    // PCM
+        write_le(out, channels, 2);
+        write_le(out, 44100, 4);
+        write_le(out, 44100 * block_size, 4);
+        write_le(out, block_size, 2);
+        write_le(out, bit_depth, 2);
+        out << "data";
+        write_le(out, data_size, 4);
+        for (uint32_t i = 0; i < data_size; ++i) {
+            out.put(static_cast<char>(i & 0xFF));
+        }
+    }
+
+    /*
+     *  Reads the whole of "filepath" after a sample is got by get(), which
+     *  fills the buffer of the stream first.
+     * */
+    void read_to_end(   const std::string& filepath, uint32_t numof_samples,
+                        uint16_t bit_depth, uint16_t channels) {
+        write_wav(filepath, numof_samples, bit_depth, channels);
+        avs_type& avs = manager().load(filepath.c_str());
+        if (!CHECK(avs.is_fine())) return;
+
+        audio_type& audio = avs.audio();
+        const uint32_t block_size = audio.info().block_size;
+        const std::streamsize size = numof_samples * block_size;
+        std::vector<char> expected(size);
+        CHECK(audio.read(0, numof_samples, &expected[0]) == numof_samples);
+
+        std::istream& stream = audio.stream();
+        std::vector<char> actual(size + 65536);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            actual[i] = static_cast<char>(stream.get());
+        }
+        stream.read(&actual[block_size], 65536);
+        CHECK(stream.gcount() == size - block_size);
+        CHECK(stream.eof());
+        CHECK(std::equal(   expected.begin(), expected.end(),
+                            actual.begin()));
+
+        std::remove(filepath.c_str());
+    }
+
+    /*
+     *  Reads "size" bytes from "stream" at "position" in bytes, and
+     *  compares them with "expected".  Returns the position after them.
+     * */
+    std::size_t read_at(std::istream& stream, const std::vector<char>& expected,
+                        std::size_t position, std::size_t size) {
+        std::vector<char> actual(size);
+        stream.read(&actual[0], size);
+        const std::size_t got = static_cast<std::size_t>(stream.gcount());
+        const std::size_t rest = expected.size() - position;
+        if (!CHECK(got == std::min(size, rest))) {
+            std::cerr << "short read at " << position << std::endl;
+        }
+        if (!CHECK(std::equal(  actual.begin(), actual.begin() + got,
+                                expected.begin() + position))) {
+            std::cerr << "different at " << position << std::endl;
+        }
+        return position + got;
+    }
+
+    // Moves "stream" to "sample" and returns the position in bytes.
+    std::size_t seek(   std::istream& stream, uint64_t sample,
+                        uint32_t block_size) {
+        stream.clear();
+        stream.seekg(sample);
+        CHECK(static_cast<uint64_t>(stream.tellg()) == sample);
+        return static_cast<std::size_t>(sample * block_size);
+    }
+
+    /*
+     *  Reads "filepath" through "numof_pages" pages of "page_size" bytes,
+     *  in pieces of a size that is not a multiple of a sample nor a page.
+     * */
+    void read_prefetched(   const std::string& filepath,
+                            uint32_t numof_samples, uint16_t bit_depth,
+                            uint16_t channels, uint32_t page_size,
+                            uint32_t numof_pages) {
+        write_wav(filepath, numof_samples, bit_depth, channels);
+        avs_type& avs = manager().load(filepath.c_str());
+        if (!CHECK(avs.is_fine())) return;
+
+        audio_type& audio = avs.audio();
+        const uint32_t block_size = audio.info().block_size;
+        const uint32_t samples_per_page = page_size / block_size;
+        std::vector<char> expected(numof_samples * block_size);
+        CHECK(audio.read(0, numof_samples, &expected[0]) == numof_samples);
+
+        audio.prefetch(page_size, numof_pages);
+        std::istream& stream = audio.stream();
+        const std::size_t piece = 37;
+
+        // across the boundaries of some pages from the beginning
+        std::size_t position = 0;
+        while (position < 3 * page_size) {
+            const std::size_t next = read_at(stream, expected, position, piece);
+            if (next == position) return;
+            position = next;
+        }
+
+        // back into the current page, and on
+        position = seek(stream, position / block_size - 1, block_size);
+        position = read_at(stream, expected, position, page_size + piece);
+
+        // forward and backward outside of the pages
+        position = seek(stream, numof_samples / 2 + 3, block_size);
+        position = read_at(stream, expected, position, 2 * page_size + 1);
+        position = seek(stream, 5, block_size);
+        position = read_at(stream, expected, position, page_size);
+
+        // the last page that is shorter, to the end
+        const uint64_t last_page =
+            (numof_samples - 1) / samples_per_page * samples_per_page;
+        CHECK(numof_samples - last_page < samples_per_page);
+        position = seek(stream, last_page - 2, block_size);
+        position = read_at(stream, expected, position, 2 * page_size);
+        CHECK(position == expected.size());
+        CHECK(stream.eof());
+
+        manager().unload(avs);
+        std::remove(filepath.c_str());
+    }
+}
+
+int main(void) {
+    read_to_end("audio_test.8bit.wav", 1000, 8, 1);
+    read_to_end("audio_test.16bit.wav", 5000, 16, 2);
+    read_prefetched("audio_test.prefetch.8bit.wav", 1000, 8, 1, 64, 2);
+    read_prefetched("audio_test.prefetch.16bit.wav", 5003, 16, 2, 1000, 4);
+    return test::result();
+}
@@ -0,0 +1,136 @@
+/*
+ * cache_test.cpp
+ *  A test of video_type::cache_budget()
+ *
+ *  Each frame of the clip is filled with its number, and GetFrame() is
+ *  counted by the metrics of the library.  Under RANDOM access the frame
+ *  cache keeps frames within the budget: revisited frames have to be hits
+ *  without GetFrame(), and the least recently used frame has to be evicted
+ *  to make room for a new one.  A frame that a caller still holds has to
+ *  stay valid and in the cache however far the other frames go over the
+ *  budget.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    const uint32_t numof_frames = 100;
+    // frames the budget holds
+    const uint32_t numof_kept = 4;
+
+    uint64_t numof_get_frames(void) {
+        return metrics().entries[metrics_type::GET_FRAME].count;
+    }
+
+    // Returns the number that the pixels of "frame" have, or -1 if they
+    // are not the same.
+    long number_of(const video_type::frame_view& frame) {
+        const uint8_t* const first = frame.read_ptr();
+        const long number = first[0] | (first[1] << 8) | (first[2] << 16);
+        for (uint32_t y = 0; y < frame.height(); ++y) {
+            const uint8_t* line = first + frame.pitch() * y;
+            for (uint32_t x = 0; x < frame.row_size(); ++x) {
+                if (line[x] != first[x % 3]) return -1;
+            }
+        }
+        return number;
+    }
+
+    uint64_t bytes_of(const video_type::frame_view& frame) {
+        return static_cast<uint64_t>(frame.pitch()) * frame.height();
+    }
+
+    // Reads frame "n" and checks that it is "n".
+    void read(video_type& video, uint32_t n) {
+        if (!CHECK(number_of(video.frame(n)) == static_cast<long>(n))) {
+            std::cerr << "frame " << n << " is wrong" << std::endl;
+        }
+    }
+
+    void revisit(video_type& video, uint64_t frame_bytes) {
+        video.cache_budget(numof_kept * frame_bytes);
+        const video_type::cache_stats_type before = video.cache_stats();
+        const uint64_t get_frames = numof_get_frames();
+
+        // fills the cache, and revisits them in reverse
+        for (uint32_t n = 0; n < numof_kept; ++n) read(video, n);
+        for (uint32_t n = numof_kept; n > 0; --n) read(video, n - 1);
+        video_type::cache_stats_type stats = video.cache_stats();
+        CHECK(stats.misses - before.misses == numof_kept);
+        CHECK(stats.hits - before.hits == numof_kept);
+        CHECK(stats.evictions == before.evictions);
+        CHECK(numof_get_frames() - get_frames == numof_kept);
+
+        // A new frame evicts the least recently used, that is 3 now.
+        read(video, 50);
+        CHECK(video.cache_stats().evictions - before.evictions == 1);
+        read(video, 0);
+        CHECK(video.cache_stats().hits - before.hits == numof_kept + 1);
+        read(video, numof_kept - 1);
+        stats = video.cache_stats();
+        CHECK(stats.misses - before.misses == numof_kept + 2);
+        CHECK(stats.evictions - before.evictions == 2);
+        CHECK(numof_get_frames() - get_frames == numof_kept + 2);
+
+        video.cache_budget(0);
+    }
+
+    void pinned(video_type& video, uint64_t frame_bytes) {
+        video.cache_budget(2 * frame_bytes);
+        const video_type::frame_view held = video.frame(10);
+        const uint8_t* const held_ptr = held.read_ptr();
+
+        // far over the budget while "held" is alive
+        const video_type::cache_stats_type before = video.cache_stats();
+        for (uint32_t n = 20; n < 20 + 4 * numof_kept; ++n) read(video, n);
+        CHECK(video.cache_stats().evictions - before.evictions
+                >= 4 * numof_kept - 2);
+        CHECK(number_of(held) == 10);
+
+        // the same frame without GetFrame()
+        const uint64_t get_frames = numof_get_frames();
+        const video_type::frame_view again = video.frame(10);
+        CHECK(again.read_ptr() == held_ptr);
+        CHECK(video.cache_stats().hits == before.hits + 1);
+        CHECK(numof_get_frames() == get_frames);
+
+        video.cache_budget(0);
+        CHECK(number_of(held) == 10);
+    }
+}
+
+int main(void) {
+    const std::string script = "cache_test.avs";
+    {
+        std::ofstream out(script.c_str());
+        out << "BlankClip(length=" << numof_frames
+            << ", width=16, height=8, pixel_type=\"RGB24\")\n"
+            << "SyntheticFrame(numbered=true)\n";
+    }
+
+    enable_metrics(true);
+    avs_type& avs = manager().load(script.c_str());
+    if (CHECK(avs.is_fine())) {
+        video_type& video = avs.video();
+        video.access_hint(RANDOM);
+        const uint64_t frame_bytes = bytes_of(video.frame(numof_frames - 1));
+        revisit(video, frame_bytes);
+        pinned(video, frame_bytes);
+    }
+    manager().unload(avs);
+
+    std::remove(script.c_str());
+    return test::result();
+}
@@ -0,0 +1,140 @@
+/*
+ * colorspace_test.cpp
+ *  A test of the conversions in src/helper/colorspace.hpp
+ *
+ *  For every matrix and range, to_bgra() has to give the same results as
+ *  to_bgra_scalar() bit for bit, for all combinations of Y, U and V and for
+ *  widths that leave every tail to the scalar code.  to_bgra_scalar() has
+ *  to be within 1 of the conversion in floating point numbers.  The
+ *  vectorized kernels that are tested depend on the flags of the compiler;
+ *  "make check" builds this for AVX2 too when the processor has it.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/helper/colorspace.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+using namespace util::colorspace;
+
+namespace {
+    // constants
+    const matrix_type matrices[] = {BT601, BT709};
+    const range_type ranges[] = {TV_RANGE, PC_RANGE};
+    // pixels in a row: all Y for 16 values of V
+    const std::size_t row_size = 256 * 16;
+    const int tolerance = 1;
+
+    // B, G and R of Y, U and V in floating point numbers, rounded and
+    // clamped
+    void reference(int y, int u, int v, matrix_type matrix, range_type range,
+                   int* bgr) {
+        const double kr = (matrix == BT709) ? 0.2126 : 0.299;
+        const double kb = (matrix == BT709) ? 0.0722 : 0.114;
+        const double kg = 1.0 - kr - kb;
+        const double ys = (range == TV_RANGE) ? 255.0 / 219 : 1.0;
+        const double cs = (range == TV_RANGE) ? 255.0 / 224 : 1.0;
+        const double yy = (y - ((range == TV_RANGE) ? 16 : 0)) * ys;
+        const double uu = (u - 128) * cs;
+        const double vv = (v - 128) * cs;
+
+        const double b = yy + 2 * (1 - kb) * uu;
+        const double g = yy - 2 * (1 - kb) * kb / kg * uu
+                            - 2 * (1 - kr) * kr / kg * vv;
+        const double r = yy + 2 * (1 - kr) * vv;
+        const double values[] = {b, g, r};
+        for (int i = 0; i < 3; ++i) {
+            const double rounded = std::floor(values[i] + 0.5);
+            bgr[i] = (rounded < 0) ? 0 : (255 < rounded) ? 255
+                   : static_cast<int>(rounded);
+        }
+    }
+
+    void check_all_values(matrix_type matrix, range_type range) {
+        const coefficients_type k(matrix, range);
+        std::vector<uint8_t> y(row_size), u(row_size), v(row_size);
+        std::vector<uint8_t> expected(row_size * 4), actual(row_size * 4);
+        int max_error = 0;
+
+        for (int uu = 0; uu < 256; ++uu) {
+            for (int vbase = 0; vbase < 256; vbase += 16) {
+                for (std::size_t i = 0; i < row_size; ++i) {
+                    y[i] = static_cast<uint8_t>(i & 0xff);
+                    u[i] = static_cast<uint8_t>(uu);
+                    v[i] = static_cast<uint8_t>(vbase + (i >> 8));
+                }
+                to_bgra_scalar(&y[0], &u[0], &v[0], &expected[0],
+                               row_size, k);
+                to_bgra(&y[0], &u[0], &v[0], &actual[0], row_size, k);
+                if (!CHECK(expected == actual)) {
+                    std::cerr << "matrix " << matrix << ", range " << range
+                              << ", U " << uu << std::endl;
+                    return;
+                }
+
+                for (std::size_t i = 0; i < row_size; ++i) {
+                    int bgr[3];
+                    reference(y[i], u[i], v[i], matrix, range, bgr);
+                    for (int c = 0; c < 3; ++c) {
+                        const int error =
+                            std::abs(expected[i * 4 + c] - bgr[c]);
+                        if (max_error < error) max_error = error;
+                    }
+                }
+            }
+        }
+
+        if (!CHECK(max_error <= tolerance)) {
+            std::cerr << "matrix " << matrix << ", range " << range
+                      << ": error " << max_error << std::endl;
+        }
+    }
+
+    // widths and offsets that leave tails and misalign the kernels
+    void check_tails(matrix_type matrix, range_type range) {
+        const coefficients_type k(matrix, range);
+        const std::size_t max_width = 80;
+        const std::size_t margin = 4;
+        std::vector<uint8_t> y(max_width + margin), u(max_width + margin),
+                             v(max_width + margin);
+        for (std::size_t i = 0; i < y.size(); ++i) {
+            y[i] = static_cast<uint8_t>(i * 37);
+            u[i] = static_cast<uint8_t>(i * 91 + 11);
+            v[i] = static_cast<uint8_t>(i * 53 + 201);
+        }
+
+        for (std::size_t offset = 0; offset < margin; ++offset) {
+            for (std::size_t width = 0; width <= max_width; ++width) {
+                // a byte after the row must be left as is
+                std::vector<uint8_t> expected((width + margin) * 4, 0xAA);
+                std::vector<uint8_t> actual((width + margin) * 4, 0xAA);
+                to_bgra_scalar(&y[offset], &u[offset], &v[offset],
+                               &expected[offset], width, k);
+                to_bgra(&y[offset], &u[offset], &v[offset],
+                        &actual[offset], width, k);
+                if (!CHECK(expected == actual)) {
+                    std::cerr << "matrix " << matrix << ", range " << range
+                              << ", width " << width << ", offset "
+                              << offset << std::endl;
+                    return;
+                }
+            }
+        }
+    }
+}
+
+int main(void) {
+    for (std::size_t i = 0; i < sizeof(matrices) / sizeof(matrices[0]); ++i) {
+        for (std::size_t j = 0; j < sizeof(ranges) / sizeof(ranges[0]); ++j) {
+            check_all_values(matrices[i], ranges[j]);
+            check_tails(matrices[i], ranges[j]);
+        }
+    }
+    return test::result();
+}
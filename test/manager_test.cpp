@@ -0,0 +1,373 @@
+/*
+ * manager_test.cpp
+ *  A stress test of manager_type from some threads
+ *
+ *  Many copies of the scripts in this directory are loaded by load(),
+ *  load_all() and load_metadata() in parallel, while the budget closes the
+ *  least recently loaded ones.  The informations and the samples read from
+ *  each of them are checked.  Since the video and the audio of a script
+ *  should be used from one thread at a time, each thread reads only its own
+ *  copies.  Also a script whose import takes a second must not block
+ *  loading the others, and the scripts that have been read and released
+ *  must be closed to keep the memory usage under the budget.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+
+#include "../src/helper/clock.hpp"
+#include "../src/helper/thread.hpp"
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    const unsigned int numof_copies = 8;
+    // a thread for each copy
+    const unsigned int numof_threads = numof_copies;
+    const unsigned int numof_rounds = 200;
+    const uint32_t import_cost_us = 1000000;
+    const uint32_t reimport_cost_us = 300000;
+
+    // a copy of a script and what it has
+    struct script_type {
+        std::string filepath;
+        unsigned int copy;
+        uint16_t bit_depth;
+        uint32_t sampling_rate;
+        uint16_t channels;
+    };
+
+    // Reads "16bit_44100_5.1ch.avs" and so on.
+    bool parse_name(const std::string& name, script_type& script) {
+        unsigned int bit_depth, sampling_rate;
+        char channels[8];
+        if (std::sscanf(name.c_str(), "%ubit_%u_%7[^.]",
+                    &bit_depth, &sampling_rate, channels) != 3) {
+            return false;
+        }
+        const std::string layout = channels;
+        script.bit_depth = static_cast<uint16_t>(bit_depth);
+        script.sampling_rate = sampling_rate;
+        script.channels = (layout == "mono") ? 1
+                        : (layout == "stereo") ? 2
+                        : (layout == "5") ? 6 : 0;
+        return script.channels != 0;
+    }
+
+    std::string read_file(const std::string& filepath) {
+        std::ifstream in(filepath.c_str(), std::ios::binary);
+        return std::string(
+                (std::istreambuf_iterator<char>(in)),
+                std::istreambuf_iterator<char>());
+    }
+
+    void write_file(const std::string& filepath, const std::string& text) {
+        std::ofstream out(filepath.c_str(), std::ios::binary);
+        out << text;
+    }
+
+    // Makes "numof_copies" copies of each script in "dir".
+    std::vector<script_type> copy_scripts(const std::string& dir) {
+        std::vector<script_type> scripts;
+        DIR* d = opendir(dir.c_str());
+        if (d == NULL) return scripts;
+        while (const dirent* e = readdir(d)) {
+            const std::string name = e->d_name;
+            script_type script;
+            if (       name.size() < 4
+                    || name.compare(name.size() - 4, 4, ".avs") != 0
+                    || !parse_name(name, script)) {
+                continue;
+            }
+
+            const std::string text = read_file(dir + "/" + name);
+            for (unsigned int i = 0; i < numof_copies; ++i) {
+                std::ostringstream filepath;
+                filepath << "manager_test." << i << "." << name;
+                script.filepath = filepath.str();
+                script.copy = i;
+                write_file(script.filepath, text);
+                scripts.push_back(script);
+            }
+        }
+        closedir(d);
+        return scripts;
+    }
+
+    bool is_expected(avs_type& avs, const script_type& script) {
+        const audio_type::info_type& info = avs.audio_info();
+        return avs.is_fine() && avs.video_info().exists && info.exists
+            && info.bit_depth == script.bit_depth
+            && info.sampling_rate == script.sampling_rate
+            && info.channels == script.channels;
+    }
+
+    // Loads scripts at random in one of the ways of manager_type.
+    class loader : public util::thread::thread {
+        private:
+            const std::vector<script_type>& scripts;
+            // the copies whose video and audio this thread reads
+            std::vector<const script_type*> own;
+            unsigned int seed;
+
+        public:
+            loader(const std::vector<script_type>& scripts, unsigned int id)
+                : scripts(scripts), seed(id * 2654435761u + 1) {
+                for (std::size_t i = 0; i < scripts.size(); ++i) {
+                    if (scripts[i].copy == id) own.push_back(&scripts[i]);
+                }
+            }
+
+        private:
+            // copy constructor
+            loader(const loader& rhs);
+            // assignment operator
+            loader& operator=(const loader& rhs);
+
+        protected:
+            void run(void) {
+                for (unsigned int i = 0; i < numof_rounds; ++i) {
+                    const script_type& script = pick();
+                    switch (random() % 4) {
+                        case 0: read_audio(pick_own()); break;
+                        case 1: read_video(pick_own()); break;
+                        case 2: load_some(); break;
+                        default:
+                            CHECK(is_expected(
+                                    manager().load_metadata(
+                                        script.filepath.c_str()),
+                                    script));
+                            break;
+                    }
+                }
+            }
+
+        private:
+            unsigned int random(void) {
+                seed = seed * 1103515245u + 12345u;
+                return seed >> 16;
+            }
+            const script_type& pick(void) {
+                return scripts[random() % scripts.size()];
+            }
+            const script_type& pick_own(void) {
+                return *own[random() % own.size()];
+            }
+
+            void read_audio(const script_type& script) {
+                avs_type& avs = manager().load(script.filepath.c_str());
+                if (!CHECK(is_expected(avs, script))) return;
+
+                audio_type& audio = avs.audio();
+                std::vector<char> buffer(1024 * audio.info().block_size);
+                CHECK(audio.read(random() % 1000, 1024, &buffer[0]) == 1024);
+                avs.release_audio();
+            }
+
+            void read_video(const script_type& script) {
+                avs_type& avs = manager().load(script.filepath.c_str());
+                if (!CHECK(is_expected(avs, script))) return;
+
+                video_type& video = avs.video();
+                {
+                    const video_type::frame_view frame =
+                        video.frame(random() % video.info().numof_frames);
+                    CHECK(frame.read_ptr() != NULL);
+                }
+                avs.release_video();
+            }
+
+            void load_some(void) {
+                std::vector<std::string> filepaths;
+                std::vector<const script_type*> picked;
+                for (unsigned int i = 0; i < 4; ++i) {
+                    picked.push_back(&pick());
+                    filepaths.push_back(picked.back()->filepath);
+                }
+                const std::vector<avs_type*> loaded =
+                    manager().load_all(filepaths);
+                if (!CHECK(loaded.size() == picked.size())) return;
+                for (std::size_t i = 0; i < loaded.size(); ++i) {
+                    CHECK(is_expected(*loaded[i], *picked[i]));
+                }
+            }
+    };
+
+    // Loads a script that takes a long time to be imported.
+    class slow_loader : public util::thread::thread {
+        private:
+            const std::string filepath;
+
+        public:
+            avs_type* loaded;
+
+        public:
+            explicit slow_loader(const std::string& filepath)
+                : filepath(filepath), loaded(NULL) {}
+
+        protected:
+            void run(void) {
+                loaded = &manager().load(filepath.c_str());
+                CHECK(loaded->is_fine());
+            }
+    };
+
+    // Waits for a while so that another thread goes ahead.
+    void sleep_ms(unsigned int ms) {
+        util::thread::mutex m;
+        util::thread::condition c;
+        util::thread::scoped_lock l(m);
+        c.wait_for(m, ms);
+    }
+
+    void stress(const std::vector<script_type>& scripts) {
+        std::vector<loader*> loaders;
+        for (unsigned int i = 0; i < numof_threads; ++i) {
+            loaders.push_back(new loader(scripts, i));
+            CHECK(loaders.back()->start());
+        }
+
+        // budgets small enough to close scripts over and over
+        for (unsigned int i = 0; i < 20; ++i) {
+            manager().budget((i % 2 == 0) ? (64 << 20) : 1, 16);
+        }
+
+        for (std::size_t i = 0; i < loaders.size(); ++i) {
+            loaders[i]->join();
+            delete loaders[i];
+        }
+    }
+
+    /*
+     *  Loads the others while "slow" is being imported.  They don't wait
+     *  for it, even when the budget is applied and the whole memory usage
+     *  of scripts is summed up.
+     * */
+    void not_blocked(const std::vector<script_type>& scripts) {
+        const std::string slow = "manager_test.slow.avs";
+        std::ostringstream text;
+        text << read_file(scripts[0].filepath)
+             << "SyntheticCost(import=" << import_cost_us << ")\n";
+        write_file(slow, text.str());
+        manager().budget(uint64_t(1) << 40, 16);
+
+        slow_loader loader(slow);
+        const uint64_t start = util::time::monotonic_ns();
+        CHECK(loader.start());
+
+        // Wait for the import to begin, and load the others.
+        sleep_ms(100);
+        std::vector<std::string> filepaths;
+        for (std::size_t i = 0; i < scripts.size(); ++i) {
+            CHECK(manager().load(scripts[i].filepath.c_str()).is_fine());
+            filepaths.push_back(scripts[i].filepath);
+        }
+        manager().load_all(filepaths);
+        const uint64_t elapsed = util::time::monotonic_ns() - start;
+        CHECK(elapsed < import_cost_us * 1000 / 2);
+
+        loader.join();
+        std::remove(slow.c_str());
+    }
+
+    /*
+     *  Reads the video and the audio of each script and releases them.  The
+     *  scripts read before are closed to keep the budget when the next one
+     *  is loaded.
+     * */
+    void bounded(const std::vector<script_type>& scripts) {
+        const uint32_t script_memory_max = 16;
+        const uint64_t budget = 3 * (uint64_t(script_memory_max) << 20);
+        manager().budget(budget, script_memory_max);
+        const uint64_t evictions = manager().cache_stats().evictions;
+
+        for (std::size_t i = 0; i < scripts.size(); ++i) {
+            avs_type& avs = manager().load(scripts[i].filepath.c_str());
+            if (!CHECK(is_expected(avs, scripts[i]))) continue;
+            {
+                const video_type::frame_view frame = avs.video().frame(0);
+                CHECK(frame.read_ptr() != NULL);
+            }
+            std::vector<char> buffer(1024 * avs.audio_info().block_size);
+            CHECK(avs.audio().read(0, 1024, &buffer[0]) == 1024);
+            avs.release_video();
+            avs.release_audio();
+
+            const manager_type::cache_stats_type stats =
+                manager().cache_stats();
+            if (!CHECK(stats.usage <= budget)) {
+                std::cerr << "usage: " << stats.usage << std::endl;
+                break;
+            }
+        }
+        CHECK(manager().cache_stats().evictions - evictions
+                >= scripts.size() - 3);
+        manager().budget(0, 0);
+    }
+
+    /*
+     *  Unloads a script while another thread loads it again.  The thread
+     *  has its own reference, so the object lives until it is unloaded
+     *  twice.
+     * */
+    void unloaded_while_loading(const std::vector<script_type>& scripts) {
+        const std::string slow = "manager_test.unloaded.avs";
+        std::ostringstream text;
+        text << read_file(scripts[0].filepath)
+             << "SyntheticCost(import=" << reimport_cost_us << ")\n";
+        write_file(slow, text.str());
+        manager().budget(0, 16);
+
+        avs_type& avs = manager().load(slow.c_str());
+        CHECK(avs.is_fine());
+        // closed to be imported again by the loader
+        manager().budget(1, 16);
+
+        slow_loader loader(slow);
+        CHECK(loader.start());
+        sleep_ms(reimport_cost_us / 1000 / 3);
+        manager().unload(avs);
+        loader.join();
+
+        if (CHECK(loader.loaded == &avs)) {
+            CHECK(is_expected(*loader.loaded, scripts[0]));
+            manager().unload(*loader.loaded);
+        }
+        std::remove(slow.c_str());
+    }
+}
+
+int main(const int argc, const char* const argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: manager_test <test directory>" << std::endl;
+        return 2;
+    }
+
+    const std::vector<script_type> scripts = copy_scripts(argv[1]);
+    if (!CHECK(!scripts.empty())) return test::result();
+
+    stress(scripts);
+    not_blocked(scripts);
+    bounded(scripts);
+    unloaded_while_loading(scripts);
+
+    for (std::size_t i = 0; i < scripts.size(); ++i) {
+        std::remove(scripts[i].filepath.c_str());
+    }
+    return test::result();
+}
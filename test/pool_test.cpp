@@ -0,0 +1,113 @@
+/*
+ * pool_test.cpp
+ *  A test of the pool of video_type for frame streams and frames
+ *
+ *  The global operator new of this program counts allocations from the
+ *  heap.  Once sequential extraction through framestream() and frame() is
+ *  warmed up, it has to allocate nothing for each frame, as long as the
+ *  clip is already in the requested format so AviSynth allocates no pixels.
+ *  Frames got by request_frame() have to be recycled by the pool too.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    const uint32_t numof_frames = 300;
+    const uint32_t warming_frames = 100;
+    const uint32_t numof_requests = 50;
+
+    // allocations from the heap while "is_counting" is true
+    bool is_counting = false;
+    unsigned long numof_allocations = 0;
+}
+
+// the hook to count allocations
+void* operator new(std::size_t size) throw(std::bad_alloc) {
+    if (is_counting) ++numof_allocations;
+    void* const p = std::malloc(size == 0 ? 1 : size);
+    if (p == NULL) throw std::bad_alloc();
+    return p;
+}
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+namespace {
+    void read_frame(video_type& video, uint32_t n) {
+        static char buffer[65536];
+        std::istream& in = video.framestream(n);
+        while (in.good()) in.read(buffer, sizeof(buffer));
+        video.release_framestream(in);
+
+        const video_type::frame_view frame = video.frame(n);
+        CHECK(frame.read_ptr() != NULL);
+    }
+
+    void sequential(video_type& video) {
+        video.access_hint(SEQUENTIAL);
+        for (uint32_t n = 0; n < warming_frames; ++n) read_frame(video, n);
+
+        const video_type::pool_stats_type before = video.pool_stats();
+        numof_allocations = 0;
+        is_counting = true;
+        for (uint32_t n = warming_frames; n < numof_frames; ++n) {
+            read_frame(video, n);
+        }
+        is_counting = false;
+        const video_type::pool_stats_type after = video.pool_stats();
+
+        CHECK(numof_allocations == 0);
+        CHECK(after.allocations == before.allocations);
+        CHECK(after.reuses > before.reuses);
+    }
+
+    void requests(video_type& video) {
+        video_type::request_type& warming = video.request_frame(0);
+        warming.get();
+        video.release_request(warming);
+
+        const video_type::pool_stats_type before = video.pool_stats();
+        for (uint32_t n = 1; n <= numof_requests; ++n) {
+            video_type::request_type& request = video.request_frame(n);
+            CHECK(request.get().read_ptr() != NULL);
+            video.release_request(request);
+        }
+        const video_type::pool_stats_type after = video.pool_stats();
+
+        CHECK(after.allocations == before.allocations);
+        CHECK(after.reuses - before.reuses >= numof_requests);
+    }
+}
+
+int main(void) {
+    const std::string script = "pool_test.avs";
+    {
+        std::ofstream out(script.c_str());
+        out << "BlankClip(length=" << numof_frames
+            << ", width=64, height=48, pixel_type=\"RGB24\")\n";
+    }
+
+    avs_type& avs = manager().load(script.c_str());
+    if (CHECK(avs.is_fine())) {
+        video_type& video = avs.video();
+        sequential(video);
+        requests(video);
+    }
+
+    std::remove(script.c_str());
+    return test::result();
+}
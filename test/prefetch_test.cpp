@@ -0,0 +1,107 @@
+/*
+ * prefetch_test.cpp
+ *  A test of video_type::prefetch()
+ *
+ *  Each frame of the clip is filled with its number.  The frames are read
+ *  forward and backward with a pause for each, as a consumer that works on
+ *  them, so that the prefetcher goes ahead.  Most of them have to be hits
+ *  of the prefetcher, and every frame has to be the same as the one
+ *  rendered without prefetching.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../src/helper/thread.hpp"
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    const uint32_t numof_frames = 100;
+    const uint32_t frame_cost_us = 1000;
+    const uint32_t window = 8;
+    // the work of the consumer for each frame
+    const unsigned int pause_ms = 5;
+
+    typedef std::vector<std::vector<uint8_t> > frames_type;
+
+    // Waits for a while so that the prefetcher goes ahead.
+    void sleep_ms(unsigned int ms) {
+        util::thread::mutex m;
+        util::thread::condition c;
+        util::thread::scoped_lock l(m);
+        c.wait_for(m, ms);
+    }
+
+    std::vector<uint8_t> bytes_of(const video_type::frame_view& frame) {
+        std::vector<uint8_t> bytes;
+        for (uint32_t y = 0; y < frame.height(); ++y) {
+            const uint8_t* line = frame.read_ptr() + frame.pitch() * y;
+            bytes.insert(bytes.end(), line, line + frame.row_size());
+        }
+        return bytes;
+    }
+
+    // Reads "expected" frames in the order of "access" and checks them
+    // with the statistics of the prefetcher.
+    void scan(  video_type& video, const frames_type& expected,
+                access_type access) {
+        video.access_hint(access);
+        const video_type::prefetch_stats_type before = video.prefetch_stats();
+
+        for (uint32_t i = 0; i < numof_frames; ++i) {
+            const uint32_t n = (access == REVERSE) ? numof_frames - 1 - i : i;
+            if (!CHECK(bytes_of(video.frame(n)) == expected[n])) {
+                std::cerr << "frame " << n << " is wrong" << std::endl;
+            }
+            sleep_ms(pause_ms);
+        }
+
+        const video_type::prefetch_stats_type after = video.prefetch_stats();
+        const uint64_t hits = after.hits - before.hits;
+        const uint64_t misses = after.misses - before.misses;
+        CHECK(hits + misses == numof_frames);
+        if (!CHECK(hits >= numof_frames * 3 / 4)) {
+            std::cerr << "hits: " << hits << ", misses: " << misses
+                << std::endl;
+        }
+    }
+}
+
+int main(void) {
+    const std::string script = "prefetch_test.avs";
+    {
+        std::ofstream out(script.c_str());
+        out << "BlankClip(length=" << numof_frames
+            << ", width=16, height=8, pixel_type=\"RGB24\")\n"
+            << "SyntheticFrame(numbered=true)\n"
+            << "SyntheticCost(frame=" << frame_cost_us << ")\n";
+    }
+
+    avs_type& avs = manager().load(script.c_str());
+    if (CHECK(avs.is_fine())) {
+        video_type& video = avs.video();
+        frames_type expected;
+        for (uint32_t n = 0; n < numof_frames; ++n) {
+            expected.push_back(bytes_of(video.frame(n)));
+        }
+
+        video.prefetch(window);
+        scan(video, expected, SEQUENTIAL);
+        scan(video, expected, REVERSE);
+    }
+    manager().unload(avs);
+
+    std::remove(script.c_str());
+    return test::result();
+}
@@ -0,0 +1,200 @@
+/*
+ * renderer_test.cpp
+ *  A test of video_type::renderer() with some workers
+ *
+ *  Each frame of the clip has its number as its color, so a frame tells
+ *  where it came from.  The renderer has to return all frames of a range
+ *  strictly in order, however the workers steal frames from each other and
+ *  go ahead within the buffer.  When a frame fails to render, next() has to
+ *  throw the error after the frames before it, instead of waiting for the
+ *  broken frame forever.  Each rendering is watched by a timer so that a
+ *  hang fails the test.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "../src/helper/thread.hpp"
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    const uint32_t numof_frames = 300;
+    const uint32_t numof_workers = 4;
+    const uint32_t broken_frame = 123;
+    // the limit for a rendering, long enough for the sanitizers
+    const unsigned int timeout_ms = 60000;
+
+    // Writes a script of a numbered clip that costs "frame_cost" for each
+    // frame, with "broken" frame that fails if it is not -1.
+    void write_script(  const std::string& filepath, uint32_t frame_cost,
+                        int broken) {
+        std::ofstream out(filepath.c_str());
+        out << "BlankClip(length=" << numof_frames
+            << ", width=16, height=8, pixel_type=\"RGB24\")\n"
+            << "SyntheticFrame(numbered=true, broken=" << broken << ")\n"
+            << "SyntheticCost(frame=" << frame_cost << ")\n";
+    }
+
+    // Returns the number that the pixels of "frame" have, or -1 if they
+    // are not the same.
+    long number_of(const video_type::frame_view& frame) {
+        const uint8_t* const first = frame.read_ptr();
+        const long number = first[0] | (first[1] << 8) | (first[2] << 16);
+        for (uint32_t y = 0; y < frame.height(); ++y) {
+            const uint8_t* line = first + frame.pitch() * y;
+            for (uint32_t x = 0; x < frame.row_size(); ++x) {
+                if (line[x] != first[x % 3]) return -1;
+            }
+        }
+        return number;
+    }
+
+    /*
+     *  Renders [first, last) of a script in a thread, and tells the end by
+     *  "done" so that the main thread can give up a hang.
+     * */
+    class consumer : public util::thread::thread {
+        private:
+            video_type& video;
+            const uint32_t first;
+            const uint32_t last;
+
+        public:
+            // the results, read after the end
+            uint32_t numof_rendered;
+            bool is_in_order;
+            std::string errmsg;
+
+            // guarded by "lock"
+            util::thread::mutex lock;
+            util::thread::condition cond;
+            bool done;
+
+        public:
+            consumer(video_type& video, uint32_t first, uint32_t last)
+                : video(video), first(first), last(last),
+                  numof_rendered(0), is_in_order(true), done(false) {}
+
+        private:
+            // copy constructor
+            consumer(const consumer& rhs);
+            // assignment operator
+            consumer& operator=(const consumer& rhs);
+
+        public:
+            // Waits for the end.  Returns false on a timeout.
+            bool wait(void) {
+                util::thread::scoped_lock l(lock);
+                for (unsigned int waited = 0;
+                        !done && waited < timeout_ms; waited += 100) {
+                    cond.wait_for(lock, 100);
+                }
+                return done;
+            }
+
+        protected:
+            void run(void) {
+                video_type::renderer_type& renderer = video.renderer(
+                        first, last, video_type::RGB24, numof_workers);
+                try {
+                    uint32_t expected = first;
+                    while (renderer.next()) {
+                        if (       renderer.number() != expected
+                                || number_of(renderer.frame()) != expected) {
+                            is_in_order = false;
+                        }
+                        ++expected;
+                        ++numof_rendered;
+                    }
+                }
+                catch (const std::runtime_error& ex) {
+                    errmsg = ex.what();
+                }
+                video.release_renderer(renderer);
+
+                util::thread::scoped_lock l(lock);
+                done = true;
+                cond.notify_all();
+            }
+    };
+
+    /*
+     *  Renders [first, last) of "filepath".  A hang can't be recovered, so
+     *  the test ends there.
+     */
+    void render(consumer& c) {
+        CHECK(c.start());
+        if (!CHECK(c.wait())) {
+            std::cerr << "the renderer hangs" << std::endl;
+            std::abort();
+        }
+        c.join();
+    }
+
+    void in_order(const std::string& filepath) {
+        write_script(filepath, 100, -1);
+        avs_type& avs = manager().load(filepath.c_str());
+        if (!CHECK(avs.is_fine())) return;
+        video_type& video = avs.video();
+
+        // whole, and a range that doesn't start at 0
+        consumer whole(video, 0, numof_frames);
+        render(whole);
+        CHECK(whole.errmsg.empty());
+        CHECK(whole.is_in_order);
+        CHECK(whole.numof_rendered == numof_frames);
+
+        consumer part(video, 37, 250);
+        render(part);
+        CHECK(part.errmsg.empty());
+        CHECK(part.is_in_order);
+        CHECK(part.numof_rendered == 250 - 37);
+
+        // compared with frame()
+        CHECK(number_of(video.frame(42)) == 42);
+        manager().unload(avs);
+    }
+
+    void broken(const std::string& filepath) {
+        write_script(filepath, 100, broken_frame);
+        avs_type& avs = manager().load(filepath.c_str());
+        if (!CHECK(avs.is_fine())) return;
+        video_type& video = avs.video();
+
+        consumer c(video, 0, numof_frames);
+        render(c);
+        CHECK(c.is_in_order);
+        CHECK(c.numof_rendered == broken_frame);
+        if (!CHECK(c.errmsg.find("broken") != std::string::npos)) {
+            std::cerr << "error: \"" << c.errmsg << "\"" << std::endl;
+        }
+
+        // A range without the broken frame is fine.
+        consumer after(video, broken_frame + 1, numof_frames);
+        render(after);
+        CHECK(after.errmsg.empty());
+        CHECK(after.numof_rendered == numof_frames - broken_frame - 1);
+        manager().unload(avs);
+    }
+}
+
+int main(void) {
+    const std::string filepath = "renderer_test.avs";
+    in_order(filepath);
+    broken(filepath);
+    std::remove(filepath.c_str());
+    return test::result();
+}
@@ -0,0 +1,111 @@
+/*
+ * requester_test.cpp
+ *  A test of video_type::request_frame()
+ *
+ *  Each frame of the clip is filled with its number and takes a while to
+ *  render, and GetFrame() is counted by the metrics of the library.  Two
+ *  requests for the same frame in flight have to render it once and share
+ *  it.  A request that is cancelled while it is queued behind others has to
+ *  be never rendered: jobs run in the order of requests, so a request after
+ *  it tells whether it was left in the queue.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace avsutil;
+
+namespace {
+    // constants
+    const uint32_t numof_frames = 300;
+    const uint32_t frame_cost_us = 20000;
+    // more than the workers of the requester, to keep a request queued
+    const uint32_t numof_blockers = 8;
+
+    uint64_t numof_get_frames(void) {
+        return metrics().entries[metrics_type::GET_FRAME].count;
+    }
+
+    long number_of(const video_type::frame_view& frame) {
+        const uint8_t* const p = frame.read_ptr();
+        return p[0] | (p[1] << 8) | (p[2] << 16);
+    }
+
+    void single_flight(video_type& video) {
+        const uint64_t before = numof_get_frames();
+        video_type::request_type& first = video.request_frame(5);
+        video_type::request_type& second = video.request_frame(5);
+        const video_type::frame_view a = first.get();
+        const video_type::frame_view b = second.get();
+
+        CHECK(numof_get_frames() - before == 1);
+        CHECK(a.read_ptr() == b.read_ptr());
+        CHECK(number_of(a) == 5);
+        video.release_request(first);
+        video.release_request(second);
+    }
+
+    void cancelled(video_type& video) {
+        const uint64_t before = numof_get_frames();
+        std::vector<video_type::request_type*> blockers;
+        for (uint32_t n = 0; n < numof_blockers; ++n) {
+            blockers.push_back(&video.request_frame(100 + n));
+        }
+        video_type::request_type& target = video.request_frame(200);
+        target.cancel();
+        CHECK(target.is_ready());
+        bool is_thrown = false;
+        try {
+            target.get();
+        }
+        catch (const std::runtime_error&) {
+            is_thrown = true;
+        }
+        CHECK(is_thrown);
+
+        for (uint32_t n = 0; n < numof_blockers; ++n) {
+            CHECK(number_of(blockers[n]->get()) == 100 + n);
+            video.release_request(*blockers[n]);
+        }
+        // rendered after the cancelled one if it was left in the queue
+        video_type::request_type& probe = video.request_frame(201);
+        CHECK(number_of(probe.get()) == 201);
+        video.release_request(probe);
+        video.release_request(target);
+
+        CHECK(numof_get_frames() - before == numof_blockers + 1);
+    }
+}
+
+int main(void) {
+    const std::string script = "requester_test.avs";
+    {
+        std::ofstream out(script.c_str());
+        out << "BlankClip(length=" << numof_frames
+            << ", width=16, height=8, pixel_type=\"RGB24\")\n"
+            << "SyntheticFrame(numbered=true)\n"
+            << "SyntheticCost(frame=" << frame_cost_us << ")\n";
+    }
+
+    enable_metrics(true);
+    avs_type& avs = manager().load(script.c_str());
+    if (CHECK(avs.is_fine())) {
+        video_type& video = avs.video();
+        single_flight(video);
+        cancelled(video);
+    }
+    manager().unload(avs);
+
+    std::remove(script.c_str());
+    return test::result();
+}
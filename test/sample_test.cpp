@@ -0,0 +1,128 @@
+/*
+ * sample_test.cpp
+ *  A test of the conversions in src/helper/sample.hpp
+ *
+ *  convert() has to give the same results as convert_scalar() bit for bit
+ *  for every pair of formats, with and without dither, for lengths that
+ *  leave tails to the scalar code.  Dither has to change nothing when the
+ *  precision isn't reduced.  The vectorized kernels that are tested depend
+ *  on the flags of the compiler; "make check" builds this for AVX2 too
+ *  when the processor has it.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/helper/sample.hpp"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+
+using namespace util::sample;
+
+namespace {
+    // constants
+    const format_type formats[] = {INT8, INT16, INT24, INT32, FLOAT};
+    const std::size_t numof_formats = sizeof(formats) / sizeof(formats[0]);
+    const std::size_t numof_values = 4096 + 67;
+
+    // values that are rounded or clipped in different ways
+    const float special_floats[] = {
+        0.0f, -0.0f, 1.0f, -1.0f, 1.5f, -1.5f, 0.5f, -0.5f,
+        1.0f / 65536.0f, -1.0f / 65536.0f,      // halves of an LSB of int16
+        3.0f / 65536.0f, -3.0f / 65536.0f,
+        1.0f / 256.0f, -1.0f / 256.0f,          // halves of an LSB of int8
+        32767.5f / 32768.0f, -32767.5f / 32768.0f,
+        2147483520.0f / 2147483648.0f,
+        1e-30f, -1e-30f, 1e30f, -1e30f,
+        std::numeric_limits<float>::infinity(),
+        -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN()
+    };
+
+    // Fills "values" of "format" with special values and random ones.
+    std::vector<uint8_t> make_values(format_type format) {
+        std::vector<uint8_t> values(numof_values * size(format));
+        dither random(12345);
+        if (format != FLOAT) {
+            for (std::size_t i = 0; i < values.size(); ++i) {
+                values[i] = static_cast<uint8_t>(random.next() >> 24);
+            }
+            return values;
+        }
+
+        const std::size_t numof_special =
+            sizeof(special_floats) / sizeof(special_floats[0]);
+        for (std::size_t i = 0; i < numof_values; ++i) {
+            float v;
+            if (i < numof_special) {
+                v = special_floats[i];
+            }
+            else if (i % 3 == 0) {
+                // on a boundary of rounding of int16
+                v = (static_cast<float>(random.next() >> 16) - 32768.0f
+                        + 0.5f) / 32768.0f;
+            }
+            else {
+                // slightly beyond [-1.0, 1.0] to be clipped
+                v = (static_cast<float>(random.next() >> 8)
+                        / (1 << 24) * 2.0f - 1.0f) * 1.125f;
+            }
+            std::memcpy(&values[i * sizeof(float)], &v, sizeof(float));
+        }
+        return values;
+    }
+
+    bool is_reduced(format_type from, format_type to) {
+        return bits(to) < bits(from);
+    }
+
+    void check_pair(format_type from, format_type to) {
+        const std::vector<uint8_t> src = make_values(from);
+        const std::size_t dsize = size(to);
+
+        // lengths with every tail of the kernels, and a long one
+        for (std::size_t count = 0; count <= numof_values; ++count) {
+            if (count > 67 && count != numof_values) continue;
+
+            std::vector<uint8_t> expected(count * dsize + 1, 0xAA);
+            std::vector<uint8_t> actual(count * dsize + 1, 0xAA);
+            convert_scalar(&src[0], from, &expected[0], to, count);
+            convert(&src[0], from, &actual[0], to, count);
+            if (!CHECK(expected == actual)) {
+                std::cerr << "from " << from << " to " << to
+                          << ", count " << count << std::endl;
+                return;
+            }
+
+            dither scalar_dither(7), vector_dither(7);
+            std::vector<uint8_t> dithered(count * dsize + 1, 0xAA);
+            convert_scalar(&src[0], from, &expected[0], to, count,
+                           &scalar_dither);
+            convert(&src[0], from, &dithered[0], to, count, &vector_dither);
+            if (!CHECK(expected == dithered)) {
+                std::cerr << "from " << from << " to " << to
+                          << ", count " << count << " with dither"
+                          << std::endl;
+                return;
+            }
+            if (!is_reduced(from, to) && !CHECK(actual == dithered)) {
+                std::cerr << "from " << from << " to " << to
+                          << " is changed by dither" << std::endl;
+                return;
+            }
+        }
+    }
+}
+
+int main(void) {
+    for (std::size_t i = 0; i < numof_formats; ++i) {
+        for (std::size_t j = 0; j < numof_formats; ++j) {
+            check_pair(formats[i], formats[j]);
+        }
+    }
+    return test::result();
+}
@@ -0,0 +1,54 @@
+/*
+ * test.hpp
+ *  Helpers for the tests that "make check" of contrib/gcc/Makefile runs
+ *
+ *  Each test is a program that returns 0 when all of CHECK() hold.  It runs
+ *  in the build directory, and the first argument is the path of this
+ *  directory.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#ifndef TEST_HPP
+#define TEST_HPP
+
+#include <iostream>
+
+#include "../src/helper/thread.hpp"
+
+namespace test {
+    // the number of failures, guarded by lock()
+    inline unsigned int& failures(void) {
+        static unsigned int count = 0;
+        return count;
+    }
+    inline util::thread::mutex& lock(void) {
+        static util::thread::mutex m;
+        return m;
+    }
+
+    inline bool check(bool is_fine, const char* expr,
+                      const char* file, int line) {
+        if (!is_fine) {
+            util::thread::scoped_lock l(lock());
+            ++failures();
+            std::cerr << file << "(" << line << "): failed: " << expr
+                      << std::endl;
+        }
+        return is_fine;
+    }
+
+    // Returns the exit status of a test.
+    inline int result(void) {
+        util::thread::scoped_lock l(lock());
+        if (failures() == 0) return 0;
+        std::cerr << failures() << " failure(s)" << std::endl;
+        return 1;
+    }
+}
+
+// Reports "expr" with the place if it is false, and returns it.
+#define CHECK(expr) (test::check((expr), #expr, __FILE__, __LINE__))
+
+#endif // TEST_HPP
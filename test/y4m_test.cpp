@@ -0,0 +1,95 @@
+/*
+ * y4m_test.cpp
+ *  A test of the native backend for YUV4MPEG2 files
+ *
+ *  Sizes in a stream header are not trusted: a frame that int can't hold
+ *  or that is larger than the file has to be rejected instead of being
+ *  read.  The informations of a good file are kept by the metadata cache by
+ *  its modification time and size, without reading the content again.
+ *
+ *  Copyright (C) 2010 janus_wel<janus.wel.3@gmail.com>
+ *  see LICENSE for redistributing, modifying, and so on.
+ * */
+
+#include "test.hpp"
+
+#include "../src/include/avsutil.hpp"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+using namespace avsutil;
+
+namespace {
+    // Writes a Y4M file of "numof_frames" frames of 4:2:0 with "header".
+    void write_y4m( const std::string& filepath, const std::string& header,
+                    uint32_t width, uint32_t height, uint32_t numof_frames,
+                    char value) {
+        std::ofstream out(filepath.c_str(), std::ios::binary);
+        out << "YUV4MPEG2 " << header << "\n";
+        for (uint32_t n = 0; n < numof_frames; ++n) {
+            out << "FRAME\n" << std::string(width * height / 2 * 3, value);
+        }
+    }
+
+    void check_rejected(const std::string& header) {
+        const std::string filepath = "y4m_test.bad.y4m";
+        write_y4m(filepath, header, 64, 48, 2, 0);
+        avs_type& avs = manager().load(filepath.c_str());
+        if (!CHECK(!avs.is_fine())) {
+            std::cerr << "accepted: " << header << std::endl;
+        }
+        manager().unload(avs);
+        std::remove(filepath.c_str());
+    }
+
+    void check_metadata_cache(void) {
+        const std::string filepath = "y4m_test.y4m";
+        const std::string cache = "y4m_test.meta";
+        write_y4m(filepath, "W64 H48 F30:1 C420", 64, 48, 3, 16);
+        manager().metadata_cache(cache.c_str());
+
+        avs_type& first = manager().load_metadata(filepath.c_str());
+        CHECK(first.is_fine());
+        CHECK(first.video_info().numof_frames == 3);
+
+        // the same size and modification time with another content
+        struct stat st;
+        CHECK(stat(filepath.c_str(), &st) == 0);
+        write_y4m(filepath, "W64 H48 F30:1 C420", 64, 48, 3, 17);
+        struct utimbuf times;
+        times.actime = st.st_atime;
+        times.modtime = st.st_mtime;
+        CHECK(utime(filepath.c_str(), &times) == 0);
+
+        const manager_type::metadata_cache_stats_type before =
+            manager().metadata_cache_stats();
+        manager().load_metadata(filepath.c_str());
+        const manager_type::metadata_cache_stats_type after =
+            manager().metadata_cache_stats();
+        CHECK(after.hits == before.hits + 1);
+
+        manager().metadata_cache(NULL);
+        std::remove(filepath.c_str());
+        std::remove(cache.c_str());
+    }
+}
+
+int main(void) {
+    // 70000 * 70000 * 1.5 bytes overflow int
+    check_rejected("W70000 H70000 F30:1 C420");
+    check_rejected("W2147483647 H2 F30:1 C422");
+    check_rejected("W4294967360 H48 F30:1 C420");
+    // 30000 * 30000 * 1.5 bytes fit in int but not in the file
+    check_rejected("W30000 H30000 F30:1 C420");
+    // more than 8 bits
+    check_rejected("W64 H48 F30:1 C420p10");
+    check_rejected("W64 H48 F30:1 C422p16");
+    check_metadata_cache();
+    return test::result();
+}